@@ -18,6 +18,13 @@ namespace CommandProviderInterface
         public (long, long, string) ExampleScript(string editType);
         string? LanguageId { get; }
         public (IEnumerable<object>?, string?) Execute(string command, object[] args);
+        /* cancelled execution returns error, provider may stop script which runs */
+        public (IEnumerable<object>?, string?) Execute(string command, object[] args, CancellationToken cancel) => Execute(command, args);
+        /*
+            for commands which process every arg by itself: args are split into chunks which may run concurrently,
+            results are joined in order of args. partial gets results of finished leading chunks
+        */
+        public (IEnumerable<object>?, string?) ExecutePartitioned(string command, object[] args, Action<IReadOnlyList<object>>? partial, CancellationToken cancel) => Execute(command, args, cancel);
         //public IProviderRunspace CreateRunspace();
     }
 }
@@ -0,0 +1,68 @@
+﻿namespace CommandProviderInterface
+{
+    /* splits args of command into chunks and executes them in parallel, used by providers for ExecutePartitioned */
+    public static class PartitionedExecution
+    {
+        public const int MinChunkSize = 256;
+
+        /* chunks per executor, so one slow chunk doesn't hold others */
+        public const int ChunksPerExecutor = 4;
+
+        public static (IEnumerable<object>?, string?) Run(object[] args, int executors,
+                                                           Func<object[], CancellationToken, (IEnumerable<object>?, string?)> execute,
+                                                           Action<IReadOnlyList<object>>? partial, CancellationToken cancel)
+        {
+            int chunkCount = Math.Min(executors * ChunksPerExecutor, args.Length / MinChunkSize);
+            if (executors <= 1 || chunkCount <= 1)
+            {
+                return execute(args, cancel);
+            }
+            int chunkSize = (args.Length + chunkCount - 1) / chunkCount;
+            chunkCount = (args.Length + chunkSize - 1) / chunkSize;
+
+            List<object>?[] results = new List<object>?[chunkCount];
+            List<object> joined = [];
+            int published = 0;
+            string? error = null;
+            using var failed = CancellationTokenSource.CreateLinkedTokenSource(cancel);
+            try
+            {
+                Parallel.For(0, chunkCount, new ParallelOptions { MaxDegreeOfParallelism = executors, CancellationToken = failed.Token }, i =>
+                {
+                    var chunk = args[(i * chunkSize)..Math.Min(args.Length, (i + 1) * chunkSize)];
+                    var (output, chunkError) = execute(chunk, failed.Token);
+                    lock (results)
+                    {
+                        if (output == null)
+                        {
+                            error ??= chunkError ?? "Error at chunk execution\n";
+                            failed.Cancel();
+                            return;
+                        }
+                        results[i] = [.. output];
+                        int before = published;
+                        while (published < chunkCount && results[published] != null)
+                        {
+                            joined.AddRange(results[published]!);
+                            results[published] = null;
+                            published++;
+                        }
+                        if (published != before)
+                        {
+                            partial?.Invoke([.. joined]);
+                        }
+                    }
+                });
+            }
+            catch (OperationCanceledException)
+            {
+                return (null, error ?? "Cancelled\n");
+            }
+            if (error != null)
+            {
+                return (null, error);
+            }
+            return (joined, null);
+        }
+    }
+}
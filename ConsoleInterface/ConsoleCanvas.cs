@@ -8,8 +8,10 @@ namespace ConsoleInterface
     using Humanizer;
     using Common;
     using System;
+    using System.Buffers;
     using System.ComponentModel.DataAnnotations;
     using System.Globalization;
+    using System.Numerics;
     using System.Runtime.InteropServices;
     using System.Text;
     using Wcwidth;
@@ -42,45 +44,57 @@ namespace ConsoleInterface
             IsDefault == other.IsDefault &&
             (!IsDefault && R == other.R && G == other.G && B == other.B);
 
-        public readonly string AsForeground
-        {
-            get
-            {
-                if (IsDefault) return "\x1b[39m";
-                return $"\x1b[38;2;{R};{G};{B}m";
-            }
-        }
-
-        public readonly string AsBackground
-        {
-            get
-            {
-                if (IsDefault) return "\x1b[49m";
-                return $"\x1b[48;2;{R};{G};{B}m";
-            }
-        }
+        /* 0 is default color, otherwise 0x01RRGGBB */
+        internal readonly uint Packed => IsDefault ? 0u : 0x01000000u | ((uint)R << 16) | ((uint)G << 8) | B;
     }
 
     public class ConsoleCanvas : IDisposable
     {
-        private struct Cell
-        {
-            public string Text;
-            public Color Foreground;
-            public Color Background;
+        /* interned grapheme: utf8 bytes written to terminal, width in layout and columns cursor moves by */
+        private readonly record struct Grapheme(byte[] Bytes, int Width, int Advance);
+
+        /*
+            cells are kept as struct of arrays of grapheme ids and packed colors, previous arrays are what is
+            on screen. dirty bit of cell is set when cell differs from screen, so Flush visits only these cells.
+            id 0 is right half of wide grapheme, ids below 128 are ascii characters
+        */
+        private const int Continuation = 0;
+        private const int MaxGraphemes = 1 << 16;
+        /* clean cells between dirty ones are written again instead of cursor move if gap is short */
+        private const int MaxReprintGap = 4;
+        private static readonly byte[] Replacement = Encoding.UTF8.GetBytes("�");
+
+        private int[] Glyphs = [];
+        private uint[] Foregrounds = [];
+        private uint[] Backgrounds = [];
+        private int[] PreviousGlyphs = [];
+        private uint[] PreviousForegrounds = [];
+        private uint[] PreviousBackgrounds = [];
+        private ulong[] Dirty = [];
+        private int RowWords = 0;
+
+        /* frame which looks like scrolled screen is shifted by terminal, only exposed rows are written then */
+        public bool ScrollRegions = true;
+        /* fewer moved rows aren't worth scroll sequences */
+        private const int MinScrolledRows = 3;
+        private readonly Dictionary<int, int> PreviousRows = [];
+        private readonly Dictionary<int, int> ShiftVotes = [];
+
+        /* bytes written by Flush, used by scroll benchmark */
+        public long BytesWritten { get; private set; } = 0;
+
+        private readonly Dictionary<string, int> GraphemeIds = [];
+        private readonly List<Grapheme> Graphemes = [];
+
+        private byte[] Output = ArrayPool<byte>.Shared.Rent(64 * 1024);
+        private int OutputLength = 0;
+        private readonly Stream Stdout = Console.OpenStandardOutput();
 
-            public readonly bool Equals(Cell other) =>
-                Text == other.Text &&
-                Foreground.Equals(other.Foreground) &&
-                Background.Equals(other.Background);
-        }
-
-        private Cell[,] Buffer = new Cell[0, 0];
-        private Cell[,] PreviousBuffer = new Cell[0, 0];
         private int LastX = -1;
         private int LastY = -1;
-        private Color LastForeground = Color.Default;
-        private Color LastBackground = Color.Default;
+        private uint LastForeground = 0;
+        private uint LastBackground = 0;
+
         private bool VTEnabled;
 
         private bool AltBufferEnabled = false;
@@ -101,6 +115,7 @@ namespace ConsoleInterface
 
             EnableVirtualTerminal();
             EnableFeatures();
+            ResetGraphemes();
             UpdateConsoleSize();
             CreateBuffers(Width, Height);
             ClipRect = new(0, 0, Width, Height);
@@ -136,6 +151,7 @@ namespace ConsoleInterface
             GC.SuppressFinalize(this);
             DisableFeatures();
             Console.CursorVisible = true;
+            ArrayPool<byte>.Shared.Return(Output);
         }
 
         public long SetCell(long x, long y, string text, Color? foreground = null, Color? background = null)
@@ -147,19 +163,16 @@ namespace ConsoleInterface
             if (string.IsNullOrEmpty(text))
                 text = " ";
 
-            long width = UnicodeCalculator.GetWidth(text);
+            int id = Intern(text);
+            int width = Graphemes[id].Width;
             if (width == 2 && x + 1 >= ClipRect.Bx)
                 return 0;
 
-            Buffer[y, x].Text = text;
-            if (foreground != null) Buffer[y, x].Foreground = foreground.Value;
-            if (background != null) Buffer[y, x].Background = background.Value;
+            Store((int)x, (int)y, id, foreground, background);
 
             if (width == 2 && x + 1 < Width)
             {
-                Buffer[y, x + 1].Text = "";
-                if (foreground != null) Buffer[y, x + 1].Foreground = foreground.Value;
-                if (background != null) Buffer[y, x + 1].Background = background.Value;
+                Store((int)x + 1, (int)y, Continuation, foreground, background);
             }
 
             return width;
@@ -177,7 +190,7 @@ namespace ConsoleInterface
             while (enumerator.MoveNext())
             {
                 string grapheme = enumerator.GetTextElement();
-                long charWidth = UnicodeCalculator.GetWidth(grapheme);
+                long charWidth = Graphemes[Intern(grapheme)].Width;
 
                 if (currentX + charWidth > ClipRect.Bx)
                     break;
@@ -200,25 +213,19 @@ namespace ConsoleInterface
             if (intersectLeft > intersectRight || intersectTop > intersectBottom)
                 return;
 
-            for (long row = intersectTop; row <= intersectBottom; row++)
+            for (int row = (int)intersectTop; row <= intersectBottom; row++)
             {
-                for (long col = intersectLeft; col <= intersectRight; col++)
+                for (int col = (int)intersectLeft; col <= intersectRight; col++)
                 {
-                    if (Buffer[row, col].Text == "")
+                    int id = Glyphs[row * Width + col];
+                    if (id == Continuation)
                         continue;
 
-                    if (foreground.HasValue)
-                        Buffer[row, col].Foreground = foreground.Value;
-                    if (background.HasValue)
-                        Buffer[row, col].Background = background.Value;
+                    Store(col, row, id, foreground, background);
 
-                    int charWidth = UnicodeCalculator.GetWidth(Buffer[row, col].Text);
-                    if (charWidth == 2 && col + 1 < Width)
+                    if (Graphemes[id].Width == 2 && col + 1 < Width)
                     {
-                        if (foreground.HasValue)
-                            Buffer[row, col + 1].Foreground = foreground.Value;
-                        if (background.HasValue)
-                            Buffer[row, col + 1].Background = background.Value;
+                        Store(col + 1, row, Glyphs[row * Width + col + 1], foreground, background);
                     }
                 }
             }
@@ -234,7 +241,7 @@ namespace ConsoleInterface
             if (intersectLeft > intersectRight || intersectTop > intersectBottom)
                 return;
 
-            int charWidth = UnicodeCalculator.GetWidth(value);
+            int charWidth = Graphemes[Intern(value)].Width;
             for (long row = intersectTop; row <= intersectBottom; row++)
             {
                 for (long col = intersectLeft; col + charWidth <= intersectRight;)
@@ -247,13 +254,20 @@ namespace ConsoleInterface
 
         public void Clear()
         {
+            /* unused graphemes aren't removed one by one, table is built again and whole screen is repainted */
+            if (Graphemes.Count > MaxGraphemes)
+            {
+                ResetGraphemes();
+                Array.Fill(PreviousGlyphs, -1);
+            }
+            Array.Fill(Glyphs, ' ');
+            Array.Fill(Foregrounds, 0u);
+            Array.Fill(Backgrounds, 0u);
             for (int y = 0; y < Height; y++)
             {
                 for (int x = 0; x < Width; x++)
                 {
-                    Buffer[y, x].Text = " ";
-                    Buffer[y, x].Foreground = Color.Default;
-                    Buffer[y, x].Background = Color.Default;
+                    UpdateDirty(x, y);
                 }
             }
         }
@@ -265,64 +279,342 @@ namespace ConsoleInterface
 
             LastX = -1;
             LastY = -1;
-            LastForeground = Color.Default;
-            LastBackground = Color.Default;
+            LastForeground = 0;
+            LastBackground = 0;
+            OutputLength = 0;
 
-            StringBuilder buffer = new();
+            if (ScrollRegions)
+            {
+                ScrollRows();
+            }
 
             for (int y = 0; y < Height; y++)
             {
-                for (int x = 0; x < Width; x++)
+                for (int word = 0; word < RowWords; word++)
                 {
-                    if (Buffer[y, x].Text == "")
-                        continue;
+                    ref ulong bits = ref Dirty[y * RowWords + word];
+                    while (bits != 0)
+                    {
+                        int x = (word << 6) + BitOperations.TrailingZeroCount(bits);
+                        bits &= bits - 1;
+                        EmitCell(x, y);
+                    }
+                }
+            }
 
-                    Cell current = Buffer[y, x];
-                    Cell previous = PreviousBuffer[y, x];
+            if (LastForeground != 0 || LastBackground != 0)
+            {
+                Append("\x1b[0m"u8);
+            }
 
-                    if (current.Equals(previous))
-                        continue;
+            if (OutputLength > 0)
+            {
+                Stdout.Write(Output, 0, OutputLength);
+                Stdout.Flush();
+                BytesWritten += OutputLength;
+            }
+        }
 
-                    if (LastX != x || LastY != y)
-                    {
-                        buffer.Append($"\x1b[{y + 1};{x + 1}H");
-                        LastX = x;
-                        LastY = y;
-                    }
+        /*
+            changed rows which are on screen at other row vote for shift by row hash. longest run of rows which
+            are shifted by winning shift becomes scroll region, terminal shifts it by SU/SD and exposed rows
+            stay dirty. must be called while cursor style is default, exposed rows are filled by it
+        */
+        private void ScrollRows()
+        {
+            int dirtyRows = 0;
+            for (int y = 0; y < Height; y++)
+            {
+                if (IsRowDirty(y)) dirtyRows++;
+            }
+            if (dirtyRows < MinScrolledRows)
+                return;
 
-                    if (!LastForeground.Equals(current.Foreground))
-                    {
-                        buffer.Append(current.Foreground.AsForeground);
-                        LastForeground = current.Foreground;
-                    }
+            PreviousRows.Clear();
+            ShiftVotes.Clear();
+            for (int y = 0; y < Height; y++)
+            {
+                PreviousRows.TryAdd(RowHash(PreviousGlyphs, PreviousForegrounds, PreviousBackgrounds, y), y);
+            }
+            for (int y = 0; y < Height; y++)
+            {
+                if (IsRowDirty(y) &&
+                    PreviousRows.TryGetValue(RowHash(Glyphs, Foregrounds, Backgrounds, y), out int previous) &&
+                    previous != y)
+                {
+                    CollectionsMarshal.GetValueRefOrAddDefault(ShiftVotes, previous - y, out _)++;
+                }
+            }
 
-                    if (!LastBackground.Equals(current.Background))
-                    {
-                        buffer.Append(current.Background.AsBackground);
-                        LastBackground = current.Background;
-                    }
+            int shift = 0;
+            int votes = 0;
+            foreach (var (candidate, count) in ShiftVotes)
+            {
+                if (count > votes) (shift, votes) = (candidate, count);
+            }
+            if (votes < MinScrolledRows)
+                return;
 
-                    if (current.Text != "\r\n" && (current.Text.Length != 1 || !char.IsControl(current.Text[0])))
-                    {
-                        buffer.Append(current.Text);
-                        LastX += UnicodeCalculator.GetWidth(current.Text);
-                    }
-                    else
-                    {
-                        buffer.Append('�');
-                        LastX += 1;
-                    }
+            /* row y of frame is row y + shift of screen, hashes are only hints so rows are compared */
+            int runBegin = 0;
+            int runLength = 0;
+            int first = Math.Max(0, -shift);
+            int last = Math.Min(Height, Height - shift);
+            for (int y = first; y < last;)
+            {
+                int begin = y;
+                while (y < last && IsRowOnScreen(y, y + shift)) y++;
+                if (y - begin > runLength) (runBegin, runLength) = (begin, y - begin);
+                if (y == begin) y++;
+            }
+            if (runLength < MinScrolledRows)
+                return;
 
-                    PreviousBuffer[y, x] = current;
+            int moved = Math.Abs(shift);
+            int top = shift > 0 ? runBegin : runBegin - moved;
+            int bottom = shift > 0 ? runBegin + runLength - 1 + moved : runBegin + runLength - 1;
+
+            Append("\x1b["u8);
+            AppendNumber(top + 1);
+            Append((byte)';');
+            AppendNumber(bottom + 1);
+            Append("r\x1b["u8);
+            AppendNumber(moved);
+            Append(shift > 0 ? (byte)'S' : (byte)'T');
+            /* region is reset to whole screen, it moves cursor home */
+            Append("\x1b[r"u8);
+
+            int kept = (bottom - top + 1 - moved) * Width;
+            int from = (shift > 0 ? top + moved : top) * Width;
+            int to = (shift > 0 ? top : top + moved) * Width;
+            int exposed = (shift > 0 ? bottom + 1 - moved : top) * Width;
+            Array.Copy(PreviousGlyphs, from, PreviousGlyphs, to, kept);
+            Array.Copy(PreviousForegrounds, from, PreviousForegrounds, to, kept);
+            Array.Copy(PreviousBackgrounds, from, PreviousBackgrounds, to, kept);
+            Array.Fill(PreviousGlyphs, ' ', exposed, moved * Width);
+            Array.Fill(PreviousForegrounds, 0u, exposed, moved * Width);
+            Array.Fill(PreviousBackgrounds, 0u, exposed, moved * Width);
+
+            for (int y = top; y <= bottom; y++)
+            {
+                for (int x = 0; x < Width; x++)
+                {
+                    UpdateDirty(x, y);
                 }
             }
+        }
 
-            if (!LastForeground.IsDefault || !LastBackground.IsDefault)
+        private bool IsRowDirty(int y)
+        {
+            for (int word = 0; word < RowWords; word++)
             {
-                buffer.Append("\x1b[0m");
+                if (Dirty[y * RowWords + word] != 0) return true;
             }
+            return false;
+        }
 
-            Console.Write(buffer);
+        private int RowHash(int[] glyphs, uint[] foregrounds, uint[] backgrounds, int y)
+        {
+            HashCode hash = new();
+            hash.AddBytes(MemoryMarshal.AsBytes(glyphs.AsSpan(y * Width, Width)));
+            hash.AddBytes(MemoryMarshal.AsBytes(foregrounds.AsSpan(y * Width, Width)));
+            hash.AddBytes(MemoryMarshal.AsBytes(backgrounds.AsSpan(y * Width, Width)));
+            return hash.ToHashCode();
+        }
+
+        /* row of frame is same as row of screen */
+        private bool IsRowOnScreen(int y, int screenY) =>
+            Glyphs.AsSpan(y * Width, Width).SequenceEqual(PreviousGlyphs.AsSpan(screenY * Width, Width)) &&
+            Foregrounds.AsSpan(y * Width, Width).SequenceEqual(PreviousForegrounds.AsSpan(screenY * Width, Width)) &&
+            Backgrounds.AsSpan(y * Width, Width).SequenceEqual(PreviousBackgrounds.AsSpan(screenY * Width, Width));
+
+        private void EmitCell(int x, int y)
+        {
+            int index = y * Width + x;
+            int id = Glyphs[index];
+            uint foreground = Foregrounds[index];
+            uint background = Backgrounds[index];
+            PreviousGlyphs[index] = id;
+            PreviousForegrounds[index] = foreground;
+            PreviousBackgrounds[index] = background;
+
+            if (id == Continuation)
+                return;
+
+            if (LastX != x || LastY != y)
+            {
+                if (!TryReprintGap(x, y))
+                {
+                    AppendCursorPosition(x, y);
+                }
+                LastX = x;
+                LastY = y;
+            }
+
+            AppendStyle(foreground, background);
+
+            Grapheme grapheme = Graphemes[id];
+            Append(grapheme.Bytes);
+            LastX += grapheme.Advance;
+        }
+
+        /* short gap of clean ascii cells in style of cursor is cheaper to write again than to jump over */
+        private bool TryReprintGap(int x, int y)
+        {
+            if (LastY != y || x <= LastX || x - LastX > MaxReprintGap)
+                return false;
+
+            int begin = y * Width + LastX;
+            int end = y * Width + x;
+            for (int i = begin; i < end; i++)
+            {
+                if (Glyphs[i] < ' ' || Glyphs[i] >= 127 || Foregrounds[i] != LastForeground || Backgrounds[i] != LastBackground)
+                    return false;
+            }
+            EnsureOutput(end - begin);
+            for (int i = begin; i < end; i++)
+            {
+                Output[OutputLength++] = (byte)Glyphs[i];
+            }
+            return true;
+        }
+
+        private void AppendCursorPosition(int x, int y)
+        {
+            Append("\x1b["u8);
+            AppendNumber(y + 1);
+            Append((byte)';');
+            AppendNumber(x + 1);
+            Append((byte)'H');
+        }
+
+        /* changed colors are set by one SGR sequence */
+        private void AppendStyle(uint foreground, uint background)
+        {
+            bool foregroundChanged = foreground != LastForeground;
+            bool backgroundChanged = background != LastBackground;
+            if (!foregroundChanged && !backgroundChanged)
+                return;
+
+            Append("\x1b["u8);
+            if (foregroundChanged)
+            {
+                AppendColor(38, foreground);
+                LastForeground = foreground;
+            }
+            if (foregroundChanged && backgroundChanged)
+            {
+                Append((byte)';');
+            }
+            if (backgroundChanged)
+            {
+                AppendColor(48, background);
+                LastBackground = background;
+            }
+            Append((byte)'m');
+        }
+
+        /* 38/48 sets rgb color, 39/49 resets it to default */
+        private void AppendColor(int layer, uint color)
+        {
+            if (color == 0)
+            {
+                AppendNumber(layer + 1);
+                return;
+            }
+            AppendNumber(layer);
+            Append(";2;"u8);
+            AppendNumber((int)(color >> 16) & 0xFF);
+            Append((byte)';');
+            AppendNumber((int)(color >> 8) & 0xFF);
+            Append((byte)';');
+            AppendNumber((int)color & 0xFF);
+        }
+
+        private void AppendNumber(int value)
+        {
+            EnsureOutput(10);
+            value.TryFormat(Output.AsSpan(OutputLength), out int written, default, CultureInfo.InvariantCulture);
+            OutputLength += written;
+        }
+
+        private void Append(byte value)
+        {
+            EnsureOutput(1);
+            Output[OutputLength++] = value;
+        }
+
+        private void Append(ReadOnlySpan<byte> bytes)
+        {
+            EnsureOutput(bytes.Length);
+            bytes.CopyTo(Output.AsSpan(OutputLength));
+            OutputLength += bytes.Length;
+        }
+
+        private void EnsureOutput(int count)
+        {
+            if (OutputLength + count <= Output.Length)
+                return;
+
+            byte[] larger = ArrayPool<byte>.Shared.Rent(Math.Max(Output.Length * 2, OutputLength + count));
+            Output.AsSpan(0, OutputLength).CopyTo(larger);
+            ArrayPool<byte>.Shared.Return(Output);
+            Output = larger;
+        }
+
+        private void Store(int x, int y, int id, Color? foreground, Color? background)
+        {
+            int index = y * Width + x;
+            Glyphs[index] = id;
+            if (foreground != null) Foregrounds[index] = foreground.Value.Packed;
+            if (background != null) Backgrounds[index] = background.Value.Packed;
+            UpdateDirty(x, y);
+        }
+
+        private void UpdateDirty(int x, int y)
+        {
+            int index = y * Width + x;
+            ulong bit = 1UL << (x & 63);
+            ref ulong bits = ref Dirty[y * RowWords + (x >> 6)];
+            if (Glyphs[index] != PreviousGlyphs[index] ||
+                Foregrounds[index] != PreviousForegrounds[index] ||
+                Backgrounds[index] != PreviousBackgrounds[index])
+                bits |= bit;
+            else
+                bits &= ~bit;
+        }
+
+        private int Intern(string text)
+        {
+            if (text.Length == 1 && text[0] < 128 && text[0] != Continuation)
+                return text[0];
+
+            if (GraphemeIds.TryGetValue(text, out int id))
+                return id;
+
+            id = Graphemes.Count;
+            GraphemeIds[text] = id;
+            Graphemes.Add(CreateGrapheme(text));
+            return id;
+        }
+
+        private static Grapheme CreateGrapheme(string text)
+        {
+            int width = UnicodeCalculator.GetWidth(text);
+            if (text == "\r\n" || (text.Length == 1 && char.IsControl(text[0])))
+                return new(Replacement, width, 1);
+            return new(Encoding.UTF8.GetBytes(text), width, width);
+        }
+
+        private void ResetGraphemes()
+        {
+            GraphemeIds.Clear();
+            Graphemes.Clear();
+            Graphemes.Add(new([], 0, 0));
+            for (char c = (char)1; c < 128; c++)
+            {
+                Graphemes.Add(CreateGrapheme(c.ToString()));
+            }
         }
 
         private const uint INPUT_ENABLE_CONSOLE_INPUT = 0x0004u;
@@ -387,22 +679,18 @@ namespace ConsoleInterface
 
         private void CreateBuffers(int width, int height)
         {
-            var newBuffer = new Cell[height, width];
-            var newPrevBuffer = new Cell[height, width];
-
-            for (int y = 0; y < height; y++)
-            {
-                for (int x = 0; x < width; x++)
-                {
-                    newBuffer[y, x].Text = " ";
-                    newBuffer[y, x].Foreground = Color.Default;
-                    newBuffer[y, x].Background = Color.Default;
-                    newPrevBuffer[y, x] = newBuffer[y, x];
-                }
-            }
-
-            Buffer = newBuffer;
-            PreviousBuffer = newPrevBuffer;
+            int cells = width * height;
+            Glyphs = new int[cells];
+            Foregrounds = new uint[cells];
+            Backgrounds = new uint[cells];
+            PreviousGlyphs = new int[cells];
+            PreviousForegrounds = new uint[cells];
+            PreviousBackgrounds = new uint[cells];
+            Array.Fill(Glyphs, ' ');
+            Array.Fill(PreviousGlyphs, ' ');
+
+            RowWords = (width + 63) / 64;
+            Dirty = new ulong[RowWords * height];
         }
 
         internal static void SetClipboard(string text)
@@ -129,7 +129,11 @@ namespace ConsoleInterface
                 }
             }
 
-            if (!args.Contains("--no-interactive"))
+            if (args.Contains("--benchmark-scroll"))
+            {
+                BenchmarkScroll(render, tabs);
+            }
+            else if (!args.Contains("--no-interactive"))
             {
                 EventManager pool = new((e) =>
                 {
@@ -240,6 +244,52 @@ namespace ConsoleInterface
             Environment.Exit(0);
         }
 
+        /*
+            bytes written to terminal while cursor goes down through opened file line by line, first without
+            scroll regions and then with them
+        */
+        private static void BenchmarkScroll(Render render, FileTabsWindow tabs)
+        {
+            const long MaxFrames = 5000;
+            Stopwatch opening = Stopwatch.StartNew();
+            while (tabs.Child == null && opening.Elapsed < TimeSpan.FromSeconds(30))
+            {
+                Thread.Sleep(10);
+            }
+            if (tabs.Child is not FileEditorWindow editor || editor.cursor == null)
+            {
+                Logger.Log(LogLevel.Error, "Scroll benchmark: file isn't opened");
+                return;
+            }
+
+            long frames = Math.Min(editor.buffer.Text.GetLineCount(), MaxFrames);
+            List<string> results = [];
+            foreach (bool scrollRegions in new[] { false, true })
+            {
+                render.Canvas.ScrollRegions = scrollRegions;
+                editor.cursor.Selections.MoveVertical(-editor.buffer.Text.GetLineCount(), false);
+                long bytes = render.Canvas.BytesWritten;
+                Stopwatch time = Stopwatch.StartNew();
+                for (long frame = 0; frame < frames; frame++)
+                {
+                    editor.cursor.Selections.MoveVertical(1, false);
+                    foreach (var win in windows)
+                    {
+                        render.Draw(win);
+                    }
+                    render.Canvas.Flush();
+                }
+                results.Add($"Scroll regions {(scrollRegions ? "on" : "off")}: {frames} frames, {render.Canvas.BytesWritten - bytes} bytes, {time.ElapsedMilliseconds} ms");
+            }
+
+            render.Canvas.DisableFeatures();
+            foreach (var result in results)
+            {
+                Logger.Log(result);
+                Console.WriteLine(result);
+            }
+        }
+
         KeyMode Convert(ConsoleModifiers key)
         {
             KeyMode mode = KeyMode.None;
@@ -181,6 +181,7 @@ namespace ConsoleInterface
         static public int W, H;
         internal ConsoleCanvas Canvas;
         private ColorTheme colorTheme;
+        private readonly VisibleLines visibleLines = new();
 
         public Render(ColorTheme colorTheme)
         {
@@ -594,30 +595,27 @@ namespace ConsoleInterface
                     long cursorLine = window.cursor.Selections[0].EndLine;
                     int maxPower = 4;
                     /* draw numbers */
-                    for (int t = 0; t < position.H; ++t)
+                    int rows = visibleLines.Read(window.buffer, window.viewOffset, (int)position.H, 1);
+                    for (int t = visibleLines.FirstRow; t < rows; ++t)
                     {
                         int i = t + (int)window.viewOffset;
-                        (long index, string? s, _) = window.buffer.GetLine(i, position.W);
-                        if (s != null)
+                        long num = i;
+                        if (num < cursorLine)
                         {
-                            long num = i;
-                            if (num < cursorLine)
-                            {
-                                num = 100 - (cursorLine - num);
-                            }
-                            else
-                            {
-                                num = num - cursorLine;
-                            }
-                            if (num == 0)
-                            {
-                                Rect rect = new(position.X + 1, position.Y + t, position.W - 1, 1);
-                                Canvas.ApplyStyle(rect, null, new cColor(0, 20, 20));
-                            }
-                            else
-                            {
-                                Canvas.AddString(position.X + 1, position.Y + t, num.ToString());
-                            }
+                            num = 100 - (cursorLine - num);
+                        }
+                        else
+                        {
+                            num = num - cursorLine;
+                        }
+                        if (num == 0)
+                        {
+                            Rect rect = new(position.X + 1, position.Y + t, position.W - 1, 1);
+                            Canvas.ApplyStyle(rect, null, new cColor(0, 20, 20));
+                        }
+                        else
+                        {
+                            Canvas.AddString(position.X + 1, position.Y + t, num.ToString());
                         }
                     }
                     leftBarSize = (int)(maxPower + 0.5);
@@ -751,7 +749,7 @@ namespace ConsoleInterface
                 maxPos = (maxPos == 0 ? window.buffer.Text.Length + 1 : maxPos + position.W + 1);
                 lock (window.buffer.ErrorMarksLock)
                 {
-                    foreach (ref var err in CollectionsMarshal.AsSpan(window.buffer.ErrorMarks))
+                    foreach (var err in window.buffer.ErrorMarks.Query(minPos, maxPos))
                     {
                         if (err.End >= totalLength)
                         {
@@ -789,40 +787,43 @@ namespace ConsoleInterface
                 }
             }
 
-            long lastToken = 0;
-            for (int t = 0; t < window.Layout.Position.H; ++t)
+            var tokens = window.buffer.Tokens;
+            TokenStore.Cursor lastToken = default;
+            /* all visible lines are read at once */
+            int rows = visibleLines.Read(window.buffer, window.viewOffset, (int)window.Layout.Position.H, (int)window.Layout.Position.W);
+            for (int t = visibleLines.FirstRow; t < rows; ++t)
             {
-
-                int i = t + (int)window.viewOffset;
-                (long index, string? s, _) = window.buffer.GetLine(i, window.Layout.Position.W);
-                if (s != null)
+                long index = visibleLines.Offset(t);
+                string s = visibleLines.Text(t);
+                if (t == visibleLines.FirstRow)
+                {
+                    lastToken = tokens.Seek(index);
+                }
+                long x = leftBarSize + window.Layout.Position.X + 1;
+                long position = index;
+                var elements = StringInfo.GetTextElementEnumerator(s);
+                while (elements.MoveNext())
                 {
-                    long x = leftBarSize + window.Layout.Position.X + 1;
-                    long position = index;
-                    var elements = StringInfo.GetTextElementEnumerator(s);
-                    while (elements.MoveNext())
+                    string grapheme = elements.GetTextElement();
+                    if (grapheme == "\n") continue;
+                    Token? currentToken = null;
+                    while (lastToken.Valid && lastToken.Current.end < position)
                     {
-                        string grapheme = elements.GetTextElement();
-                        if (grapheme == "\n") continue;
-                        Token? currentToken = null;
-                        while (lastToken < window.buffer.Tokens.Count && window.buffer.Tokens[(int)lastToken].end < position)
-                        {
-                            lastToken++;
-                        }
-                        if (lastToken < window.buffer.Tokens.Count && window.buffer.Tokens[(int)lastToken].begin <= position)
-                        {
-                            currentToken = window.buffer.Tokens[(int)lastToken];
-                        }
-
-                        cColor color = new(255, 255, 255);
-                        if (currentToken != null)
-                        {
-                            color = new(ColorTheme.GetColor(currentToken.Value.type));
-                        }
+                        lastToken.MoveNext();
+                    }
+                    if (lastToken.Valid && lastToken.Current.begin <= position)
+                    {
+                        currentToken = lastToken.Current;
+                    }
 
-                        x += Canvas.SetCell(x, window.Layout.Position.Y + t, grapheme, color);
-                        position += Encoding.UTF8.GetByteCount(grapheme);
+                    cColor color = new(255, 255, 255);
+                    if (currentToken != null)
+                    {
+                        color = new(ColorTheme.GetColor(currentToken.Value.type));
                     }
+
+                    x += Canvas.SetCell(x, window.Layout.Position.Y + t, grapheme, color);
+                    position += Encoding.UTF8.GetByteCount(grapheme);
                 }
             }
             // draw errors count
@@ -837,15 +838,12 @@ namespace ConsoleInterface
         {
             int maxPower = 4;
             /* draw numbers */
-            for (int t = 0; t < window.Layout.Position.H; ++t)
+            int rows = visibleLines.Read(window.buffer, window.viewOffset, (int)window.Layout.Position.H, 1);
+            for (int t = visibleLines.FirstRow; t < rows; ++t)
             {
                 int i = t + (int)window.viewOffset;
-                (long index, string? s, _) = window.buffer.GetLine(i, 1);
-                if (s != null)
-                {
-                    int num = i;
-                    Canvas.AddString(window.Layout.Position.X + 1, window.Layout.Position.Y + t, num.ToString().PadLeft(maxPower), cColor.Default, cColor.Default);
-                }
+                int num = i;
+                Canvas.AddString(window.Layout.Position.X + 1, window.Layout.Position.Y + t, num.ToString().PadLeft(maxPower), cColor.Default, cColor.Default);
             }
             leftBarSize = maxPower + 1;
         }
@@ -873,11 +871,15 @@ namespace ConsoleInterface
             Rect position = window.Layout.Position;
             Vector2 screenOffset = new(position.W * 0.5f, position.H * 0.5f);
 
-            foreach (var node in window.tree.Values.Where(x => !x.hidden))
+            /* only nodes in view and one row and column around it */
+            Vector2 min = (window.Camera - screenOffset) / positionScale - Vector2.One, max = (window.Camera + screenOffset) / positionScale + Vector2.One;
+            window.graph.NodesIn(min.X, max.X, min.Y, max.Y, window.Visible);
+
+            foreach (var node in window.Visible)
             {
                 Vector2 pos = node.position * positionScale - window.Camera + screenOffset;
                 long ix = position.X + (long)Math.Round(pos.X), iy = position.Y + (long)Math.Floor(pos.Y);
-                foreach (var next in new[] { node.up/*, node.right*/ }.OfType<TreeWalkWindow.Node>())
+                foreach (var next in new[] { node.up/*, node.right*/ }.OfType<VersionGraph.Node>())
                 {
                     Vector2 nextPos = next.position * positionScale - window.Camera + screenOffset;
                     long x = position.X + (long)Math.Round(nextPos.X), y = position.Y + (long)Math.Floor(nextPos.Y);
@@ -898,7 +900,7 @@ namespace ConsoleInterface
                 }
             }
 
-            foreach (var node in window.tree.Values.Where(x => !x.hidden))
+            foreach (var node in window.Visible)
             {
                 Vector2 pos = node.position * positionScale - window.Camera + screenOffset;
                 pos -= 0.4f * new Vector2(w, h);
@@ -936,6 +938,7 @@ namespace ConsoleInterface
         public void Dispose()
         {
             Canvas.Dispose();
+            visibleLines.Dispose();
             GC.SuppressFinalize(this);
         }
     }
@@ -1,4 +1,5 @@
-﻿using Common;
+﻿using CommandProviderInterface;
+using Common;
 using RegexTokenizer;
 using System;
 using System.Collections.Generic;
@@ -18,11 +19,14 @@ namespace PowershellCommandProvider
 
         internal RunspacePool? runSpacePool;
 
+        /* runspaces of pool, chunks of partitioned execution run in them concurrently */
+        public static readonly int MaxRunspaces = Environment.ProcessorCount;
+
         public PowershellProvider()
         {
             _ = Task.Run(() =>
             {
-                runSpacePool = RunspaceFactory.CreateRunspacePool(1, 1);
+                runSpacePool = RunspaceFactory.CreateRunspacePool(1, MaxRunspaces);
                 runSpacePool.Open();
             });
         }
@@ -38,13 +42,21 @@ namespace PowershellCommandProvider
             return editType switch
             {
                 "edit" => (16, 18, "@($input) | % { $_ }"),
+                "editEach" => (16, 18, "@($input) | % { $_ }"),
                 "replace" => (19, 19, "@($input) -replace\"\",{\"\"}"),
                 "powerEdit" => (9, 9, "@($input)"),
                 _ => (0, 0, "")
             };
         }
 
-        public (IEnumerable<object>?, string?) Execute(string command, object[] args)
+        public (IEnumerable<object>?, string?) Execute(string command, object[] args) => Execute(command, args, CancellationToken.None);
+
+        public (IEnumerable<object>?, string?) ExecutePartitioned(string command, object[] args, Action<IReadOnlyList<object>>? partial, CancellationToken cancel)
+        {
+            return PartitionedExecution.Run(args, MaxRunspaces, (chunk, chunkCancel) => Execute(command, chunk, chunkCancel), partial, cancel);
+        }
+
+        public (IEnumerable<object>?, string?) Execute(string command, object[] args, CancellationToken cancel)
         {
             if (runSpacePool == null)
             {
@@ -55,7 +67,12 @@ namespace PowershellCommandProvider
             ps.AddScript(command);
             try
             {
+                using var stop = cancel.Register(() => ps.BeginStop(null, null));
                 var results = ps.Invoke(args);
+                if (cancel.IsCancellationRequested)
+                {
+                    return (null, "Cancelled\n");
+                }
                 if (ps.HadErrors)
                 {
                     var errorMsg = string.Join(Environment.NewLine, ps.Streams.Error);
@@ -63,6 +80,10 @@ namespace PowershellCommandProvider
                 }
                 return (results.Select(x => x?.BaseObject ?? x).OfType<object>(), null);
             }
+            catch (PipelineStoppedException)
+            {
+                return (null, "Cancelled\n");
+            }
             catch (Exception ex)
             {
                 Logger.Log(LogLevel.Error, $"{ex}");
@@ -0,0 +1,108 @@
+﻿using Common;
+using System;
+using System.Collections.Generic;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace EditorCore.Buffer
+{
+    public delegate void BufferAnalysis(IntPtr state, CancellationToken cancel);
+
+    /*
+        runs analyses of one buffer in background: after update it waits Delay for next one,
+        then runs all analyses for latest state one after another. newer update cancels
+        waiting or running analyses, so burst of edits ends with one run
+    */
+    public sealed class AnalysisScheduler : IDisposable
+    {
+        public TimeSpan Delay { get; set; } = TimeSpan.FromMilliseconds(20);
+
+        private readonly Lock SchedulerLock = new();
+        private readonly List<(string name, BufferAnalysis analysis)> Analyses = [];
+        private CancellationTokenSource? Current = null;
+        private Task Running = Task.CompletedTask;
+        private IntPtr? ScheduledState = null;
+        private bool disposed = false;
+
+        public void Add(string name, BufferAnalysis analysis)
+        {
+            lock (SchedulerLock)
+            {
+                Analyses.Add((name, analysis));
+            }
+        }
+
+        public void Remove(string name)
+        {
+            lock (SchedulerLock)
+            {
+                Analyses.RemoveAll(x => x.name == name);
+            }
+        }
+
+        /* state is id of rope version analyses should run for, force runs them even if it was already scheduled */
+        public Task Schedule(IntPtr state, bool force = false)
+        {
+            lock (SchedulerLock)
+            {
+                if (disposed || (!force && ScheduledState == state))
+                {
+                    return Running;
+                }
+                ScheduledState = state;
+                Current?.Cancel();
+                Current = new CancellationTokenSource();
+                var analyses = Analyses.ToArray();
+                /* runs are chained, so analyses never run concurrently with themselves */
+                Running = RunAsync(Running, state, analyses, Current);
+                return Running;
+            }
+        }
+
+        /* run owns its cancellation, it is disposed when run ends whether it was superseded or not */
+        private async Task RunAsync(Task previous, IntPtr state, (string name, BufferAnalysis analysis)[] analyses, CancellationTokenSource source)
+        {
+            CancellationToken cancel = source.Token;
+            try
+            {
+                await previous;
+                await Task.Delay(Delay, cancel);
+                foreach (var (name, analysis) in analyses)
+                {
+                    cancel.ThrowIfCancellationRequested();
+                    try
+                    {
+                        await Task.Run(() => analysis(state, cancel), cancel);
+                    }
+                    catch (Exception ex) when (ex is not OperationCanceledException)
+                    {
+                        Logger.Log(LogLevel.Error, $"Analysis {name} failed {ex.Message}");
+                    }
+                }
+            }
+            catch (OperationCanceledException)
+            {
+            }
+            finally
+            {
+                lock (SchedulerLock)
+                {
+                    if (Current == source)
+                    {
+                        Current = null;
+                    }
+                }
+                source.Dispose();
+            }
+        }
+
+        public void Dispose()
+        {
+            lock (SchedulerLock)
+            {
+                disposed = true;
+                Current?.Cancel();
+            }
+        }
+    }
+}
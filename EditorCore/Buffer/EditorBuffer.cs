@@ -12,7 +12,6 @@ using System.Linq;
 using System.Runtime.CompilerServices;
 using System.Runtime.InteropServices;
 using System.Text;
-using System.Threading.Channels;
 using System.Threading.Tasks;
 using TextBuffer;
 using static System.Runtime.InteropServices.JavaScript.JSType;
@@ -32,14 +31,16 @@ namespace EditorCore.Buffer
         public Server.EditorServer Server { get; internal set; }
         public Cursor.EditorCursor Cursor { get; internal set; }
         public BaseTokenizer Tokenizer { get; internal set; }
-        public List<Token> Tokens { get; internal set; } = [];
+        public TokenStore Tokens { get; internal set; } = TokenStore.Empty;
 
         public Lock ErrorMarksLock = new();
-        public List<IErrorMark> ErrorMarks { get; internal set; } = [];
+        public MarkerStore ErrorMarks { get; internal set; } = new();
         public Task<LspClient>? PotentialClient { get; internal set; }
         public Task<LspClient>? Client { get; internal set; }
-        public List<Func<Task>> ClientTasks = [];
-        public Channel<Func<Task>> ClientPipeline = Channel.CreateUnbounded<Func<Task>>();
+        public List<LspWork> ClientTasks = [];
+        public LspScheduler ClientPipeline = new();
+        private CompletionSession? Completion = null;
+        private long CompletionEdits = 0;
         public string? Filename { get; internal set; }
         public string? GivenLanguageId { get; internal set; }
 
@@ -48,6 +49,40 @@ namespace EditorCore.Buffer
 
         private Task? RunningWorker = null;
 
+        /*
+            edits merged into one range: [position, position + removed) became inserted bytes,
+            pending ones are not commited yet, commited ones lead from tokenized text to TokensState
+        */
+        private (long position, long removed, long inserted)? PendingEdit = null;
+        private (long position, long removed, long inserted)? CommitedEdit = null;
+        private IntPtr TokensState = IntPtr.Zero;
+        private bool TokensOutdated = true;
+        private long TokensLength = 0;
+        private readonly Lock TokensLock = new();
+
+        public AnalysisScheduler Analysis { get; } = new();
+
+        /* visual rows of soft wrapped lines, it is kept only while some view wraps lines of buffer */
+        private readonly WrapIndex Wrap = new();
+
+        /* time commits can join didChange which is not sent yet */
+        public static readonly TimeSpan LspDebounce = TimeSpan.FromMilliseconds(50);
+
+        /* key of work changing document text, full synchronization supersedes all such work queued before it */
+        private const string LspTextKey = "text";
+
+        /*
+            lsp edits of current commit: run of ascending edits, each at or after end of previous one, so position
+            of each one is the same in text after whole run and all of them are resolved in one sweep over it
+        */
+        private readonly List<(long position, long removedLines, long removedTail, string text)> LspRun = [];
+        private long LspRunEnd = 0;
+        private readonly List<(int line, int col, int end_line, int end_col, string text)> LspChanges = [];
+
+        /* changes queued to pipeline but not sent yet, next commits join them until other request is queued */
+        private List<(int line, int col, int end_line, int end_col, string text)>? LspBatch = null;
+        private readonly Lock LspBatchLock = new();
+
         public bool TryUseLSP { get; set; } = true;
 
         public bool WasChanged
@@ -84,6 +119,7 @@ namespace EditorCore.Buffer
             Server = server;
             PotentialClient = Client = server.GetLspAsync(LanguageId());
             SaveCursorState();
+            Analysis.Add(nameof(Tokenize), Tokenize);
 
             ActionOnUpdate += server.ActionOnBufferUpdate;
             ActionOnTextInput += server.ActionOnBufferTextInput;
@@ -97,7 +133,7 @@ namespace EditorCore.Buffer
                 if (Client != null) 
                 {
                     IntPtr state = Text.CurrentState;
-                    if (!ClientPipeline.Writer.TryWrite(async () => await (await Client).OpenFileAsync(HandleDiagnostics, PositionCallback, Filename, GetId(), LanguageId(), Text.SubstringEx(state, 0))))
+                    if (!ClientPipeline.Enqueue(new("didOpen", LspPriority.Sync, async _ => await (await Client).OpenFileAsync(HandleDiagnostics, PositionCallback, Filename, GetId(), LanguageId(), Text.LengthEx(state), ReadContent(state)))))
                     {
                         throw new Exception("What2?");
                     }
@@ -119,6 +155,7 @@ namespace EditorCore.Buffer
             Server = server;
             PotentialClient = Client = server.GetLspAsync(LanguageId());
             SaveCursorState();
+            Analysis.Add(nameof(Tokenize), Tokenize);
 
             ActionOnUpdate += server.ActionOnBufferUpdate;
             ActionOnTextInput += server.ActionOnBufferTextInput;
@@ -129,7 +166,7 @@ namespace EditorCore.Buffer
 
                 if (Client != null) { _ = Task.Run(async () => { await Client; OnUpdate(); }); }
 
-                if (Client != null) { ClientPipeline.Writer.TryWrite(async () => await (await Client).OpenFileAsync(HandleDiagnostics, PositionCallback, Filename, GetId(), LanguageId(), "")); }
+                if (Client != null) { ClientPipeline.Enqueue(new("didOpen", LspPriority.Sync, async _ => await (await Client).OpenFileAsync(HandleDiagnostics, PositionCallback, Filename, GetId(), LanguageId(), ""))); }
 
                 SetText(content);
             }
@@ -137,31 +174,72 @@ namespace EditorCore.Buffer
             OnUpdate();
         }
 
-        private long PositionCallback(long line, long col) => GetPosition(line, col);
+        private long[] PositionCallback(long[] lineColumns) => GetPositions(lineColumns);
+
+        /* reads utf8 of given version straight from rope, so documents are sent to server without building string */
+        private ContentReader ReadContent(IntPtr state) => (position, length, destination) => Text.ReadBytesEx(state, position, length, destination);
+
+        private LspWork FullSyncWork(IntPtr state) => new("didChange full", LspPriority.Sync, async _ => await (await Client!).ChangeFileAsync(Filename, GetId(), Text.LengthEx(state), ReadContent(state)), LspTextKey, true);
+
+        /* completion at position, request still waiting for answer is cancelled by newer one */
+        public async Task<(string value, string label, string kind)[]> GetCompletionsAsync(int line, int col)
+        {
+            if (!TryUseLSP || Client == null)
+            {
+                return [];
+            }
+            long position = GetPosition(line, col);
+            var (wordBegin, prefix) = GetWordBefore(position);
+
+            /* while the same word is typed cached list is filtered without waiting for server */
+            var session = Completion;
+            if (session == null || !session.Covers(wordBegin, prefix))
+            {
+                var client = Client;
+                long edits = Interlocked.Read(ref CompletionEdits);
+                var (items, incomplete) = await ClientPipeline.RequestAsync(nameof(GetCompletionsAsync), LspPriority.Interactive, async cancel => await (await client).GetCompletionListAsync(Filename, GetId(), line, col, cancel), "completion");
+                session = new(wordBegin, position, prefix, items, incomplete);
+                /* edits made while waiting were not followed by session, list is used only once */
+                if (Interlocked.Read(ref CompletionEdits) == edits)
+                {
+                    Completion = session;
+                }
+            }
+            return [.. session.Filter(prefix).Select(x => (x.Value, x.Label, x.Kind))];
+        }
+
+        /* identifier which ends at position, its utf8 continuation bytes are taken as identifier chars too */
+        private (long begin, string word) GetWordBefore(long position)
+        {
+            const int MaxWordLength = 256;
+            long from = Math.Max(0, position - MaxWordLength);
+            byte[] bytes = Text.SubBytes(from, position - from);
+            int begin = bytes.Length;
+            while (begin > 0 && (bytes[begin - 1] >= 0x80 || bytes[begin - 1] == '_' || char.IsAsciiLetterOrDigit((char)bytes[begin - 1])))
+            {
+                begin--;
+            }
+            return (from + begin, Encoding.UTF8.GetString(bytes, begin, bytes.Length - begin));
+        }
 
         private void HandleDiagnostics(string sourceId, IEnumerable<IErrorMark> values)
         {
             /* clear all previous diagnostics from this source & insert this ones */
             lock (ErrorMarksLock)
             {
-                ErrorMarks = [.. ErrorMarks.Where(x => x.Source != sourceId)];
-                ErrorMarks.AddRange(values);
+                ErrorMarks.ReplaceSource(sourceId, values);
             }
         }
 
-        public async Task StartWorkerAsync()
+        public Task StartWorkerAsync() => ClientPipeline.RunAsync(() => Client != null);
+
+        /* latencies of finished lsp work and work still queued, logged when buffer is closed */
+        public void LogLspStatistics()
         {
-            await foreach (var taskFunc in ClientPipeline.Reader.ReadAllAsync())
+            Logger.Log($"lsp queues of {Filename ?? GetId()}: sync = {ClientPipeline.QueueDepth(LspPriority.Sync)}, interactive = {ClientPipeline.QueueDepth(LspPriority.Interactive)}, background = {ClientPipeline.QueueDepth(LspPriority.Background)}");
+            foreach (var (name, latency) in ClientPipeline.GetLatencies())
             {
-                try
-                {
-                    if (Client != null)
-                        await taskFunc();
-                }
-                catch (Exception ex)
-                {
-                    Logger.Log(LogLevel.Error, $"Error at lsp task {ex.Message}");
-                }
+                Logger.Log($"lsp {name}: count = {latency.Count}, average = {latency.Average.TotalMilliseconds:F1}ms, max = {latency.Max.TotalMilliseconds:F1}ms");
             }
         }
 
@@ -203,6 +281,7 @@ namespace EditorCore.Buffer
                 return;
             }
             ActionOnUpdate?.Invoke(this);
+            FlushLspChanges();
             if (TryUseLSP && PotentialClient?.IsCompleted == true)
             {
                 if (WasIgnored)
@@ -211,7 +290,8 @@ namespace EditorCore.Buffer
                     if (Client != null)
                     {
                         IntPtr state = Text.CurrentState;
-                        if (!ClientPipeline.Writer.TryWrite(async () => await (await Client).ChangeFileAsync(Filename, GetId(), Text.SubstringEx(state, 0))))
+                        SealLspBatch();
+                        if (!ClientPipeline.Enqueue(FullSyncWork(state)))
                         {
                             throw new InvalidOperationException("What 3?");
                         }
@@ -226,7 +306,7 @@ namespace EditorCore.Buffer
                         Client = PotentialClient;
                         foreach (var x in ClientTasks)
                         {
-                            if (!ClientPipeline.Writer.TryWrite(x))
+                            if (!ClientPipeline.Enqueue(x))
                             {
                                 throw new InvalidOperationException("What?");
                             }
@@ -235,24 +315,155 @@ namespace EditorCore.Buffer
                     else
                     {
                         Client = null;
+                        SealLspBatch();
                     }
                 }
             }
             else
             {
                 WasIgnored = true;
+                SealLspBatch();
             }
             ClientTasks.Clear();
-            if (Text.Length <= Tokenizer.MaxContentSize)
+
+            IntPtr state = Text.CurrentState;
+            bool outdated;
+            lock (TokensLock)
             {
-                IntPtr state = Text.CurrentState;
-                var task = Task.Run(() => Tokenizer.ParseContent(Text.SubstringEx(state, 0)));
-                _ = task.ContinueWith(t => Tokens = t.Result, TaskContinuationOptions.OnlyOnRanToCompletion);
-                task.Wait(5);
+                if (PendingEdit != null)
+                {
+                    var (position, removed, inserted) = PendingEdit.Value;
+                    CommitedEdit = MergeEdits(CommitedEdit, position, removed, inserted);
+                    PendingEdit = null;
+                }
+                TokensState = state;
+                outdated = TokensOutdated;
             }
+            Analysis.Schedule(state, outdated);
             dirty_was_changed = true;
         }
 
+        /* union of edit range and next edit, in coordinates before first edit */
+        private static (long position, long removed, long inserted) MergeEdits((long position, long removed, long inserted)? edit, long position, long removed, long inserted)
+        {
+            if (edit == null)
+            {
+                return (position, removed, inserted);
+            }
+            var (begin, oldLength, newLength) = edit.Value;
+            long end = Math.Max(begin + newLength, position + removed);
+            long oldEnd = Math.Max(begin + oldLength, position + removed - (newLength - oldLength));
+            begin = Math.Min(begin, position);
+            return (begin, oldEnd - begin, end + inserted - removed - begin);
+        }
+
+        internal void TrackEdit(long position, long removed, long inserted)
+        {
+            PendingEdit = MergeEdits(PendingEdit, position, removed, inserted);
+        }
+
+        /*
+            analysis keeping Tokens up to date. tokens are published only if text wasn't committed again while run
+            worked, otherwise its edits go back to next run, which updates previous tokens by all of them
+        */
+        private void Tokenize(IntPtr _, CancellationToken cancel)
+        {
+            IntPtr state;
+            (long position, long removed, long inserted)? edit;
+            bool outdated;
+            lock (TokensLock)
+            {
+                state = TokensState;
+                edit = CommitedEdit;
+                outdated = TokensOutdated;
+                CommitedEdit = null;
+                TokensOutdated = false;
+            }
+            if (state == IntPtr.Zero || (edit == null && !outdated))
+            {
+                return;
+            }
+
+            var tokenizer = Tokenizer;
+            long length = Text.LengthEx(state);
+            if (length > tokenizer.MaxContentSize)
+            {
+                lock (TokensLock)
+                {
+                    TokensOutdated = true;
+                }
+                return;
+            }
+            try
+            {
+                /* text was changed not only by tracked edits */
+                if (outdated || (edit != null && TokensLength + edit.Value.inserted - edit.Value.removed != length))
+                {
+                    edit = null;
+                }
+
+                byte[] read(long pos, long len) => Text.SubBytesEx(state, pos, len);
+                TokenStore? tokens = null;
+                if (edit != null)
+                {
+                    var (position, removed, inserted) = edit.Value;
+                    tokens = tokenizer.UpdateContent(Tokens, read, length, position, removed, inserted, cancel);
+                }
+                tokens ??= tokenizer.ParseContent(read, length, cancel);
+                lock (TokensLock)
+                {
+                    if (TokensState != state)
+                    {
+                        RequeueTokensEdit(edit, outdated);
+                        return;
+                    }
+                    Tokens = tokens;
+                    TokensLength = length;
+                }
+            }
+            catch (OperationCanceledException)
+            {
+                /* edits of cancelled run go to next one */
+                lock (TokensLock)
+                {
+                    RequeueTokensEdit(edit, outdated);
+                }
+                throw;
+            }
+            catch (Exception)
+            {
+                lock (TokensLock)
+                {
+                    TokensOutdated = true;
+                }
+                throw;
+            }
+        }
+
+        /* edits of run which didn't publish tokens go before edits committed while it worked, TokensLock must be held */
+        private void RequeueTokensEdit((long position, long removed, long inserted)? edit, bool outdated)
+        {
+            if (edit != null && !outdated)
+            {
+                var next = CommitedEdit;
+                CommitedEdit = edit;
+                if (next != null)
+                {
+                    CommitedEdit = MergeEdits(CommitedEdit, next.Value.position, next.Value.removed, next.Value.inserted);
+                }
+            }
+            TokensOutdated |= outdated || edit == null;
+        }
+
+        /* text was replaced not by tracked edits, so next tokenize parses it whole */
+        private void InvalidateTokens()
+        {
+            lock (TokensLock)
+            {
+                TokensOutdated = true;
+            }
+        }
+
         public void Undo()
         {
             if (Text is IUndoTextBuffer undoText)
@@ -265,8 +476,11 @@ namespace EditorCore.Buffer
                 undoText.Undo();
                 LoadCursorState();
 
+                InvalidateTokens();
+                ResetWrap();
                 IntPtr state = Text.CurrentState;
-                if (Client != null) { ClientTasks.Add(async () => await (await Client).ChangeFileAsync(Filename, GetId(), Text.SubstringEx(state, 0))); }
+                DiscardLspChanges();
+                if (Client != null) { ClientTasks.Add(FullSyncWork(state)); }
                 OnUpdate();
             }
         }
@@ -285,13 +499,171 @@ namespace EditorCore.Buffer
                 }
                 LoadCursorState();
 
+                InvalidateTokens();
+                ResetWrap();
                 IntPtr state = Text.CurrentState;
-                if (Client != null) { ClientTasks.Add(async () => await (await Client).ChangeFileAsync(Filename, GetId(), Text.SubstringEx(state, 0))); }
+                DiscardLspChanges();
+                if (Client != null) { ClientTasks.Add(FullSyncWork(state)); }
                 OnUpdate();
             }
         }
 
 
+        /* must be called before edit is applied, removed are bytes it removes */
+        private void TrackLspEdit(long position, byte[] removed, string text, long inserted)
+        {
+            if (Client == null)
+            {
+                return;
+            }
+            Interlocked.Increment(ref CompletionEdits);
+            var session = Completion;
+            if (session != null && !session.Follow(position, removed.LongLength, inserted))
+            {
+                Completion = null;
+            }
+            if (LspRun.Count > 0 && position < LspRunEnd)
+            {
+                ResolveLspRun();
+            }
+            long removedLines = removed.AsSpan().Count((byte)'\n');
+            long removedTail = removedLines == 0 ? removed.LongLength : removed.LongLength - 1 - removed.AsSpan().LastIndexOf((byte)'\n');
+            LspRun.Add((position, removedLines, removedTail, text));
+            LspRunEnd = position + inserted;
+        }
+
+        /* positions of run in current text, text between close edits is read instead of walking tree for each one */
+        private void ResolveLspRun()
+        {
+            const long SweepLimit = 64 * 1024;
+            IntPtr state = Text.CurrentState;
+            long line = 0, col = 0, last = -1;
+            foreach (var (position, removedLines, removedTail, text) in LspRun)
+            {
+                if (last == -1 || position - last > SweepLimit)
+                {
+                    (line, col) = GetPositionOffsets(position);
+                }
+                else if (position > last)
+                {
+                    var gap = Text.SubBytesEx(state, last, position - last).AsSpan();
+                    int newlines = gap.Count((byte)'\n');
+                    line += newlines;
+                    col = newlines == 0 ? col + gap.Length : gap.Length - 1 - gap.LastIndexOf((byte)'\n');
+                }
+                last = position;
+                long endLine = line + removedLines;
+                long endCol = removedLines == 0 ? col + removedTail : removedTail;
+                LspChanges.Add(((int)line, (int)col, (int)endLine, (int)endCol, text));
+            }
+            LspRun.Clear();
+        }
+
+        /* all edits since last flush go to pipeline as one didChange */
+        private void FlushLspChanges()
+        {
+            ResolveLspRun();
+            if (LspChanges.Count == 0 || Client == null)
+            {
+                LspChanges.Clear();
+                return;
+            }
+            List<(int line, int col, int end_line, int end_col, string text)> changes = [.. LspChanges];
+            LspChanges.Clear();
+            lock (LspBatchLock)
+            {
+                if (LspBatch != null)
+                {
+                    LspBatch.AddRange(changes);
+                    return;
+                }
+                LspBatch = changes;
+            }
+            var client = Client;
+            ClientTasks.Add(new("didChange", LspPriority.Sync, async cancel =>
+            {
+                await Task.Delay(LspDebounce, cancel);
+                lock (LspBatchLock)
+                {
+                    if (LspBatch == changes)
+                    {
+                        LspBatch = null;
+                    }
+                }
+                await (await client).ChangeFileAsync(Filename, GetId(), changes);
+            }, LspTextKey));
+        }
+
+        /* requests queued after this must not be overtaken by changes made later */
+        private void SealLspBatch()
+        {
+            lock (LspBatchLock)
+            {
+                LspBatch = null;
+            }
+        }
+
+        /* full text is sent instead */
+        private void DiscardLspChanges()
+        {
+            Completion = null;
+            LspRun.Clear();
+            LspChanges.Clear();
+            SealLspBatch();
+        }
+
+        /* wrap index for given width, it's created again when width or count of lines doesn't match */
+        public WrapIndex GetWrapIndex(long width)
+        {
+            long lines = Text.GetLineCount() + 1;
+            if (Wrap.Width != width || Wrap.Lines != lines)
+            {
+                Wrap.Reset(width, lines);
+            }
+            return Wrap;
+        }
+
+        /* measures lines which aren't measured from first to last, rows are counted by bytes as columns are */
+        public void MeasureWrappedLines(long first, long last)
+        {
+            if (Wrap.Width <= 0)
+            {
+                return;
+            }
+            first = Math.Max(first, 0);
+            last = Math.Min(last, Wrap.Lines - 1);
+            for (long line = first; line <= last; line++)
+            {
+                if (Wrap.IsMeasured(line))
+                {
+                    continue;
+                }
+                var (begin, length) = Text.GetLineOffsets(line);
+                if (length > 0 && Text.SubBytes(begin + length - 1, 1)[0] == (byte)'\n')
+                {
+                    length--;
+                }
+                Wrap.Measure(line, length);
+            }
+        }
+
+        /* lines from line to line of end became unmeasured, removed lines of edit are dropped */
+        private void UpdateWrap(long line, long removedLines, long end)
+        {
+            if (Wrap.Width > 0)
+            {
+                Wrap.Replace(line, removedLines + 1, GetPositionOffsets(end).line - line + 1);
+            }
+        }
+
+        private void ResetWrap()
+        {
+            if (Wrap.Width > 0)
+            {
+                Wrap.Reset(Wrap.Width, Text.GetLineCount() + 1);
+            }
+        }
+
         private void MoveCursorsInsert(long position, long length)
         {
             /* move all cursors */
@@ -301,10 +673,7 @@ namespace EditorCore.Buffer
             }
             lock (ErrorMarksLock)
             {
-                foreach (var error in ErrorMarks)
-                {
-                    error.UpdateAfterInsert(position, length);
-                }
+                ErrorMarks.ShiftInsert(position, length);
             }
         }
 
@@ -312,12 +681,10 @@ namespace EditorCore.Buffer
         {
             if (Text is IEditableTextBuffer editableText)
             {
-                if (Client != null)
-                {
-                    var (line, col) = GetPositionOffsets(position);
-                    ClientTasks.Add(async () => await (await Client).ChangeFileAsync(Filename, GetId(), (int)line, (int)col, data));
-                }
+                TrackLspEdit(position, [], data, Encoding.UTF8.GetByteCount(data));
                 long length = editableText.Insert(position, data);
+                TrackEdit(position, 0, length);
+                UpdateWrap(GetPositionOffsets(position).line, 0, position + length);
                 MoveCursorsInsert(position, length);
                 return length;
             }
@@ -328,12 +695,10 @@ namespace EditorCore.Buffer
         {
             if (Text is IEditableTextBuffer editableText)
             {
-                if (Client != null)
-                {
-                    var (line, col) = GetPositionOffsets(position);
-                    ClientTasks.Add(async () => await (await Client).ChangeFileAsync(Filename, GetId(), (int)line, (int)col, Encoding.UTF8.GetString(data)));
-                }
+                TrackLspEdit(position, [], Encoding.UTF8.GetString(data), data.LongLength);
                 long length = editableText.Insert(position, data);
+                TrackEdit(position, 0, length);
+                UpdateWrap(GetPositionOffsets(position).line, 0, position + length);
                 MoveCursorsInsert(position, length);
                 return length;
             }
@@ -344,12 +709,6 @@ namespace EditorCore.Buffer
         {
             if (Text is IEditableTextBuffer editableText)
             {
-                if (Client != null) 
-                { 
-                    var (line, col) = GetPositionOffsets(position); 
-                    var (line2, col2) = GetPositionOffsets(position + count); 
-                    ClientTasks.Add(async () => await (await Client).ChangeFileAsync(Filename, GetId(), (int)line, (int)col, (int)line2, (int)col2, (int)count));
-                }
                 if (position + count <= 0)
                 {
                     return;
@@ -359,11 +718,164 @@ namespace EditorCore.Buffer
                     count += position;
                     position = 0;
                 }
+                /* tail past end isn't removed, server must get the same range */
+                count = Math.Min(count, Text.Length - position);
+                if (count <= 0)
+                {
+                    return;
+                }
+                if (Client != null)
+                {
+                    TrackLspEdit(position, Text.SubBytes(position, count), "", 0);
+                }
+                long line = 0, removedLines = 0;
+                if (Wrap.Width > 0)
+                {
+                    line = GetPositionOffsets(Math.Min(position, Text.Length)).line;
+                    removedLines = GetPositionOffsets(Math.Min(position + count, Text.Length)).line - line;
+                }
                 editableText.RemoveAt(position, count);
+                TrackEdit(position, count, 0);
+                UpdateWrap(line, removedLines, Math.Min(position, Text.Length));
                 MoveCursorsDelete(position, count);
             }
         }
 
+        /*
+            replace all given ranges in one modification,
+            returns new ranges of replaced text or null if ranges overlap
+            (if there is only one replacement it is used for all ranges)
+        */
+        public (long begin, long length)[]? ReplaceAll((long position, long length)[] ranges, string[] replacements)
+        {
+            if (Text is not IEditableTextBuffer editableText || (replacements.Length != ranges.Length && replacements.Length != 1))
+            {
+                return null;
+            }
+            long textLength = Text.Length;
+            foreach (var (position, length) in ranges)
+            {
+                if (position < 0 || length < 0 || length > textLength - position)
+                {
+                    return null;
+                }
+            }
+            int[] order = [.. Enumerable.Range(0, ranges.Length).OrderBy(x => ranges[x].position)];
+            for (int i = 1; i < order.Length; ++i)
+            {
+                if (ranges[order[i - 1]].position + ranges[order[i - 1]].length > ranges[order[i]].position)
+                {
+                    return null;
+                }
+            }
+
+            /* pack all replacements into one buffer */
+            byte[][] encoded = [.. replacements.Select(Encoding.UTF8.GetBytes)];
+            long[] offsets = new long[encoded.Length];
+            long totalLength = 0;
+            for (int i = 0; i < encoded.Length; ++i)
+            {
+                offsets[i] = totalLength;
+                totalLength += encoded[i].LongLength;
+            }
+            byte[] packed = new byte[totalLength];
+            for (int i = 0; i < encoded.Length; ++i)
+            {
+                encoded[i].CopyTo(packed, offsets[i]);
+            }
+
+            MarshalingReplaceMatch[] matches = new MarshalingReplaceMatch[order.Length];
+            long[] newLengths = new long[order.Length];
+            for (int i = 0; i < order.Length; ++i)
+            {
+                var (position, length) = ranges[order[i]];
+                int replacement = (encoded.Length == 1 ? 0 : order[i]);
+                matches[i] = new(position, length, offsets[replacement], encoded[replacement].LongLength);
+                newLengths[i] = encoded[replacement].LongLength;
+            }
+
+            if (Client != null)
+            {
+                /* edits tracked before are resolved, so run holds only these edits and can be dropped if replace fails */
+                ResolveLspRun();
+                /* as run of ascending edits, each one at its position after previous replacements */
+                long shift = 0;
+                for (int i = 0; i < order.Length; ++i)
+                {
+                    string text = encoded.Length == 1 ? replacements[0] : replacements[order[i]];
+                    TrackLspEdit(matches[i].Position + shift, Text.SubBytes(matches[i].Position, matches[i].Length), text, newLengths[i]);
+                    shift += newLengths[i] - matches[i].Length;
+                }
+            }
+
+            if (!editableText.ReplaceAll(matches, packed))
+            {
+                LspRun.Clear();
+                return null;
+            }
+
+            /* new positions of ranges */
+            long[] newBegins = new long[matches.Length];
+            long delta = 0;
+            for (int i = 0; i < matches.Length; ++i)
+            {
+                newBegins[i] = matches[i].Position + delta;
+                delta += newLengths[i] - matches[i].Length;
+            }
+            if (matches.Length > 0)
+            {
+                long first = matches[0].Position, last = matches[^1].Position + matches[^1].Length;
+                TrackEdit(first, last - first, last + delta - first);
+            }
+            MoveCursorsReplace(matches, newBegins, newLengths);
+            ResetWrap();
+
+            var result = new (long begin, long length)[ranges.Length];
+            for (int i = 0; i < order.Length; ++i)
+            {
+                result[order[i]] = (newBegins[i], newLengths[i]);
+            }
+            return result;
+        }
+
+        private void MoveCursorsReplace(MarshalingReplaceMatch[] matches, long[] newBegins, long[] newLengths)
+        {
+            /* move all cursors, from the end to keep positions of previous matches */
+            if (Cursor != null)
+            {
+                for (int i = matches.Length - 1; i >= 0; --i)
+                {
+                    Cursor.Selections.MoveDelete(matches[i].Position, matches[i].Length);
+                    Cursor.Selections.MoveInsert(matches[i].Position, newLengths[i]);
+                }
+            }
+            /* positions inside replaced range are moved to its new begin */
+            long Move(long position)
+            {
+                int left = 0, right = matches.Length;
+                while (left < right)
+                {
+                    int mid = (left + right) / 2;
+                    if (matches[mid].Position <= position) left = mid + 1;
+                    else right = mid;
+                }
+                if (left == 0)
+                {
+                    return position;
+                }
+                var match = matches[left - 1];
+                if (position < match.Position + match.Length)
+                {
+                    return newBegins[left - 1];
+                }
+                return position - match.Position - match.Length + newBegins[left - 1] + newLengths[left - 1];
+            }
+            lock (ErrorMarksLock)
+            {
+                ErrorMarks.Remap(Move);
+            }
+        }
+
         private void MoveCursorsDelete(long position, long length)
         {
 
@@ -374,17 +886,17 @@ namespace EditorCore.Buffer
             }
             lock (ErrorMarksLock)
             {
-                foreach (var error in ErrorMarks)
-                {
-                    error.UpdateAfterDelete(position, length);
-                }
+                ErrorMarks.ShiftDelete(position, length);
             }
         }
 
         public long SetText(string data)
         {
             long res = Text.SetText(data);
-            if (Client != null) { ClientTasks.Add(async () => await (await Client).ChangeFileAsync(Filename, GetId(), data)); }
+            InvalidateTokens();
+            ResetWrap();
+            DiscardLspChanges();
+            if (Client != null) { ClientTasks.Add(new("didChange full", LspPriority.Sync, async _ => await (await Client).ChangeFileAsync(Filename, GetId(), data), LspTextKey, true)); }
             OnUpdate();
             return res;
         }
@@ -405,6 +917,16 @@ namespace EditorCore.Buffer
             return Text.GetPosition(line, col);
         }
 
+        public long[] GetPositions(long[] lineColumns)
+        {
+            return Text.GetPositions(lineColumns);
+        }
+
+        public int ReadLines(long firstLine, int count, long firstColumn, long maxColumns, long[] lines, byte[] buffer)
+        {
+            return Text.ReadLines(firstLine, count, firstColumn, maxColumns, lines, buffer);
+        }
+
         public (long begin, long length) GetLineOffsets(long line)
         {
             return Text.GetLineOffsets(line);
@@ -434,8 +956,11 @@ namespace EditorCore.Buffer
             {
                 undoText.SetVersion(id);
                 LoadCursorState();
+                InvalidateTokens();
+                ResetWrap();
                 IntPtr state = Text.CurrentState;
-                if (Client != null) { ClientTasks.Add(async () => await (await Client).ChangeFileAsync(Filename, GetId(), Text.SubstringEx(state, 0))); }
+                DiscardLspChanges();
+                if (Client != null) { ClientTasks.Add(FullSyncWork(state)); }
                 OnUpdate();
             }
         }
@@ -443,22 +968,28 @@ namespace EditorCore.Buffer
         internal void UpdateRename(string? newFilename)
         {
             newFilename = Path.TryGetFullPath(newFilename);
+            Completion = null;
             string? oldLanguage = LanguageId();
             string? newLanguage = IEditorBuffer.LanguageId(newFilename);
             if (oldLanguage != newLanguage)
             {
                 Tokenizer = BaseTokenizer.CreateTokenizer(newLanguage);
+                InvalidateTokens();
                 if (TryUseLSP)
                 {
+                    FlushLspChanges();
+                    SealLspBatch();
                     if (PotentialClient != null)
                     {
                         string? oldFilename = Filename;
-                        ClientPipeline.Writer.TryWrite(async () => await (await PotentialClient).ChangeFileAsync(oldFilename, GetId(), Text.Substring(0))); 
+                        var oldClient = PotentialClient;
+                        IntPtr state = Text.CurrentState;
+                        ClientPipeline.Enqueue(new("didChange full", LspPriority.Sync, async _ => await (await oldClient).ChangeFileAsync(oldFilename, GetId(), Text.LengthEx(state), ReadContent(state)))); 
                     }
                     PotentialClient = Client = Server.GetLspAsync(newLanguage);
                     if (Client != null) 
                     { 
-                        ClientPipeline.Writer.TryWrite(async () => await (await Client).OpenFileAsync(HandleDiagnostics, PositionCallback, newFilename, GetId(), newLanguage, "")); 
+                        ClientPipeline.Enqueue(new("didOpen", LspPriority.Sync, async _ => await (await Client).OpenFileAsync(HandleDiagnostics, PositionCallback, newFilename, GetId(), newLanguage, ""))); 
                     }
                     WasIgnored = true;
                 }
@@ -468,7 +999,10 @@ namespace EditorCore.Buffer
                 if (TryUseLSP && Client != null) 
                 {
                     string? oldFilename = Filename;
-                    ClientTasks.Add(async () => await (await Client).RenameFileAsync(oldFilename, newFilename, GetId(), newLanguage, Text.Substring(0))); 
+                    FlushLspChanges();
+                    SealLspBatch();
+                    IntPtr state = Text.CurrentState;
+                    ClientTasks.Add(new("rename", LspPriority.Sync, async _ => await (await Client).RenameFileAsync(oldFilename, newFilename, GetId(), newLanguage, Text.LengthEx(state), ReadContent(state)))); 
                 }
             }
             Filename = newFilename;
@@ -489,10 +1023,12 @@ namespace EditorCore.Buffer
                 return;
             }
             disposed = true;
+            Analysis.Dispose();
             if (TryUseLSP)
             {
-                if (PotentialClient != null) { ClientPipeline.Writer.TryWrite(async () => await (await PotentialClient).CloseFileAsync(Filename, GetId(), LanguageId())); }
-                ClientPipeline.Writer.Complete();
+                LogLspStatistics();
+                if (PotentialClient != null) { ClientPipeline.Enqueue(new("didClose", LspPriority.Sync, async _ => await (await PotentialClient).CloseFileAsync(Filename, GetId(), LanguageId()))); }
+                ClientPipeline.Complete();
             }
             // TODO: restore this after allowing multiple cursors
             //Text.Dispose();
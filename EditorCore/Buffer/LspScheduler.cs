@@ -0,0 +1,225 @@
+﻿using Common;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace EditorCore.Buffer
+{
+    public enum LspPriority
+    {
+        /* document synchronization, runs one by one in order it was queued */
+        Sync = 0,
+        /* requests user waits for, like completion */
+        Interactive = 1,
+        Background = 2,
+    }
+
+    /* work with key cancels earlier not finished work with same key if it supersedes it */
+    public sealed class LspWork(string name, LspPriority priority, Func<CancellationToken, Task> run, string? key = null, bool supersede = false)
+    {
+        public readonly string Name = name;
+        public readonly LspPriority Priority = priority;
+        public readonly Func<CancellationToken, Task> Run = run;
+        public readonly string? Key = key;
+        public readonly bool Supersede = supersede;
+
+        internal readonly CancellationTokenSource Cancel = new();
+        internal long Enqueued = 0;
+    }
+
+    public readonly record struct LspLatency(long Count, TimeSpan Total, TimeSpan Max)
+    {
+        public TimeSpan Average => Count == 0 ? TimeSpan.Zero : Total / Count;
+    }
+
+    /*
+        lsp work of one buffer: queued sync notifications are sent before interactive requests and those
+        before background ones. sync work is awaited one by one, requests are only started, so slow response
+        doesn't hold back notifications. cancelled running request is cancelled on server with $/cancelRequest
+        by language client
+    */
+    public sealed class LspScheduler
+    {
+        private readonly Lock SchedulerLock = new();
+        private readonly Queue<LspWork>[] Queues = [new(), new(), new()];
+        private readonly List<LspWork> Keyed = [];
+        private readonly Dictionary<string, LspLatency> Latencies = [];
+        private readonly SemaphoreSlim Available = new(0);
+        private bool completed = false;
+
+        public bool Enqueue(LspWork work)
+        {
+            List<LspWork> superseded = [];
+            lock (SchedulerLock)
+            {
+                if (completed)
+                {
+                    return false;
+                }
+                if (work.Key != null)
+                {
+                    if (work.Supersede)
+                    {
+                        superseded.AddRange(Keyed.FindAll(x => x.Key == work.Key));
+                        Keyed.RemoveAll(x => x.Key == work.Key);
+                    }
+                    Keyed.Add(work);
+                }
+                work.Enqueued = Stopwatch.GetTimestamp();
+                Queues[(int)work.Priority].Enqueue(work);
+            }
+            foreach (var old in superseded)
+            {
+                try
+                {
+                    old.Cancel.Cancel();
+                }
+                catch (ObjectDisposedException)
+                {
+                    /* it was finished after it was superseded */
+                }
+            }
+            Available.Release();
+            return true;
+        }
+
+        /* request with result, newer request with same key cancels this one */
+        public Task<T> RequestAsync<T>(string name, LspPriority priority, Func<CancellationToken, Task<T>> request, string? key = null)
+        {
+            TaskCompletionSource<T> result = new(TaskCreationOptions.RunContinuationsAsynchronously);
+            LspWork work = new(name, priority, async cancel =>
+            {
+                try
+                {
+                    result.TrySetResult(await request(cancel));
+                }
+                catch (OperationCanceledException)
+                {
+                    result.TrySetCanceled();
+                    throw;
+                }
+                catch (Exception ex)
+                {
+                    result.TrySetException(ex);
+                    throw;
+                }
+            }, key, key != null);
+            work.Cancel.Token.Register(() => result.TrySetCanceled());
+            if (!Enqueue(work))
+            {
+                result.TrySetCanceled();
+            }
+            return result.Task;
+        }
+
+        /* queued work is still done, new one is refused */
+        public void Complete()
+        {
+            lock (SchedulerLock)
+            {
+                if (completed)
+                {
+                    return;
+                }
+                completed = true;
+            }
+            Available.Release();
+        }
+
+        /* worker loop, work is skipped while enabled returns false */
+        public async Task RunAsync(Func<bool> enabled)
+        {
+            while (true)
+            {
+                await Available.WaitAsync();
+                LspWork? work = null;
+                lock (SchedulerLock)
+                {
+                    foreach (var queue in Queues)
+                    {
+                        if (queue.TryDequeue(out work))
+                        {
+                            break;
+                        }
+                    }
+                }
+                if (work == null)
+                {
+                    return;
+                }
+                if (work.Cancel.IsCancellationRequested || !enabled())
+                {
+                    /* request waiting for skipped work gets cancelled */
+                    work.Cancel.Cancel();
+                    Finish(work, false);
+                    continue;
+                }
+                if (work.Priority == LspPriority.Sync)
+                {
+                    await ExecuteAsync(work);
+                }
+                else
+                {
+                    _ = ExecuteAsync(work);
+                }
+            }
+        }
+
+        private async Task ExecuteAsync(LspWork work)
+        {
+            bool done = false;
+            try
+            {
+                await work.Run(work.Cancel.Token);
+                done = true;
+            }
+            catch (OperationCanceledException)
+            {
+            }
+            catch (Exception ex)
+            {
+                Logger.Log(LogLevel.Error, $"Error at lsp task {work.Name} {ex.Message}");
+            }
+            finally
+            {
+                Finish(work, done);
+            }
+        }
+
+        /* work isn't used after it is finished, so its cancellation is disposed */
+        private void Finish(LspWork work, bool done)
+        {
+            TimeSpan latency = Stopwatch.GetElapsedTime(work.Enqueued);
+            lock (SchedulerLock)
+            {
+                Keyed.Remove(work);
+                if (done)
+                {
+                    var previous = Latencies.GetValueOrDefault(work.Name);
+                    Latencies[work.Name] = new(previous.Count + 1, previous.Total + latency, latency > previous.Max ? latency : previous.Max);
+                }
+            }
+            work.Cancel.Dispose();
+        }
+
+        /* queued work of given priority, superseded work counts until worker skips it */
+        public int QueueDepth(LspPriority priority)
+        {
+            lock (SchedulerLock)
+            {
+                return Queues[(int)priority].Count;
+            }
+        }
+
+        /* time from queueing to completion of finished work by its name */
+        public Dictionary<string, LspLatency> GetLatencies()
+        {
+            lock (SchedulerLock)
+            {
+                return new(Latencies);
+            }
+        }
+    }
+}
@@ -0,0 +1,392 @@
+﻿using Common;
+using System;
+using System.Collections;
+using System.Collections.Generic;
+
+namespace EditorCore.Buffer
+{
+    /*
+        error marks of buffer: marks of each source are kept in treap ordered by begin with max end of subtree.
+        node keeps begin, end and dependent positions of its mark (fix-it ranges) and subtree keeps lowest and
+        highest of them, so edit visits only subtrees which have positions on both sides of edit position,
+        subtrees wholly after it get lazy tag x => max(x + add, floor). positions are written back into marks
+        only when they are returned
+    */
+    public sealed class MarkerStore : IEnumerable<IErrorMark>
+    {
+        private sealed class Node(IErrorMark mark, string source)
+        {
+            public readonly IErrorMark Mark = mark;
+            public readonly string Source = source;
+            public readonly int Priority = Random.Shared.Next();
+            public long Begin = mark.Begin;
+            public long End = mark.End;
+            public readonly long[] Dependent = mark.DependentPositions;
+            public long MaxEnd = mark.End;
+
+            /* lowest and highest of begins, ends and dependent positions of subtree */
+            public long Low = mark.Begin;
+            public long High = mark.End;
+
+            public Node? Left = null;
+            public Node? Right = null;
+            public Node? Parent = null;
+
+            /* not applied to children yet */
+            public long Add = 0;
+            public long Floor = long.MinValue;
+        }
+
+        private readonly Dictionary<string, Node?> Sources = [];
+
+        /* node of each stored mark, boxed marks are compared by reference */
+        private readonly Dictionary<IErrorMark, Node> Nodes = new(ReferenceEqualityComparer.Instance);
+
+        public int Count => Nodes.Count;
+
+        /* changed by each change of marks or their positions */
+        public long Epoch { get; private set; } = 0;
+
+        public void Add(IErrorMark mark)
+        {
+            Node node = new(mark, mark.Source);
+            Update(node);
+            Sources.TryGetValue(mark.Source, out var root);
+            SetRoot(mark.Source, Insert(root, node));
+            Nodes[mark] = node;
+            Epoch++;
+        }
+
+        /* node is cut out of its treap, tags of its ancestors are pushed from root down to it first */
+        public bool Remove(IErrorMark mark)
+        {
+            if (!Nodes.Remove(mark, out var node))
+            {
+                return false;
+            }
+            List<Node> ancestors = [];
+            for (var x = node.Parent; x != null; x = x.Parent)
+            {
+                ancestors.Add(x);
+            }
+            for (int i = ancestors.Count - 1; i >= 0; i--)
+            {
+                Push(ancestors[i]);
+            }
+            Push(node);
+
+            var rest = Merge(node.Left, node.Right);
+            var parent = node.Parent;
+            if (parent == null)
+            {
+                SetRoot(node.Source, rest);
+            }
+            else
+            {
+                if (parent.Left == node)
+                {
+                    parent.Left = rest;
+                }
+                else
+                {
+                    parent.Right = rest;
+                }
+                foreach (var x in ancestors)
+                {
+                    Update(x);
+                }
+            }
+            Epoch++;
+            return true;
+        }
+
+        public void Clear()
+        {
+            Sources.Clear();
+            Nodes.Clear();
+            Epoch++;
+        }
+
+        /* all marks of source are replaced by given ones */
+        public void ReplaceSource(string source, IEnumerable<IErrorMark> marks)
+        {
+            Epoch++;
+            if (Sources.Remove(source, out var old))
+            {
+                Forget(old);
+            }
+            List<Node> nodes = [];
+            foreach (var mark in marks)
+            {
+                nodes.Add(new Node(mark, source));
+            }
+            if (nodes.Count == 0)
+            {
+                return;
+            }
+            nodes.Sort((a, b) => a.Begin.CompareTo(b.Begin));
+            Node? root = null;
+            foreach (var node in nodes)
+            {
+                Update(node);
+                root = Merge(root, node);
+                Nodes[node.Mark] = node;
+            }
+            SetRoot(source, root);
+        }
+
+        public void ShiftInsert(long position, long count)
+        {
+            Epoch++;
+            foreach (var root in Sources.Values)
+            {
+                Shift(root, position, count, long.MinValue);
+            }
+        }
+
+        public void ShiftDelete(long position, long count)
+        {
+            Epoch++;
+            foreach (var root in Sources.Values)
+            {
+                Shift(root, position, -count, position);
+            }
+        }
+
+        /* moves every position by move, it has to keep order of positions. every node is visited, but trees are kept */
+        public void Remap(Func<long, long> move)
+        {
+            Epoch++;
+            foreach (var root in Sources.Values)
+            {
+                Remap(root, move);
+            }
+        }
+
+        /* marks which begin before maxPos and end at minPos or later, ordered by begin */
+        public List<IErrorMark> Query(long minPos, long maxPos)
+        {
+            List<(long begin, IErrorMark mark)> found = [];
+            foreach (var root in Sources.Values)
+            {
+                Query(root, minPos, maxPos, found);
+            }
+            found.Sort((a, b) => a.begin.CompareTo(b.begin));
+            List<IErrorMark> result = new(found.Count);
+            foreach (var (_, mark) in found)
+            {
+                result.Add(mark);
+            }
+            return result;
+        }
+
+        public IEnumerator<IErrorMark> GetEnumerator() => Query(long.MinValue, long.MaxValue).GetEnumerator();
+
+        IEnumerator IEnumerable.GetEnumerator() => GetEnumerator();
+
+        private void SetRoot(string source, Node? root)
+        {
+            if (root != null)
+            {
+                root.Parent = null;
+            }
+            Sources[source] = root;
+        }
+
+        private void Forget(Node? node)
+        {
+            if (node == null)
+            {
+                return;
+            }
+            Nodes.Remove(node.Mark);
+            Forget(node.Left);
+            Forget(node.Right);
+        }
+
+        private static void Query(Node? node, long minPos, long maxPos, List<(long, IErrorMark)> found)
+        {
+            if (node == null || node.MaxEnd < minPos)
+            {
+                return;
+            }
+            Push(node);
+            Query(node.Left, minPos, maxPos, found);
+            if (node.Begin < maxPos)
+            {
+                if (node.End >= minPos)
+                {
+                    found.Add((node.Begin, Materialize(node)));
+                }
+                Query(node.Right, minPos, maxPos, found);
+            }
+        }
+
+        private static IErrorMark Materialize(Node node)
+        {
+            node.Mark.Begin = node.Begin;
+            node.Mark.End = node.End;
+            if (node.Dependent.Length != 0)
+            {
+                node.Mark.DependentPositions = node.Dependent;
+            }
+            return node.Mark;
+        }
+
+        /*
+            positions at position or after it are moved by x => max(x + add, floor), that is insert of add bytes or
+            delete of -add bytes. subtree without such positions is skipped, subtree with only such positions gets tag
+        */
+        private static void Shift(Node? node, long position, long add, long floor)
+        {
+            if (node == null || node.High < position)
+            {
+                return;
+            }
+            if (node.Low >= position)
+            {
+                Apply(node, add, floor);
+                return;
+            }
+            Push(node);
+            long Move(long x) => x >= position ? Math.Max(x + add, floor) : x;
+            node.Begin = Move(node.Begin);
+            node.End = Move(node.End);
+            for (int i = 0; i < node.Dependent.Length; i++)
+            {
+                node.Dependent[i] = Move(node.Dependent[i]);
+            }
+            Shift(node.Left, position, add, floor);
+            Shift(node.Right, position, add, floor);
+            Update(node);
+        }
+
+        private static void Remap(Node? node, Func<long, long> move)
+        {
+            if (node == null)
+            {
+                return;
+            }
+            Push(node);
+            node.Begin = move(node.Begin);
+            node.End = move(node.End);
+            for (int i = 0; i < node.Dependent.Length; i++)
+            {
+                node.Dependent[i] = move(node.Dependent[i]);
+            }
+            Remap(node.Left, move);
+            Remap(node.Right, move);
+            Update(node);
+        }
+
+        /* x => max(x + add, floor) for positions of whole subtree */
+        private static void Apply(Node? node, long add, long floor)
+        {
+            if (node == null)
+            {
+                return;
+            }
+            node.Begin = Math.Max(node.Begin + add, floor);
+            node.End = Math.Max(node.End + add, floor);
+            for (int i = 0; i < node.Dependent.Length; i++)
+            {
+                node.Dependent[i] = Math.Max(node.Dependent[i] + add, floor);
+            }
+            node.MaxEnd = Math.Max(node.MaxEnd + add, floor);
+            node.Low = Math.Max(node.Low + add, floor);
+            node.High = Math.Max(node.High + add, floor);
+            node.Floor = node.Floor == long.MinValue ? floor : Math.Max(node.Floor + add, floor);
+            node.Add += add;
+        }
+
+        private static void Push(Node node)
+        {
+            if (node.Add != 0 || node.Floor != long.MinValue)
+            {
+                Apply(node.Left, node.Add, node.Floor);
+                Apply(node.Right, node.Add, node.Floor);
+                node.Add = 0;
+                node.Floor = long.MinValue;
+            }
+        }
+
+        private static void Update(Node node)
+        {
+            long low = node.Begin, high = node.End;
+            foreach (long x in node.Dependent)
+            {
+                low = Math.Min(low, x);
+                high = Math.Max(high, x);
+            }
+            node.MaxEnd = node.End;
+            if (node.Left != null)
+            {
+                node.Left.Parent = node;
+                node.MaxEnd = Math.Max(node.MaxEnd, node.Left.MaxEnd);
+                low = Math.Min(low, node.Left.Low);
+                high = Math.Max(high, node.Left.High);
+            }
+            if (node.Right != null)
+            {
+                node.Right.Parent = node;
+                node.MaxEnd = Math.Max(node.MaxEnd, node.Right.MaxEnd);
+                low = Math.Min(low, node.Right.Low);
+                high = Math.Max(high, node.Right.High);
+            }
+            node.Low = low;
+            node.High = high;
+        }
+
+        /* marks which begin before position and the rest */
+        private static (Node? left, Node? right) Split(Node? node, long position)
+        {
+            if (node == null)
+            {
+                return (null, null);
+            }
+            Push(node);
+            if (node.Begin < position)
+            {
+                var (left, right) = Split(node.Right, position);
+                node.Right = left;
+                Update(node);
+                return (node, right);
+            }
+            else
+            {
+                var (left, right) = Split(node.Left, position);
+                node.Left = right;
+                Update(node);
+                return (left, node);
+            }
+        }
+
+        private static Node? Merge(Node? left, Node? right)
+        {
+            if (left == null || right == null)
+            {
+                return left ?? right;
+            }
+            if (left.Priority > right.Priority)
+            {
+                Push(left);
+                left.Right = Merge(left.Right, right);
+                Update(left);
+                return left;
+            }
+            else
+            {
+                Push(right);
+                right.Left = Merge(left, right.Left);
+                Update(right);
+                return right;
+            }
+        }
+
+        private static Node Insert(Node? root, Node node)
+        {
+            var (left, right) = Split(root, node.Begin);
+            return Merge(Merge(left, node), right)!;
+        }
+    }
+}
@@ -0,0 +1,233 @@
+﻿using System;
+using System.Threading;
+
+namespace EditorCore.Buffer
+{
+    /*
+        visual rows of soft wrapped lines for one wrap width. runs of lines with the same count of rows are kept
+        in treap with sums of lines and rows of subtree, so line <-> row are O(log n). edit replaces only runs of
+        lines it touched, lines which weren't measured yet count as one row and are measured when shown.
+        lines before text and after it are one row each, so view can be above or below text
+    */
+    public sealed class WrapIndex
+    {
+        private sealed class Node(long lines, long rows, bool measured)
+        {
+            public long Lines = lines;
+            public long Rows = rows;
+            public bool Measured = measured;
+            public readonly int Priority = Random.Shared.Next();
+            public long SumLines = lines;
+            public long SumRows = lines * rows;
+            public Node? Left = null;
+            public Node? Right = null;
+        }
+
+        private readonly Lock IndexLock = new();
+        private Node? root = null;
+
+        /* columns of row, 0 when index isn't used */
+        public long Width { get; private set; } = 0;
+
+        public long Lines
+        {
+            get { lock (IndexLock) { return root?.SumLines ?? 0; } }
+        }
+
+        /* all lines of text are one row each and not measured */
+        public void Reset(long width, long lines)
+        {
+            lock (IndexLock)
+            {
+                Width = width;
+                root = lines > 0 ? new Node(lines, 1, false) : null;
+            }
+        }
+
+        /* removed lines from line are replaced by inserted lines which are not measured */
+        public void Replace(long line, long removed, long inserted)
+        {
+            lock (IndexLock)
+            {
+                if (Width <= 0 || line < 0 || line + removed > (root?.SumLines ?? 0))
+                {
+                    return;
+                }
+                var (left, rest) = Split(root, line);
+                var (_, right) = Split(rest, removed);
+                root = Merge(Merge(left, inserted > 0 ? new Node(inserted, 1, false) : null), right);
+            }
+        }
+
+        public bool IsMeasured(long line)
+        {
+            lock (IndexLock)
+            {
+                return Find(line)?.Measured ?? true;
+            }
+        }
+
+        /* stores rows of line with given length of text (newline excluded), returns them */
+        public long Measure(long line, long length)
+        {
+            lock (IndexLock)
+            {
+                long rows = Width > 0 ? Math.Max(1, (length + Width - 1) / Width) : 1;
+                Node? node = Find(line);
+                if (node == null || (node.Measured && node.Rows == rows))
+                {
+                    return rows;
+                }
+                var (left, rest) = Split(root, line);
+                var (_, right) = Split(rest, 1);
+                root = Merge(Merge(left, new Node(1, rows, true)), right);
+                return rows;
+            }
+        }
+
+        /* first visual row of line */
+        public long RowOfLine(long line)
+        {
+            lock (IndexLock)
+            {
+                if (line <= 0)
+                {
+                    return line;
+                }
+                long rows = 0;
+                Node? node = root;
+                while (node != null)
+                {
+                    long leftLines = node.Left?.SumLines ?? 0;
+                    if (line < leftLines)
+                    {
+                        node = node.Left;
+                        continue;
+                    }
+                    line -= leftLines;
+                    rows += node.Left?.SumRows ?? 0;
+                    if (line < node.Lines)
+                    {
+                        return rows + line * node.Rows;
+                    }
+                    line -= node.Lines;
+                    rows += node.Lines * node.Rows;
+                    node = node.Right;
+                }
+                return rows + line;
+            }
+        }
+
+        /* line shown at visual row and row of it */
+        public (long line, long row) LineOfRow(long row)
+        {
+            lock (IndexLock)
+            {
+                if (row <= 0)
+                {
+                    return (row, 0);
+                }
+                long lines = 0;
+                Node? node = root;
+                while (node != null)
+                {
+                    long leftRows = node.Left?.SumRows ?? 0;
+                    if (row < leftRows)
+                    {
+                        node = node.Left;
+                        continue;
+                    }
+                    row -= leftRows;
+                    lines += node.Left?.SumLines ?? 0;
+                    if (row < node.Lines * node.Rows)
+                    {
+                        return (lines + row / node.Rows, row % node.Rows);
+                    }
+                    row -= node.Lines * node.Rows;
+                    lines += node.Lines;
+                    node = node.Right;
+                }
+                return (lines + row, 0);
+            }
+        }
+
+        private Node? Find(long line)
+        {
+            Node? node = root;
+            while (node != null && line >= 0)
+            {
+                long leftLines = node.Left?.SumLines ?? 0;
+                if (line < leftLines)
+                {
+                    node = node.Left;
+                    continue;
+                }
+                line -= leftLines;
+                if (line < node.Lines)
+                {
+                    return node;
+                }
+                line -= node.Lines;
+                node = node.Right;
+            }
+            return null;
+        }
+
+        private static void Update(Node node)
+        {
+            node.SumLines = node.Lines + (node.Left?.SumLines ?? 0) + (node.Right?.SumLines ?? 0);
+            node.SumRows = node.Lines * node.Rows + (node.Left?.SumRows ?? 0) + (node.Right?.SumRows ?? 0);
+        }
+
+        /* first count lines and the rest, run which contains the border is cut in two */
+        private static (Node? left, Node? right) Split(Node? node, long count)
+        {
+            if (node == null)
+            {
+                return (null, null);
+            }
+            long leftLines = node.Left?.SumLines ?? 0;
+            if (count <= leftLines)
+            {
+                var (left, right) = Split(node.Left, count);
+                node.Left = right;
+                Update(node);
+                return (left, node);
+            }
+            count -= leftLines;
+            if (count >= node.Lines)
+            {
+                var (left, right) = Split(node.Right, count - node.Lines);
+                node.Right = left;
+                Update(node);
+                return (node, right);
+            }
+            Node rest = new(node.Lines - count, node.Rows, node.Measured);
+            Node? tail = node.Right;
+            node.Lines = count;
+            node.Right = null;
+            Update(node);
+            return (node, Merge(rest, tail));
+        }
+
+        private static Node? Merge(Node? left, Node? right)
+        {
+            if (left == null || right == null)
+            {
+                return left ?? right;
+            }
+            if (left.Priority > right.Priority)
+            {
+                left.Right = Merge(left.Right, right);
+                Update(left);
+                return left;
+            }
+            else
+            {
+                right.Left = Merge(left, right.Left);
+                Update(right);
+                return right;
+            }
+        }
+    }
+}
@@ -44,11 +44,14 @@ namespace EditorCore.Cursor
                 case "replace":
                     {
                         string[] args;
+                        bool wasCleared = false;
                         if (Selections.All(x => x.TextLength == 0))
                         {
+                            wasCleared = true;
                             args = [Buffer.Text.Substring(0)];
                             if (Buffer.Text is IEditableTextBuffer editableText)
                             {
+                                Buffer.TrackEdit(0, Buffer.Text.Length, 0);
                                 editableText.Clear();
                             }
                         }
@@ -66,6 +69,10 @@ namespace EditorCore.Cursor
                             return;
                         }
                         Logger.Log($"get result: {string.Join(';', result.Select(x => x.ToString()))}");
+                        if (!wasCleared && TryReplaceSelections(result))
+                        {
+                            break;
+                        }
                         foreach (var x in Selections)
                         {
                             Buffer.DeleteString(x.Min, x.TextLength);
@@ -108,9 +115,13 @@ namespace EditorCore.Cursor
                     }
                     break;
                 case "edit":
+                case "editEach":
                     {
                         string[] args = Selections.Select(x => x.Text).OfType<string>().ToArray();
-                        (var enumerable_result, string? error_string) = Buffer.Server.CommandProvider.Execute(command, args.Select(x => x.ToString()).ToArray());
+                        /* editEach script transforms every selection by itself, so selections can be processed by chunks in parallel */
+                        (var enumerable_result, string? error_string) = type == "editEach" ?
+                            Buffer.Server.CommandProvider.ExecutePartitioned(command, args.Select(x => x.ToString()).ToArray(), null, CancellationToken.None) :
+                            Buffer.Server.CommandProvider.Execute(command, args.Select(x => x.ToString()).ToArray());
                         var result = enumerable_result?.Select(x => x.ToString()).
                                                         Where(x => x != null).
                                                         Cast<string>().
@@ -120,6 +131,10 @@ namespace EditorCore.Cursor
                             return;
                         }
                         Logger.Log($"get result: {string.Join(';', result.Select(x => x.ToString()))}");
+                        if (TryReplaceSelections(result))
+                        {
+                            break;
+                        }
                         foreach (var x in Selections)
                         {
                             Buffer.DeleteString(x.Min, x.TextLength);
@@ -195,6 +210,22 @@ namespace EditorCore.Cursor
             Selections.UpdateFromOffset();
         }
 
+        /* replace each selection with corresponding result using one modification */
+        private bool TryReplaceSelections(string[] result)
+        {
+            if (result.Length != Selections.Count)
+            {
+                return false;
+            }
+            var replaced = Buffer.ReplaceAll([.. Selections.Select(x => (x.Min, x.TextLength))], result);
+            if (replaced == null)
+            {
+                return false;
+            }
+            Selections = new(this, replaced.Select(x => new EditorSelection(this, x.begin, x.begin + x.length)));
+            return true;
+        }
+
         /* declarations for simplicity */
 
         public void Fork()
@@ -0,0 +1,135 @@
+﻿using Common;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace EditorFramework
+{
+    /*
+        runs external linters of linter mods. output parsed by mod is cached by content hash of linted text
+        and linter command, so saving text which was already linted doesn't start process again. count of
+        running linters is limited by MaxProcesses, new lint of file cancels not finished lint of it
+    */
+    public static class LintScheduler
+    {
+        public static readonly int MaxProcesses = Math.Max(1, Environment.ProcessorCount / 2);
+        public const int MaxCachedResults = 256;
+        public static readonly TimeSpan Timeout = TimeSpan.FromSeconds(30);
+
+        private static readonly Lock SchedulerLock = new();
+        private static readonly SemaphoreSlim Slots = new(MaxProcesses);
+        private static readonly Dictionary<string, CancellationTokenSource> Running = [];
+
+        /* least recently used result is at the end */
+        private static readonly LinkedList<((UInt128 hash, string command) key, object result)> CacheOrder = [];
+        private static readonly Dictionary<(UInt128 hash, string command), LinkedListNode<((UInt128 hash, string command) key, object result)>> Cache = [];
+
+        /* key names lint of file by mod, running lint with same key is cancelled */
+        public static CancellationToken Begin(string key)
+        {
+            CancellationTokenSource cancel = new();
+            CancellationTokenSource? previous;
+            lock (SchedulerLock)
+            {
+                Running.Remove(key, out previous);
+                Running[key] = cancel;
+            }
+            previous?.Cancel();
+            return cancel.Token;
+        }
+
+        public static void End(string key, CancellationToken token)
+        {
+            lock (SchedulerLock)
+            {
+                if (Running.TryGetValue(key, out var cancel) && cancel.Token == token)
+                {
+                    Running.Remove(key);
+                    cancel.Dispose();
+                }
+            }
+        }
+
+        /*
+            parse gets stdout and stderr of linter, its result is cached for text with given hash. process is
+            started only on cache miss, Win32Exception is thrown if linter isn't available
+        */
+        public static async Task<T> RunAsync<T>(UInt128 hash, ProcessStartInfo startInfo, Func<string, string, T> parse, CancellationToken cancel) where T : class
+        {
+            var key = (hash, $"{startInfo.FileName} {startInfo.Arguments}");
+            if (TryGetCached(key, out T? cached))
+            {
+                Logger.Log($"Lint result of {startInfo.FileName} got from cache");
+                return cached;
+            }
+
+            await Slots.WaitAsync(cancel);
+            try
+            {
+                /* same text could be linted while this lint waited for slot */
+                if (TryGetCached(key, out cached))
+                {
+                    return cached;
+                }
+
+                using var timeout = CancellationTokenSource.CreateLinkedTokenSource(cancel);
+                timeout.CancelAfter(Timeout);
+                using Process process = new() { StartInfo = startInfo };
+                process.Start();
+                try
+                {
+                    var output = process.StandardOutput.ReadToEndAsync(timeout.Token);
+                    var error = process.StandardError.ReadToEndAsync(timeout.Token);
+                    await process.WaitForExitAsync(timeout.Token);
+                    T result = parse(await output, await error);
+                    Store(key, result);
+                    return result;
+                }
+                catch (OperationCanceledException)
+                {
+                    try { process.Kill(true); } catch (InvalidOperationException) { }
+                    throw;
+                }
+            }
+            finally
+            {
+                Slots.Release();
+            }
+        }
+
+        private static bool TryGetCached<T>((UInt128, string) key, [System.Diagnostics.CodeAnalysis.NotNullWhen(true)] out T? result) where T : class
+        {
+            lock (SchedulerLock)
+            {
+                if (Cache.TryGetValue(key, out var node) && node.Value.result is T value)
+                {
+                    CacheOrder.Remove(node);
+                    CacheOrder.AddFirst(node);
+                    result = value;
+                    return true;
+                }
+            }
+            result = null;
+            return false;
+        }
+
+        private static void Store((UInt128, string) key, object result)
+        {
+            lock (SchedulerLock)
+            {
+                if (Cache.Remove(key, out var old))
+                {
+                    CacheOrder.Remove(old);
+                }
+                Cache[key] = CacheOrder.AddFirst((key, result));
+                while (Cache.Count > MaxCachedResults)
+                {
+                    Cache.Remove(CacheOrder.Last!.Value.key);
+                    CacheOrder.RemoveLast();
+                }
+            }
+        }
+    }
+}
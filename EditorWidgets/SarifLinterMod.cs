@@ -16,6 +16,16 @@ namespace EditorFramework
 
     public class SarifLinterMod
     {
+        record struct SarifRange(int StartLine, int StartColumn, int EndLine, int EndColumn);
+
+        record struct SarifFix(SarifRange Range, string Text);
+
+        /* ranges are zero based, fixes are only ones which change file of result */
+        sealed record SarifResult(string? FilePath, string Message, ErrorMarkSeverity Severity, SarifRange Range, SarifFix[] Fixes);
+
+        /* parsed linter output, it is cached by lint scheduler */
+        sealed record SarifOutput(bool HasJson, bool HasRuns, List<SarifResult> Results);
+
         struct SarifErrorMark : IErrorMark
         {
             public SarifErrorMark(nint currentState, string message, long begin, long end, ErrorMarkSeverity severity, string source, FixItDataItem[] fixItData)
@@ -42,68 +52,27 @@ namespace EditorFramework
 
             private readonly FixItDataItem[] FixItData;
 
-            public bool UpdateAfterDelete(long position, long count)
+            /* begin and end of each fix-it */
+            public long[] DependentPositions
             {
-                if (Begin >= position + count)
+                get
                 {
-                    Begin -= count;
-                }
-                else if (Begin >= position)
-                {
-                    Begin = position;
-                }
-                if (End >= position + count)
-                {
-                    End -= count;
-                }
-                else if (End >= position)
-                {
-                    End = position;
-                }
-                foreach (ref var fix in FixItData.AsSpan())
-                {
-                    if (fix.Begin >= position + count)
-                    {
-                        fix.Begin -= count;
-                    }
-                    else if (fix.Begin >= position)
-                    {
-                        fix.Begin = position;
-                    }
-                    if (fix.End >= position + count)
-                    {
-                        fix.End -= count;
-                    }
-                    else if (fix.End >= position)
+                    long[] positions = new long[FixItData.Length * 2];
+                    for (int i = 0; i < FixItData.Length; i++)
                     {
-                        fix.End = position;
+                        positions[2 * i] = FixItData[i].Begin;
+                        positions[2 * i + 1] = FixItData[i].End;
                     }
+                    return positions;
                 }
-                return Begin < End;
-            }
-
-            public bool UpdateAfterInsert(long position, long count)
-            {
-                if (Begin >= position)
+                set
                 {
-                    Begin += count;
-                }
-                if (End >= position)
-                {
-                    End += count;
-                }
-                foreach (ref var fix in FixItData.AsSpan())
-                {
-                    if (fix.Begin >= position)
+                    for (int i = 0; i < FixItData.Length; i++)
                     {
-                        fix.Begin += count;
-                    }
-                    if (fix.End >= position)
-                    {
-                        fix.End += count;
+                        FixItData[i].Begin = value[2 * i];
+                        FixItData[i].End = value[2 * i + 1];
                     }
                 }
-                return Begin < End;
             }
 
             public bool IsFixItAvailable(IEditorBuffer buffer)
@@ -146,218 +115,372 @@ namespace EditorFramework
             server.ActionOnFileOpen += OnFileSave;
         }
 
+        public const long MaxFileSize = 1024 * 1024;
+
         public static void OnFileSave(EditorFile file)
         {
             if (!File.Exists(file.filename)) { return; }
+            /* text is hashed before task starts, so following edits don't change it */
+            var text = file.Buffer.Text;
+            UInt128 hash = text.Length > MaxFileSize ? UInt128.Zero : text.ContentHashEx(text.CurrentState);
+            var cancel = LintScheduler.Begin($"::sarif-linter-mod::{file.filename}");
             _ = Task.Run(async () =>
             {
-                Logger.Log("File saved [sarif linter]");
-                if (file.Buffer.Text.Length > 1024 * 1024)
+                try
                 {
-                    lock (file.Buffer.ErrorMarksLock)
-                    {
-                        file.Buffer.ErrorMarks.Clear();
-                    }
-                    Logger.Log(LogLevel.Warning, "Too big file, disable sarif linter");
-                    return;
+                    await LintAsync(file, hash, cancel);
                 }
-                lock (file.Buffer.ErrorMarksLock)
+                finally
                 {
-                    file.Buffer.ErrorMarks.Clear();
+                    LintScheduler.End($"::sarif-linter-mod::{file.filename}", cancel);
                 }
-                var currentState = file.Buffer.Text.CurrentState;
-                string? language = file.LanguageId();
+            });
+        }
 
-                (string executable, string args)[] LinterVariants = language switch
-                {
-                    "c" => [("clang", "-std=gnu2x -fsyntax-only -Wall -Wextra -fdiagnostics-format=sarif -fno-color-diagnostics -D_CRT_SECURE_NO_WARNINGS -D_CRT_NONSTDC_NO_DEPRECATE -fms-extensions -Wno-microsoft %f"),
-                            ("gcc", "-fsyntax-only -Wall -Wextra -fdiagnostics-format=sarif -D_CRT_SECURE_NO_WARNINGS -D_CRT_NONSTDC_NO_DEPRECATE -fms-extensions -Wno-microsoft %f")],
-                    "cpp" => [("clang++", "-std=gnu++2c -fsyntax-only -fdiagnostics-format=sarif -fno-color-diagnostics -D_CRT_SECURE_NO_WARNINGS -D_CRT_NONSTDC_NO_DEPRECATE -fms-extensions -Wno-microsoft %f"),
-                              ("g++", "-fsyntax-only -fdiagnostics-format=sarif -D_CRT_SECURE_NO_WARNINGS -D_CRT_NONSTDC_NO_DEPRECATE -fms-extensions -Wno-microsoft %f")],
-                    "python" => [("ruff", "check %f --select E,F,UP,B,SIM,I --ignore D,ANN,COM --output-format sarif"),
-                                 ("pylint", "--output-format=sarif %f")],
-                    "javascript" or "typescript" => [("eslint", "-f sarif %f")],
-                    "go" => [("staticcheck", "-f sarif ./...")],
-                    "shellscript" => [("shellcheck", "-f sarif %f")],
-                    // todo
-                    // "csharp" => [("dotnet", "build /consoleloggerparameters:NoSummary /p:ErrorLog=report.sarif")],
-                    "dockerfile" => [("hadolint", "-f sarif %f")],
-                    "sql" => [("sqlfluff", "lint --format sarif %f")],
-
-                    _ => []
-                };
-
-                Logger.Log($"Language id: {language}");
-
-                foreach (var Linter in LinterVariants)
+        private static async Task LintAsync(EditorFile file, UInt128 hash, CancellationToken cancel)
+        {
+            Logger.Log("File saved [sarif linter]");
+            string source = $"::sarif-linter-mod::{file.filename}";
+            if (file.Buffer.Text.Length > MaxFileSize)
+            {
+                lock (file.Buffer.ErrorMarksLock)
                 {
-                    if (file.filename == null) continue;
+                    file.Buffer.ErrorMarks.ReplaceSource(source, []);
+                }
+                Logger.Log(LogLevel.Warning, "Too big file, disable sarif linter");
+                return;
+            }
+            lock (file.Buffer.ErrorMarksLock)
+            {
+                file.Buffer.ErrorMarks.ReplaceSource(source, []);
+            }
+            var currentState = file.Buffer.Text.CurrentState;
+            string? language = file.LanguageId();
 
-                    Process? process = null;
+            (string executable, string args)[] LinterVariants = language switch
+            {
+                "c" => [("clang", "-std=gnu2x -fsyntax-only -Wall -Wextra -fdiagnostics-format=sarif -fno-color-diagnostics -D_CRT_SECURE_NO_WARNINGS -D_CRT_NONSTDC_NO_DEPRECATE -fms-extensions -Wno-microsoft %f"),
+                        ("gcc", "-fsyntax-only -Wall -Wextra -fdiagnostics-format=sarif -D_CRT_SECURE_NO_WARNINGS -D_CRT_NONSTDC_NO_DEPRECATE -fms-extensions -Wno-microsoft %f")],
+                "cpp" => [("clang++", "-std=gnu++2c -fsyntax-only -fdiagnostics-format=sarif -fno-color-diagnostics -D_CRT_SECURE_NO_WARNINGS -D_CRT_NONSTDC_NO_DEPRECATE -fms-extensions -Wno-microsoft %f"),
+                          ("g++", "-fsyntax-only -fdiagnostics-format=sarif -D_CRT_SECURE_NO_WARNINGS -D_CRT_NONSTDC_NO_DEPRECATE -fms-extensions -Wno-microsoft %f")],
+                "python" => [("ruff", "check %f --select E,F,UP,B,SIM,I --ignore D,ANN,COM --output-format sarif"),
+                             ("pylint", "--output-format=sarif %f")],
+                "javascript" or "typescript" => [("eslint", "-f sarif %f")],
+                "go" => [("staticcheck", "-f sarif ./...")],
+                "shellscript" => [("shellcheck", "-f sarif %f")],
+                // todo
+                // "csharp" => [("dotnet", "build /consoleloggerparameters:NoSummary /p:ErrorLog=report.sarif")],
+                "dockerfile" => [("hadolint", "-f sarif %f")],
+                "sql" => [("sqlfluff", "lint --format sarif %f")],
+
+                _ => []
+            };
+
+            Logger.Log($"Language id: {language}");
+
+            foreach (var Linter in LinterVariants)
+            {
+                if (file.filename == null) continue;
 
-                    try
-                    {
-                        Logger.Log($"Running {Linter.executable} for {file.filename}");
+                try
+                {
+                    Logger.Log($"Running {Linter.executable} for {file.filename}");
 
-                        ProcessStartInfo startInfo = new()
+                    ProcessStartInfo startInfo = new()
+                    {
+                        FileName = Linter.executable,
+                        Arguments = Linter.args.Replace("%f", $"\"{file.filename}\""),
+                        RedirectStandardOutput = true,
+                        RedirectStandardError = true,
+                        UseShellExecute = false,
+                        CreateNoWindow = true,
+                        StandardOutputEncoding = Encoding.UTF8,
+                        StandardErrorEncoding = Encoding.UTF8
+                    };
+
+                    var sarif = await LintScheduler.RunAsync(hash, startInfo, ParseSarif, cancel);
+                    if (!sarif.HasJson) continue;
+                    if (!sarif.HasRuns) return;
+
+                    foreach (var group in sarif.Results.GroupBy(x => x.FilePath))
+                    {
+                        EditorFile? targetFile;
+                        lock (file.Buffer.Server.FilesLock)
                         {
-                            FileName = Linter.executable,
-                            Arguments = Linter.args.Replace("%f", $"\"{file.filename}\""),
-                            RedirectStandardOutput = true,
-                            RedirectStandardError = true,
-                            UseShellExecute = false,
-                            CreateNoWindow = true,
-                            StandardOutputEncoding = Encoding.UTF8,
-                            StandardErrorEncoding = Encoding.UTF8
-                        };
+                            targetFile = file.Buffer.Server.Files.FirstOrDefault(x =>
+                                x.filename != null &&
+                                string.Equals(Path.TryGetFullPath(x.filename)?.TrimEnd('\\', '/'), group.Key, StringComparison.OrdinalIgnoreCase)
+                            );
+                        }
+                        if (targetFile == null) continue;
 
-                        process = new Process { StartInfo = startInfo };
+                        AddMarks(targetFile.Buffer, [.. group], currentState, source, cancel);
+                    }
+                    Logger.Log($"Linter {Linter.executable} finished, found errors.");
+                    break;
+                }
+                catch (OperationCanceledException) when (cancel.IsCancellationRequested) { Logger.Log("Lint superseded by newer save."); return; }
+                catch (OperationCanceledException) { Logger.Log(LogLevel.Error, "Linter timeout."); }
+                catch (Exception ex) { Logger.Log(LogLevel.Error, $"Linter error: {ex.Message}"); }
+            }
+        }
 
-                        process.Start();
+        /* line/column pairs of all results of file are converted to positions by one call */
+        private static void AddMarks(EditorBuffer buffer, List<SarifResult> results, nint currentState, string source, CancellationToken cancel)
+        {
+            List<long> lineColumns = [];
+            void AddRange(SarifRange range)
+            {
+                lineColumns.AddRange([range.StartLine, range.StartColumn, range.EndLine, range.EndColumn]);
+            }
+            foreach (var result in results)
+            {
+                AddRange(result.Range);
+                foreach (var fix in result.Fixes)
+                {
+                    AddRange(fix.Range);
+                }
+            }
+            long[] positions = buffer.GetPositions([.. lineColumns]);
 
-                        using var cts = new CancellationTokenSource(TimeSpan.FromSeconds(30));
-                        var output = process.StandardOutput.ReadToEndAsync(cts.Token);
-                        var error = process.StandardError.ReadToEndAsync(cts.Token);
-                        await process.WaitForExitAsync(cts.Token);
-                        string fullOutput = (await output) + (await error);
+            List<IErrorMark> marks = [];
+            int index = 0;
+            foreach (var result in results)
+            {
+                long posStart = positions[index++];
+                long posEnd = positions[index++];
 
-                        string raw = fullOutput.ToString().Trim();
-                        if (string.IsNullOrWhiteSpace(raw)) continue;
+                if (posEnd - posStart <= 1)
+                {
+                    posEnd = Math.Min(posStart + 2, buffer.Text.Length);
+                }
 
-                        int startIdx = raw.IndexOf('{');
-                        int endIdx = raw.LastIndexOf('}');
-                        if (startIdx == -1 || endIdx == -1 || endIdx < startIdx) continue;
+                FixItDataItem[] fixIts = new FixItDataItem[result.Fixes.Length];
+                for (int i = 0; i < fixIts.Length; i++)
+                {
+                    long begin = positions[index++];
+                    long end = positions[index++];
+                    fixIts[i] = new FixItDataItem(begin, end, result.Fixes[i].Text);
+                }
 
-                        string json = raw.Substring(startIdx, endIdx - startIdx + 1);
+                marks.Add(new SarifErrorMark(
+                    currentState,
+                    result.Message,
+                    Math.Max(posStart, 0),
+                    posEnd,
+                    result.Severity,
+                    source,
+                    fixIts
+                ));
+            }
+            lock (buffer.ErrorMarksLock)
+            {
+                /* newer lint of file already cleared marks */
+                if (cancel.IsCancellationRequested) return;
+                buffer.ErrorMarks.ReplaceSource(source, marks);
+            }
+        }
 
-                        using (JsonDocument doc = JsonDocument.Parse(json))
-                        {
-                            if (!doc.RootElement.TryGetProperty("runs", out JsonElement runs)) return;
+        /* sarif is read by Utf8JsonReader, handlers of properties and elements have to read whole value */
+        delegate void PropertyReader(ref Utf8JsonReader reader, string name);
+        delegate void ElementReader(ref Utf8JsonReader reader);
 
-                            foreach (JsonElement run in runs.EnumerateArray())
-                            {
-                                if (!run.TryGetProperty("results", out JsonElement results)) continue;
+        private static void ReadObject(ref Utf8JsonReader reader, PropertyReader property)
+        {
+            if (reader.TokenType != JsonTokenType.StartObject)
+            {
+                reader.Skip();
+                return;
+            }
+            while (reader.Read() && reader.TokenType == JsonTokenType.PropertyName)
+            {
+                string name = reader.GetString()!;
+                reader.Read();
+                property(ref reader, name);
+            }
+        }
 
-                                foreach (JsonElement result in results.EnumerateArray())
-                                {
-                                    string msg = "Unknown error";
-                                    if (result.TryGetProperty("message", out JsonElement msgProp))
-                                        msg = msgProp.GetProperty("text").GetString() ?? msg;
+        private static void ReadArray(ref Utf8JsonReader reader, ElementReader element)
+        {
+            if (reader.TokenType != JsonTokenType.StartArray)
+            {
+                reader.Skip();
+                return;
+            }
+            while (reader.Read() && reader.TokenType != JsonTokenType.EndArray)
+            {
+                element(ref reader);
+            }
+        }
 
-                                    ErrorMarkSeverity severity = ErrorMarkSeverity.Error;
-                                    if (result.TryGetProperty("level", out JsonElement levelProp))
-                                    {
-                                        string level = levelProp.GetString()?.ToLower() ?? "";
-                                        if (level == "warning" || level == "note") severity = ErrorMarkSeverity.Warning;
-                                    }
+        private static SarifOutput ParseSarif(string output, string error)
+        {
+            string raw = (output + error).Trim();
+            int startIdx = raw.IndexOf('{');
+            int endIdx = raw.LastIndexOf('}');
+            if (startIdx == -1 || endIdx == -1 || endIdx < startIdx) return new(false, false, []);
+
+            Utf8JsonReader reader = new(Encoding.UTF8.GetBytes(raw, startIdx, endIdx - startIdx + 1));
+            reader.Read();
+            bool hasRuns = false;
+            List<SarifResult> results = [];
+            ReadObject(ref reader, (ref Utf8JsonReader root, string name) =>
+            {
+                if (name != "runs") { root.Skip(); return; }
+                hasRuns = true;
+                ReadArray(ref root, (ref Utf8JsonReader run) => ReadObject(ref run, (ref Utf8JsonReader r, string property) =>
+                {
+                    if (property != "results") { r.Skip(); return; }
+                    ReadArray(ref r, (ref Utf8JsonReader result) =>
+                    {
+                        var parsed = ReadResult(ref result);
+                        if (parsed != null) results.Add(parsed);
+                    });
+                }));
+            });
+            return new(true, hasRuns, results);
+        }
 
-                                    if (!result.TryGetProperty("locations", out JsonElement locations) || locations.GetArrayLength() == 0) continue;
+        private static string? NormalizePath(string uri) => Path.TryGetFullPath(new Uri(uri).LocalPath)?.TrimEnd('\\', '/');
 
-                                    JsonElement firstLoc = locations[0];
-                                    if (!firstLoc.TryGetProperty("physicalLocation", out JsonElement physLoc)) continue;
+        /* null if result has no location in file */
+        private static SarifResult? ReadResult(ref Utf8JsonReader reader)
+        {
+            string msg = "Unknown error";
+            ErrorMarkSeverity severity = ErrorMarkSeverity.Error;
+            string? uri = null;
+            SarifRange? region = null;
+            List<(string? uri, SarifFix fix)> changes = [];
 
-                                    string? errorFilePath = null;
-                                    if (physLoc.TryGetProperty("artifactLocation", out JsonElement artLoc) && artLoc.TryGetProperty("uri", out JsonElement uriProp))
+            ReadObject(ref reader, (ref Utf8JsonReader r, string name) =>
+            {
+                switch (name)
+                {
+                    case "message":
+                        ReadObject(ref r, (ref Utf8JsonReader m, string property) =>
+                        {
+                            if (property == "text") msg = m.GetString() ?? msg;
+                            else m.Skip();
+                        });
+                        break;
+                    case "level":
+                        {
+                            string level = r.GetString()?.ToLower() ?? "";
+                            if (level == "warning" || level == "note") severity = ErrorMarkSeverity.Warning;
+                        }
+                        break;
+                    case "locations":
+                        {
+                            bool first = true;
+                            ReadArray(ref r, (ref Utf8JsonReader location) =>
+                            {
+                                if (!first) { location.Skip(); return; }
+                                first = false;
+                                ReadObject(ref location, (ref Utf8JsonReader l, string property) =>
+                                {
+                                    if (property != "physicalLocation") { l.Skip(); return; }
+                                    ReadObject(ref l, (ref Utf8JsonReader p, string physical) =>
                                     {
-                                        try { errorFilePath = new Uri(uriProp.GetString()!).LocalPath; } catch { continue; }
-                                    }
-                                    if (string.IsNullOrEmpty(errorFilePath)) continue;
-                                    string? normError = Path.TryGetFullPath(errorFilePath)?.TrimEnd('\\', '/');
+                                        if (physical == "artifactLocation") uri = ReadUri(ref p);
+                                        else if (physical == "region") region = ReadRegion(ref p, 0);
+                                        else p.Skip();
+                                    });
+                                });
+                            });
+                        }
+                        break;
+                    case "fixes":
+                        ReadArray(ref r, (ref Utf8JsonReader fix) => ReadObject(ref fix, (ref Utf8JsonReader f, string property) =>
+                        {
+                            if (property != "artifactChanges") { f.Skip(); return; }
+                            ReadArray(ref f, (ref Utf8JsonReader change) => ReadChange(ref change, changes));
+                        }));
+                        break;
+                    default:
+                        r.Skip();
+                        break;
+                }
+            });
 
-                                    if (!physLoc.TryGetProperty("region", out JsonElement region)) continue;
+            if (uri == null || region == null) return null;
+            string? normError;
+            try { normError = NormalizePath(uri); } catch { return null; }
+            if (string.IsNullOrEmpty(normError)) return null;
 
-                                    int sLine = region.GetProperty("startLine").GetInt32() - 1;
-                                    int sCol = region.GetProperty("startColumn").GetInt32() - 1;
+            List<SarifFix> fixes = [];
+            foreach (var (changeUri, fix) in changes)
+            {
+                if (changeUri != null && !string.Equals(NormalizePath(changeUri), normError, StringComparison.OrdinalIgnoreCase)) continue;
+                fixes.Add(fix);
+            }
+            return new(normError, msg, severity, region.Value, [.. fixes]);
+        }
 
-                                    int eLine = (region.TryGetProperty("endLine", out JsonElement el) ? el.GetInt32() : sLine + 1) - 1;
-                                    int eCol = (region.TryGetProperty("endColumn", out JsonElement ec) ? ec.GetInt32() : sCol + 1) - 1;
+        private static string? ReadUri(ref Utf8JsonReader reader)
+        {
+            string? uri = null;
+            ReadObject(ref reader, (ref Utf8JsonReader r, string name) =>
+            {
+                if (name == "uri") uri = r.GetString();
+                else r.Skip();
+            });
+            return uri;
+        }
 
-                                    lock (file.Buffer.Server.FilesLock)
-                                    {
-                                        var targetFile = file.Buffer.Server.Files.FirstOrDefault(x =>
-                                            x.filename != null &&
-                                            string.Equals(Path.TryGetFullPath(x.filename)?.TrimEnd('\\', '/'), normError, StringComparison.OrdinalIgnoreCase)
-                                        );
-
-                                        if (targetFile != null)
-                                        {
-                                            long posStart = targetFile.Buffer.GetPosition(sLine, sCol);
-                                            long posEnd = targetFile.Buffer.GetPosition(eLine, eCol);
-
-                                            if (posEnd - posStart <= 1)
-                                            {
-                                                posEnd = Math.Min(posStart + 2, targetFile.Buffer.Text.Length);
-                                            }
-
-                                            List<FixItDataItem> fixIts = new();
-                                            if (result.TryGetProperty("fixes", out JsonElement fixesProp))
-                                            {
-                                                foreach (JsonElement fix in fixesProp.EnumerateArray())
-                                                {
-                                                    if (!fix.TryGetProperty("artifactChanges", out JsonElement changes)) continue;
-                                                    foreach (JsonElement change in changes.EnumerateArray())
-                                                    {
-                                                        if (change.TryGetProperty("artifactLocation", out JsonElement chLoc) &&
-                                                            chLoc.TryGetProperty("uri", out JsonElement chUri))
-                                                        {
-                                                            string cPath = new Uri(chUri.GetString()!).LocalPath;
-                                                            if (!string.Equals(Path.TryGetFullPath(cPath)?.TrimEnd('\\', '/'), normError, StringComparison.OrdinalIgnoreCase))
-                                                                continue;
-                                                        }
-
-                                                        if (change.TryGetProperty("replacements", out JsonElement replacements))
-                                                        {
-                                                            foreach (JsonElement rep in replacements.EnumerateArray())
-                                                            {
-                                                                if (rep.TryGetProperty("deletedRegion", out JsonElement delRegion))
-                                                                {
-                                                                    int rsL = delRegion.GetProperty("startLine").GetInt32() - 1;
-                                                                    int rsC = (delRegion.TryGetProperty("startColumn", out var cS) ? cS.GetInt32() : 1) - 1;
-
-                                                                    int reL = (delRegion.TryGetProperty("endLine", out var cEL) ? cEL.GetInt32() : rsL + 1) - 1;
-                                                                    int reC = (delRegion.TryGetProperty("endColumn", out var cEC) ? cEC.GetInt32() : rsC + 1) - 1;
-
-                                                                    string text = "";
-                                                                    if (rep.TryGetProperty("insertedContent", out JsonElement content))
-                                                                        text = content.GetProperty("text").GetString() ?? "";
-
-                                                                    fixIts.Add(new FixItDataItem(
-                                                                        targetFile.Buffer.GetPosition(rsL, rsC),
-                                                                        targetFile.Buffer.GetPosition(reL, reC),
-                                                                        text
-                                                                    ));
-                                                                }
-                                                            }
-                                                        }
-                                                    }
-                                                }
-                                            }
-
-
-                                            lock (targetFile.Buffer.ErrorMarksLock)
-                                            {
-                                                targetFile.Buffer.ErrorMarks.Add(new SarifErrorMark(
-                                                    currentState,
-                                                    msg,
-                                                    Math.Max(posStart, 0),
-                                                    posEnd,
-                                                    severity,
-                                                    $"::sarif-linter-mod::{file.filename}",
-                                                    fixIts.ToArray()
-                                                ));
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                        Logger.Log($"Linter {Linter.executable} finished, found errors.");
-                        break;
-                    }
-                    catch (OperationCanceledException) { process?.Kill(); Logger.Log(LogLevel.Error, "Linter timeout."); }
-                    catch (Exception ex) { process?.Kill(); Logger.Log(LogLevel.Error, $"Linter error: {ex.Message}"); }
+        /* missing start column is defaultColumn if it is 1 or more, end defaults to start */
+        private static SarifRange ReadRegion(ref Utf8JsonReader reader, int defaultColumn)
+        {
+            int? startLine = null, startColumn = null, endLine = null, endColumn = null;
+            ReadObject(ref reader, (ref Utf8JsonReader r, string name) =>
+            {
+                switch (name)
+                {
+                    case "startLine": startLine = r.GetInt32(); break;
+                    case "startColumn": startColumn = r.GetInt32(); break;
+                    case "endLine": endLine = r.GetInt32(); break;
+                    case "endColumn": endColumn = r.GetInt32(); break;
+                    default: r.Skip(); break;
                 }
             });
+            if (startLine == null) throw new JsonException("region without startLine");
+            if (startColumn == null && defaultColumn < 1) throw new JsonException("region without startColumn");
+            int sLine = startLine.Value - 1;
+            int sCol = (startColumn ?? defaultColumn) - 1;
+            return new(sLine, sCol, (endLine ?? sLine + 1) - 1, (endColumn ?? sCol + 1) - 1);
+        }
+
+        private static void ReadChange(ref Utf8JsonReader reader, List<(string? uri, SarifFix fix)> changes)
+        {
+            string? uri = null;
+            List<SarifFix> replacements = [];
+            ReadObject(ref reader, (ref Utf8JsonReader r, string name) =>
+            {
+                if (name == "artifactLocation") { uri = ReadUri(ref r); return; }
+                if (name != "replacements") { r.Skip(); return; }
+                ReadArray(ref r, (ref Utf8JsonReader replacement) =>
+                {
+                    SarifRange? deleted = null;
+                    string text = "";
+                    ReadObject(ref replacement, (ref Utf8JsonReader rep, string property) =>
+                    {
+                        if (property == "deletedRegion") deleted = ReadRegion(ref rep, 1);
+                        else if (property == "insertedContent")
+                        {
+                            ReadObject(ref rep, (ref Utf8JsonReader content, string contentProperty) =>
+                            {
+                                if (contentProperty == "text") text = content.GetString() ?? "";
+                                else content.Skip();
+                            });
+                        }
+                        else rep.Skip();
+                    });
+                    if (deleted != null) replacements.Add(new(deleted.Value, text));
+                });
+            });
+            foreach (var fix in replacements)
+            {
+                changes.Add((uri, fix));
+            }
         }
     }
 }
\ No newline at end of file
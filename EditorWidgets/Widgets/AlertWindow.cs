@@ -23,6 +23,13 @@ namespace EditorFramework.Widgets
             this.Buttons = buttons;
         }
 
+        protected override bool AddDrawState(ref HashCode state)
+        {
+            state.Add(Text);
+            state.Add(Selected);
+            return false;
+        }
+
         public override bool HandleEvent(EventBase e)
         {
             switch (e)
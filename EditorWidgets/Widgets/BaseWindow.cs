@@ -23,6 +23,7 @@ namespace EditorFramework.Widgets
         public BaseWindow? Parent = null;
         public OnQuitAction? OnQuit = null;
         public AfterPopupQuitAction? AfterPopupQuit = null;
+        private long damage = 0;
 
         public BaseWindow(IApplication app, ILayoutManager layout)
         {
@@ -54,6 +55,37 @@ namespace EditorFramework.Widgets
         {
         }
 
+        /* for changes which aren't seen in draw state, like results of background work */
+        public void MarkDirty()
+        {
+            Interlocked.Increment(ref damage);
+        }
+
+        /*
+            damage tracking: state of what window draws is added to state of frame, frame is drawn only when
+            it is changed. returns true when window has to be drawn on next frame anyway
+        */
+        public bool DrawState(ref HashCode state)
+        {
+            if (Popup != null)
+            {
+                return Popup.DrawState(ref state);
+            }
+            state.Add(GetType());
+            state.Add(Interlocked.Read(ref damage));
+            state.Add(Layout.Position.X);
+            state.Add(Layout.Position.Y);
+            state.Add(Layout.Position.W);
+            state.Add(Layout.Position.H);
+            return AddDrawState(ref state);
+        }
+
+        /* adds everything window is drawn from, containers add draw state of their children */
+        protected virtual bool AddDrawState(ref HashCode state)
+        {
+            return false;
+        }
+
         /// <summary>
         /// Handles given event
         /// </summary>
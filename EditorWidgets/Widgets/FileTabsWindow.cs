@@ -75,6 +75,19 @@ namespace EditorFramework.Widgets
             }
         }
 
+        protected override bool AddDrawState(ref HashCode state)
+        {
+            lock (childsLock)
+            {
+                state.Add(current);
+                foreach (var child in childs)
+                {
+                    state.Add(child.file.filename);
+                }
+                return Child?.DrawState(ref state) ?? false;
+            }
+        }
+
         public override bool HandleEvent(EventBase e)
         {
             switch (e)
@@ -55,6 +55,18 @@ namespace EditorFramework.Widgets
             }
         }
 
+        protected override bool AddDrawState(ref HashCode state)
+        {
+            bool animating = find.DrawState(ref state);
+            state.Add(find.resultBuffer);
+            state.Add(find.resultFile?.filename);
+            if (preview != null)
+            {
+                animating |= preview.DrawState(ref state);
+            }
+            return animating;
+        }
+
         public override bool HandleEvent(EventBase e)
         {
             switch (e)
@@ -34,6 +34,24 @@ namespace EditorFramework.Widgets
         }
 
 
+        protected override bool AddDrawState(ref HashCode state)
+        {
+            bool animating = base.AddDrawState(ref state);
+            state.Add(relativeNumbers);
+            state.Add(enteredLineNumber);
+            state.Add(jumpInput);
+            if (cursor != null)
+            {
+                state.Add(cursor.Selections.Count);
+                foreach (var selection in cursor.Selections)
+                {
+                    state.Add(selection.Begin);
+                    state.Add(selection.End);
+                }
+            }
+            return animating;
+        }
+
         [DllImport("user32.dll", EntryPoint = "keybd_event")]
         static extern void WinapiKeybdEvent(byte bVk, byte bScan, uint dwFlags, UIntPtr dwExtraInfo);
 
@@ -142,6 +160,17 @@ namespace EditorFramework.Widgets
                 case KeyChordEvent key when key.Is(KeyCode.A, KeyMode.Alt):
                     cursor?.Buffer.LoadCursorState();
                     break;
+                case KeyChordEvent key when key.Is(KeyCode.Z, KeyMode.Alt):
+                    wrapLines = !wrapLines;
+                    viewRow = 0;
+                    leftViewOffset = 0;
+                    if (!wrapLines)
+                    {
+                        /* index isn't updated by edits while no view wraps */
+                        wrapWidth = 0;
+                        buffer.GetWrapIndex(0);
+                    }
+                    return false;
                 case KeyChordEvent key when key.Is(KeyCode.D, KeyMode.Ctrl):
                     if (cursor != null)
                     {
@@ -216,6 +245,15 @@ namespace EditorFramework.Widgets
                         return false;
                     }
                     break;
+                case KeyChordEvent key when key.Is(KeyCode.E, KeyMode.Ctrl | KeyMode.Alt):
+                    /* edit where script handles every selection by itself, it runs by chunks in parallel */
+                    if (cursor != null)
+                    {
+                        var win = new PowerEditWindow(App, GetLayout<PowerEditWindow>.Value, cursor.Buffer.Server, cursor, "editEach");
+                        OpenPopup(new PowerEditWithPreviewWindow(App, GetLayout<PowerEditWithPreviewWindow>.Value, win));
+                        return false;
+                    }
+                    break;
                 case KeyChordEvent key when key.Is(KeyCode.E, KeyMode.Ctrl):
                     if (cursor != null)
                     {
@@ -359,7 +397,7 @@ namespace EditorFramework.Widgets
                         long? step = Layout.PageStepSize;
                         if (step != null)
                         {
-                            cursor?.Selections.MoveVertical(-step.Value, key.LastKey.Mode.HasFlag(KeyMode.Shift));
+                            MovePage(-step.Value, key.LastKey.Mode.HasFlag(KeyMode.Shift));
                             return false;
                         }
                     }
@@ -369,7 +407,7 @@ namespace EditorFramework.Widgets
                         long? step = Layout.PageStepSize;
                         if (step != null)
                         {
-                            cursor?.Selections.MoveVertical(step.Value, key.LastKey.Mode.HasFlag(KeyMode.Shift));
+                            MovePage(step.Value, key.LastKey.Mode.HasFlag(KeyMode.Shift));
                             return false;
                         }
                     }
@@ -701,6 +739,33 @@ namespace EditorFramework.Widgets
             return base.HandleEvent(e);
         }
 
+        /* page is step of rows on screen, with soft wrap it's step of visual rows found by wrap index */
+        private void MovePage(long step, bool withSelect)
+        {
+            if (cursor == null)
+            {
+                return;
+            }
+            if (wrapLines && wrapWidth > 0 && cursor.Selections.Count > 0)
+            {
+                var wrap = buffer.GetWrapIndex(wrapWidth);
+                var (line, offset) = buffer.GetPositionOffsets(cursor.Selections[0].End);
+                /* each line is at least one row, so rows of step are in these lines */
+                buffer.MeasureWrappedLines(line - Math.Abs(step), line + Math.Abs(step));
+                long rows = wrap.RowOfLine(line + 1) - wrap.RowOfLine(line);
+                long rowInLine = Math.Min(offset / wrapWidth, rows - 1);
+                var (target, targetRow) = wrap.LineOfRow(wrap.RowOfLine(line) + rowInLine + step);
+                /* page inside of long line moves by its rows */
+                if (target == line)
+                {
+                    cursor.Selections.MoveHorisontal((targetRow - rowInLine) * wrapWidth, withSelect);
+                    return;
+                }
+                step = target - line;
+            }
+            cursor.Selections.MoveVertical(step, withSelect);
+        }
+
         public static bool IsInternalInsert(string paste_data, IEnumerable<string> clip)
         {
             if (paste_data == null) return false;
@@ -748,16 +813,13 @@ namespace EditorFramework.Widgets
                 lock (buffer.ErrorMarksLock)
                 {
                     long mindiff = long.MaxValue;
-                    for (int i = 0; i < buffer.ErrorMarks.Count; ++i)
+                    foreach (var mark in buffer.ErrorMarks.Query(begin, end))
                     {
-                        if (begin <= buffer.ErrorMarks[i].End && buffer.ErrorMarks[i].Begin < end)
+                        long diff = Math.Abs(mark.Middle - selection.End);
+                        if (diff < mindiff)
                         {
-                            long diff = Math.Abs(buffer.ErrorMarks[i].Middle - selection.End);
-                            if (diff < mindiff)
-                            {
-                                mindiff = diff;
-                                currentMark = buffer.ErrorMarks[i];
-                            }
+                            mindiff = diff;
+                            currentMark = mark;
                         }
                     }
                 }
@@ -28,13 +28,20 @@ namespace EditorFramework.Widgets
         internal long currentHistoryPosition;
 
 
-        public (IEnumerable<string>?, string?) CurrentResult()
+        /* total length of preview arguments, editEach is executed by chunks in parallel so its preview takes more */
+        public const long MaxPreviewArgsSize = 16384;
+        public const long MaxEditEachPreviewArgsSize = 65536;
+        /* shown part of preview result, fits result of whole editEach budget */
+        public const int MaxPreviewResultSize = 65536;
+
+        /* partial gets results of leading part of arguments while editEach preview runs */
+        public (IEnumerable<string>?, string?) CurrentResult(CancellationToken cancel = default, Action<IEnumerable<string>>? partial = null)
         {
             if (editType == "powerEdit")
             {
                 var countToTake = Math.Min(usingCursor.Selections.Count, 128);
                 var selectionsToProcess = usingCursor.Selections.Take((int)countToTake).ToArray();
-                var res = buffer.Server.CommandProvider.Execute(buffer.Text.Substring(0), selectionsToProcess);
+                var res = buffer.Server.CommandProvider.Execute(buffer.Text.Substring(0), selectionsToProcess, cancel);
                 var results = res.Item1?.Select(x => x.ToString()).Where(x => x != null).Cast<string>() ?? [];
                 if (usingCursor.Selections.Count > 128)
                 {
@@ -54,10 +61,10 @@ namespace EditorFramework.Widgets
                     text = usingCursor.SelectionsText.ToArray();
                 }
                 long currentTotal = 0;
-                var limitedText = text.TakeWhile(s => { currentTotal += s.Length; return currentTotal <= 16384; }).ToArray();
+                var limitedText = text.TakeWhile(s => { currentTotal += s.Length; return currentTotal <= MaxPreviewArgsSize; }).ToArray();
 
                 bool isTruncated = limitedText.Length < text.Length;
-                var res = buffer.Server.CommandProvider.Execute(buffer.Text.Substring(0), limitedText);
+                var res = buffer.Server.CommandProvider.Execute(buffer.Text.Substring(0), limitedText, cancel);
                 var results = res.Item1?.Select(x => x?.ToString()).Where(x => x != null).Cast<string>() ?? [];
 
                 if (isTruncated)
@@ -70,9 +77,19 @@ namespace EditorFramework.Widgets
             {
                 var text = usingCursor.SelectionsText.ToArray();
                 long currentTotal = 0;
-                var limitedText = text.TakeWhile(s => { currentTotal += s.Length; return currentTotal <= 16384; }).ToArray();
+                long maxSize = editType == "editEach" ? MaxEditEachPreviewArgsSize : MaxPreviewArgsSize;
+                var limitedText = text.TakeWhile(s => { currentTotal += s.Length; return currentTotal <= maxSize; }).ToArray();
                 bool isTruncated = limitedText.Length < text.Length;
-                var res = buffer.Server.CommandProvider.Execute(buffer.Text.Substring(0), limitedText);
+                (IEnumerable<object>?, string?) res;
+                if (editType == "editEach")
+                {
+                    Action<IReadOnlyList<object>>? partialObjects = partial == null ? null : results => partial(results.Select(x => x?.ToString()).Where(x => x != null).Cast<string>());
+                    res = buffer.Server.CommandProvider.ExecutePartitioned(buffer.Text.Substring(0), limitedText, partialObjects, cancel);
+                }
+                else
+                {
+                    res = buffer.Server.CommandProvider.Execute(buffer.Text.Substring(0), limitedText, cancel);
+                }
                 var results = res.Item1?.Select(x => x?.ToString()).Where(x => x != null).Cast<string>() ?? [];
                 if (isTruncated)
                 {
@@ -108,6 +125,10 @@ namespace EditorFramework.Widgets
             {
                 usingCursor.ApplyCommand("replace", cmd);
             }
+            else if (editType == "editEach")
+            {
+                usingCursor.ApplyCommand("editEach", cmd);
+            }
             else
             {
                 usingCursor.ApplyCommand("edit", cmd);
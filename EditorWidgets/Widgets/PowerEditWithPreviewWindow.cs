@@ -20,6 +20,8 @@ namespace EditorFramework.Widgets
         public SimpleTextWindow preview;
         public DateTime lastDrawTime;
         public bool moditifed;
+        /* preview of older command text is cancelled when newer one starts */
+        private CancellationTokenSource? previewCancel;
 
         public PowerEditWithPreviewWindow(IApplication app, ILayoutManager layout, PowerEditWindow editor) : base(app, layout)
         {
@@ -33,30 +35,36 @@ namespace EditorFramework.Widgets
         public override void PreDraw()
         {
             base.PreDraw();
-            if ((DateTime.UtcNow - lastDrawTime).TotalSeconds > 1 && moditifed)
+            /* provider keeps interpreter running, so preview can follow typing closely */
+            if ((DateTime.UtcNow - lastDrawTime).TotalSeconds > 0.1 && moditifed)
             {
                 lastDrawTime = DateTime.UtcNow;
                 moditifed = false;
                 /* update result */
+                previewCancel?.Cancel();
+                previewCancel = new();
+                var cancel = previewCancel.Token;
 
                 Thread thread = new Thread(() =>
                 {
-                    (var res, string? error_string) = editor.CurrentResult();
+                    (var res, string? error_string) = editor.CurrentResult(cancel, partial =>
+                    {
+                        if (!cancel.IsCancellationRequested)
+                        {
+                            ShowResult(partial);
+                        }
+                    });
+                    if (cancel.IsCancellationRequested)
+                    {
+                        return;
+                    }
                     if (res == null)
                     {
                         preview.buffer.SetText($"-> Error:\n{error_string}");
                     }
                     else
                     {
-                        string text = string.Join('\n', res);
-                        if (text.Length > 4096)
-                        {
-                            preview.buffer.SetText("Too big result [>4KB]");
-                        }
-                        else
-                        {
-                            preview.buffer.SetText(text);
-                        }
+                        ShowResult(res);
                     }
                 });
                 thread.Start();
@@ -64,6 +72,36 @@ namespace EditorFramework.Widgets
         }
 
 
+        /* leading part of too big result is shown, so growing partial results of editEach stay visible */
+        private void ShowResult(IEnumerable<string> res)
+        {
+            const int MaxSize = PowerEditWindow.MaxPreviewResultSize;
+            StringBuilder text = new();
+            foreach (var line in res)
+            {
+                if (text.Length > 0)
+                {
+                    text.Append('\n');
+                }
+                if (line.Length > MaxSize - text.Length)
+                {
+                    text.Append(line, 0, MaxSize - text.Length);
+                    text.Append($"\n-> Too big result, cutted to {MaxSize / 1024}KB");
+                    break;
+                }
+                text.Append(line);
+            }
+            preview.buffer.SetText(text.ToString());
+        }
+
+        /* preview is updated by PreDraw, so window is drawn until update is started */
+        protected override bool AddDrawState(ref HashCode state)
+        {
+            bool animating = editor.DrawState(ref state);
+            animating |= preview.DrawState(ref state);
+            return animating || moditifed;
+        }
+
         public override bool HandleEvent(EventBase e)
         {
             switch (e)
@@ -106,6 +106,11 @@ namespace EditorFramework.Widgets
             }
         }
 
+        protected override bool AddDrawState(ref HashCode state)
+        {
+            return Child.DrawState(ref state);
+        }
+
         public override bool HandleEvent(EventBase e)
         {
             switch (e)
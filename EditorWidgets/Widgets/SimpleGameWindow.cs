@@ -20,138 +20,264 @@ namespace EditorFramework.Widgets
 {
     public class SimpleGameWindow : BaseWindow
     {
-        public class ChunkedGrid<T> where T : struct
+        /*
+            cells of field packed by 64 in word: chunk keeps 64 rows of known and alive bits, unknown cells are
+            shadow cells whose value is hashed from position and generation. step counts neighbours of whole
+            rows by bitwise adder, chunks are stepped in parallel and chunk is skipped while it and its
+            neighbours are fully known and didn't change on previous step
+        */
+        public class PackedGrid
         {
-            private const int ChunkSize = 16; // must be power of 2
-            private const int ChunkShift = 4; // log2(ChunkSize)
+            private const int ChunkSize = 64; // one row of chunk is one word
+            private const int ChunkShift = 6; // log2(ChunkSize)
             private const int ChunkMask = ChunkSize - 1;
             private const int CellsPerChunk = ChunkSize * ChunkSize;
 
-            private readonly Dictionary<(long, long), T?[]> Chunks = [];
+            /* less active chunks are stepped on calling thread */
+            private const int ParallelChunks = 4;
 
-            public void Clear()
+            private sealed class Chunk
             {
-                Chunks.Clear();
+                public ulong[] Known = new ulong[ChunkSize];
+                public ulong[] Alive = new ulong[ChunkSize];
+                public ulong[] Next = new ulong[ChunkSize];
+                public int KnownCount = 0;
+
+                /* alive cells were changed by last step or by setter */
+                public bool Changed = true;
+
+                public bool Full => KnownCount == CellsPerChunk;
+            }
+
+            /* rows -1..64 of stepped chunk with neighbour columns, per thread */
+            private sealed class Scratch
+            {
+                public readonly ulong[] Left = new ulong[ChunkSize + 2];
+                public readonly ulong[] Middle = new ulong[ChunkSize + 2];
+                public readonly ulong[] Right = new ulong[ChunkSize + 2];
+                public readonly Chunk?[] Around = new Chunk?[9];
             }
 
-            public T? this[long worldX, long worldY]
+            private readonly Dictionary<(long, long), Chunk> Chunks = [];
+            private readonly List<((long X, long Y) Position, Chunk Chunk)> Active = [];
+
+            public bool? this[long worldX, long worldY]
             {
                 get
                 {
-                    long cx = worldX >> ChunkShift;
-                    long cy = worldY >> ChunkShift;
-
-                    if (Chunks.TryGetValue((cx, cy), out T?[]? chunk))
+                    if (Chunks.TryGetValue((worldX >> ChunkShift, worldY >> ChunkShift), out Chunk? chunk))
                     {
-                        int lx = (int)(worldX & ChunkMask);
                         int ly = (int)(worldY & ChunkMask);
-                        return chunk[ly * ChunkSize + lx];
+                        ulong bit = 1UL << (int)(worldX & ChunkMask);
+                        if ((chunk.Known[ly] & bit) != 0)
+                        {
+                            return (chunk.Alive[ly] & bit) != 0;
+                        }
                     }
-                    return default;
+                    return null;
                 }
                 set
                 {
-                    long cx = worldX >> ChunkShift;
-                    long cy = worldY >> ChunkShift;
-
-                    int lx = (int)(worldX & ChunkMask);
+                    (long, long) position = (worldX >> ChunkShift, worldY >> ChunkShift);
                     int ly = (int)(worldY & ChunkMask);
-                    int arrayIndex = ly * ChunkSize + lx;
+                    ulong bit = 1UL << (int)(worldX & ChunkMask);
 
-                    bool hasChunk = Chunks.TryGetValue((cx, cy), out T?[]? chunk);
+                    if (!Chunks.TryGetValue(position, out Chunk? chunk))
+                    {
+                        if (value is null)
+                        {
+                            return;
+                        }
+                        chunk = new Chunk();
+                        Chunks[position] = chunk;
+                    }
 
                     if (value is null)
                     {
-                        if (hasChunk)
+                        if ((chunk.Known[ly] & bit) != 0)
                         {
-                            chunk![arrayIndex] = default;
+                            chunk.KnownCount--;
                         }
+                        chunk.Known[ly] &= ~bit;
+                        chunk.Alive[ly] &= ~bit;
                     }
                     else
                     {
-                        if (!hasChunk)
+                        if ((chunk.Known[ly] & bit) == 0)
                         {
-                            chunk = new T?[CellsPerChunk];
-                            Chunks[(cx, cy)] = chunk;
+                            chunk.KnownCount++;
                         }
-                        chunk![arrayIndex] = value;
+                        chunk.Known[ly] |= bit;
+                        chunk.Alive[ly] = value.Value ? chunk.Alive[ly] | bit : chunk.Alive[ly] & ~bit;
                     }
+                    chunk.Changed = true;
                 }
             }
-            public ref T? GetRef(long worldX, long worldY)
+
+            /* next generation of known cells, shadow gives value of unknown cell for this generation */
+            public void Step(Func<long, long, bool> shadow)
             {
-                long cx = worldX >> ChunkShift;
-                long cy = worldY >> ChunkShift;
+                Active.Clear();
+                foreach (var (position, chunk) in Chunks)
+                {
+                    if (chunk.KnownCount != 0 && !IsStable(position, chunk))
+                    {
+                        Active.Add((position, chunk));
+                    }
+                }
 
-                if (!Chunks.TryGetValue((cx, cy), out var chunk))
+                /* chunks read alive cells of neighbours and write only their own next cells */
+                if (Active.Count < ParallelChunks)
+                {
+                    Scratch scratch = new();
+                    foreach (var (position, chunk) in Active)
+                    {
+                        StepChunk(position, chunk, scratch, shadow);
+                    }
+                }
+                else
                 {
-                    throw new Exception("Invalid chunk");
+                    Parallel.For(0, Active.Count, () => new Scratch(), (i, _, scratch) =>
+                    {
+                        StepChunk(Active[i].Position, Active[i].Chunk, scratch, shadow);
+                        return scratch;
+                    }, _ => { });
                 }
 
-                int idx = (int)(worldY & ChunkMask) * ChunkSize + (int)(worldX & ChunkMask);
-                if (chunk[idx] is null)
+                foreach (var (_, chunk) in Active)
                 {
-                    throw new NullReferenceException();
+                    (chunk.Alive, chunk.Next) = (chunk.Next, chunk.Alive);
                 }
-                return ref chunk[idx];
             }
 
-
-            public IEnumerable<(long X, long Y, T Value)> GetAllCells()
+            /* neighbourhood of chunk is known and was the same on previous step, so step keeps chunk as is */
+            private bool IsStable((long X, long Y) position, Chunk chunk)
             {
-                foreach ((var position, T?[] chunk) in Chunks)
+                if (chunk.Changed || !chunk.Full)
                 {
-                    long x = 0, y = 0;
-                    for (int i = 0; i < CellsPerChunk; i++)
+                    return false;
+                }
+                for (long dy = -1; dy <= 1; dy++)
+                {
+                    for (long dx = -1; dx <= 1; dx++)
                     {
-                        T? cell = chunk[i];
-                        if (cell is not null)
+                        if ((dx != 0 || dy != 0) &&
+                            (!Chunks.TryGetValue((position.X + dx, position.Y + dy), out Chunk? near) || near.Changed || !near.Full))
                         {
-                            yield return (position.Item1 * ChunkSize + x, position.Item2 * ChunkSize + y, cell.Value);
+                            return false;
                         }
-                        if (++x == ChunkSize) { x = 0; y++; }
                     }
                 }
+                return true;
             }
 
-            public IEnumerable<(long X, long Y, T? Value)> GetChunkedCells(long centerX, long centerY, int radius, bool isManhattan = false)
+            private void StepChunk((long X, long Y) position, Chunk chunk, Scratch scratch, Func<long, long, bool> shadow)
             {
-                long minX = centerX - radius;
-                long maxX = centerX + radius;
-                long minY = centerY - radius;
-                long maxY = centerY + radius;
+                for (int dy = -1; dy <= 1; dy++)
+                {
+                    for (int dx = -1; dx <= 1; dx++)
+                    {
+                        Chunks.TryGetValue((position.X + dx, position.Y + dy), out scratch.Around[(dy + 1) * 3 + dx + 1]);
+                    }
+                }
+
+                long worldX = position.X * ChunkSize;
+                long worldY = position.Y * ChunkSize;
+                for (int row = -1; row <= ChunkSize; row++)
+                {
+                    LoadRow(chunk, scratch, row, worldX, worldY + row, shadow);
+                }
+
+                chunk.Changed = CountNeighbours(chunk.Known, chunk.Alive, chunk.Next, scratch);
+            }
+
+            /*
+                row of stepped chunk (or of its neighbour chunk for rows -1 and 64) where unknown cells are replaced
+                by shadow values. shadow is hashed only for cells next to known cells of stepped chunk, other
+                cells of row don't matter for step
+            */
+            private static void LoadRow(Chunk chunk, Scratch scratch, int row, long worldX, long worldY, Func<long, long, bool> shadow)
+            {
+                ulong near = 0;
+                for (int y = Math.Max(row - 1, 0); y <= Math.Min(row + 1, ChunkMask); y++)
+                {
+                    near |= chunk.Known[y];
+                }
+
+                int index = row + 1;
+                if (near == 0)
+                {
+                    scratch.Left[index] = scratch.Middle[index] = scratch.Right[index] = 0;
+                    return;
+                }
+
+                int around = (row < 0 ? 0 : row > ChunkMask ? 2 : 1) * 3;
+                int local = row & ChunkMask;
 
-                long minChunkX = minX >> ChunkShift;
-                long maxChunkX = maxX >> ChunkShift;
-                long minChunkY = minY >> ChunkShift;
-                long maxChunkY = maxY >> ChunkShift;
+                ulong middle = ReadCells(scratch.Around[around + 1], local, near | (near << 1) | (near >> 1), worldX, worldY, shadow);
+                ulong west = (near & 1) != 0 ? ReadCells(scratch.Around[around], local, 1UL << ChunkMask, worldX - ChunkSize, worldY, shadow) >> ChunkMask : 0;
+                ulong east = (near >> ChunkMask) != 0 ? ReadCells(scratch.Around[around + 2], local, 1, worldX + ChunkSize, worldY, shadow) : 0;
 
-                for (long cx = minChunkX; cx <= maxChunkX; cx++)
+                /* bit x of left word is cell x - 1, bit x of right word is cell x + 1 */
+                scratch.Middle[index] = middle;
+                scratch.Left[index] = (middle << 1) | west;
+                scratch.Right[index] = (middle >> 1) | (east << ChunkMask);
+            }
+
+            /* cells of mask in row of chunk, missing chunk is unknown */
+            private static ulong ReadCells(Chunk? chunk, int row, ulong mask, long worldX, long worldY, Func<long, long, bool> shadow)
+            {
+                ulong known = chunk?.Known[row] ?? 0;
+                ulong cells = (chunk?.Alive[row] ?? 0) & mask;
+                for (ulong unknown = mask & ~known; unknown != 0; unknown &= unknown - 1)
                 {
-                    for (long cy = minChunkY; cy <= maxChunkY; cy++)
+                    int x = BitOperations.TrailingZeroCount(unknown);
+                    if (shadow(worldX + x, worldY))
                     {
-                        if (isManhattan)
-                        {
-                            if (Math.Abs(cx - (centerX >> ChunkShift)) + Math.Abs(cy - (centerY >> ChunkShift)) > (radius >> ChunkShift) + 2)
-                            {
-                                continue;
-                            }
-                        }
-                        if (Chunks.TryGetValue((cx, cy), out T?[]? chunk))
-                        {
-                            long x = 0, y = 0;
-                            for (int i = 0; i < CellsPerChunk; i++)
-                            {
-                                T? cell = chunk[i];
-                                if (cell is not null)
-                                {
-                                    yield return (cx + x, cy + y, cell);
-                                }
-                                if (++x == ChunkSize) { x = 0; y++; }
-                            }
-                        }
+                        cells |= 1UL << x;
                     }
                 }
+                return cells;
+            }
+
+            /*
+                eight neighbour words are summed by bits into 3 bit counter, count 8 wraps to 0 which neither
+                keeps nor makes cell alive. rows are independent, so several rows are counted by one vector
+            */
+            private static bool CountNeighbours(ulong[] known, ulong[] alive, ulong[] next, Scratch scratch)
+            {
+                ulong[] left = scratch.Left;
+                ulong[] middle = scratch.Middle;
+                ulong[] right = scratch.Right;
+                bool changed = false;
+                for (int y = 0; y < ChunkSize; y += Vector<ulong>.Count)
+                {
+                    Vector<ulong> bit0 = Vector<ulong>.Zero, bit1 = Vector<ulong>.Zero, bit2 = Vector<ulong>.Zero;
+                    Add(ref bit0, ref bit1, ref bit2, new Vector<ulong>(left, y));
+                    Add(ref bit0, ref bit1, ref bit2, new Vector<ulong>(middle, y));
+                    Add(ref bit0, ref bit1, ref bit2, new Vector<ulong>(right, y));
+                    Add(ref bit0, ref bit1, ref bit2, new Vector<ulong>(left, y + 1));
+                    Add(ref bit0, ref bit1, ref bit2, new Vector<ulong>(right, y + 1));
+                    Add(ref bit0, ref bit1, ref bit2, new Vector<ulong>(left, y + 2));
+                    Add(ref bit0, ref bit1, ref bit2, new Vector<ulong>(middle, y + 2));
+                    Add(ref bit0, ref bit1, ref bit2, new Vector<ulong>(right, y + 2));
+
+                    /* alive cell stays alive with 2 or 3 neighbours, dead cell becomes alive with 3 */
+                    Vector<ulong> was = new(alive, y);
+                    Vector<ulong> now = new Vector<ulong>(known, y) & bit1 & ~bit2 & (bit0 | was);
+                    now.CopyTo(next, y);
+                    changed |= now != was;
+                }
+                return changed;
+            }
+
+            private static void Add(ref Vector<ulong> bit0, ref Vector<ulong> bit1, ref Vector<ulong> bit2, Vector<ulong> value)
+            {
+                Vector<ulong> carry0 = bit0 & value;
+                bit0 ^= value;
+                Vector<ulong> carry1 = bit1 & carry0;
+                bit1 ^= carry0;
+                bit2 ^= carry1;
             }
         }
 
@@ -177,8 +303,7 @@ namespace EditorFramework.Widgets
 
 
 
-        public ChunkedGrid<bool> Grid = new();
-        public ChunkedGrid<bool> NewGrid = new();
+        public PackedGrid Grid = new();
         public Vector2Int Position;
         public Vector2Int nextPosition;
         private Task? directionKeyPressTask = null;
@@ -333,6 +458,15 @@ namespace EditorFramework.Widgets
             }
         }
 
+        /* camera of field follows player by frames, so field is drawn on every frame */
+        protected override bool AddDrawState(ref HashCode state)
+        {
+            state.Add(GameResult);
+            state.Add(GameHardness);
+            state.Add(MaxScore);
+            return GameResult != GameResultType.HelpScreen;
+        }
+
         public override bool HandleEvent(EventBase e)
         {
 
@@ -733,44 +867,7 @@ namespace EditorFramework.Widgets
             if (GameResult != GameResultType.Playing) return;
 
             GridGeneration++;
-
-            NewGrid.Clear();
-
-            foreach (var x in Grid.GetAllCells())
-            {
-                /* check all neibours */
-                long count = 0;
-                for (int dx = -1; dx <= 1; ++dx)
-                {
-                    for (int dy = -1; dy <= 1; ++dy)
-                    {
-                        if (dx != 0 || dy != 0)
-                        {
-                            var cell = Grid[x.X + dx, x.Y + dy];
-                            if (cell is not null)
-                            {
-                                count += cell.Value ? 1 : 0; 
-                            }
-                            else
-                            {
-                                count += ShadowValue(x.X + dx, x.Y + dy) ? 1 : 0;
-                            }
-                        }
-                    }
-                }
-
-                /* update cell */
-                if (x.Value == true)
-                {
-                    NewGrid[x.X, x.Y] = count <= 3 && count >= 2;
-                }
-                else
-                {
-                    NewGrid[x.X, x.Y] = count == 3;
-                }
-            }
-
-            (Grid, NewGrid) = (NewGrid, Grid);
+            Grid.Step(ShadowValue);
         }
     }
 }
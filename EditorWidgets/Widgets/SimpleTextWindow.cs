@@ -21,11 +21,30 @@ namespace EditorFramework.Widgets
         public double leftViewOffset = 0;
         public bool showNumbers = true;
 
+        /* soft wrap: view begins at row viewRow of line viewOffset, renderer sets wrapWidth to its columns */
+        public bool wrapLines = false;
+        public long viewRow = 0;
+        public long wrapWidth = 0;
+
         public SimpleTextWindow(IApplication App, ILayoutManager layout, EditorBuffer buffer) : base(App, layout)
         {
             this.buffer = buffer;
         }
 
+        protected override bool AddDrawState(ref HashCode state)
+        {
+            state.Add(buffer.Text.CurrentState);
+            state.Add(buffer.Text.Length);
+            state.Add(buffer.Tokens);
+            state.Add(buffer.ErrorMarks.Epoch);
+            state.Add(viewOffset);
+            state.Add(leftViewOffset);
+            state.Add(showNumbers);
+            state.Add(wrapLines);
+            state.Add(viewRow);
+            return false;
+        }
+
         public override bool HandleEvent(EventBase e)
         {
             switch (e)
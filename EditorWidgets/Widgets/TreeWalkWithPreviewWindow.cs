@@ -57,6 +57,17 @@ namespace EditorFramework.Widgets
         }
 
 
+        /* preview is updated by PreDraw, so window is drawn until update is started */
+        protected override bool AddDrawState(ref HashCode state)
+        {
+            bool animating = tree.DrawState(ref state);
+            lock (previewLock)
+            {
+                animating |= preview.DrawState(ref state);
+            }
+            return animating || moditifed;
+        }
+
         public override bool HandleEvent(EventBase e)
         {
             switch (e)
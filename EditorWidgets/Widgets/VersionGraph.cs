@@ -0,0 +1,366 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Numerics;
+using System.Runtime.CompilerServices;
+using TextBuffer;
+
+namespace EditorFramework.Widgets
+{
+    /*
+        version tree of text buffer shown by TreeWalkWindow. it's kept between openings of window and updated by
+        changes of version graph since previous update. subtree is laid out relative to its parent, so change
+        lays out again only nodes on path from it to root, rows of nodes by depth let view find visible nodes
+    */
+    public sealed class VersionGraph
+    {
+        public class Node(IntPtr id)
+        {
+            /* navigation fields */
+            public Node? up;
+            public Node? right;
+            public Node? left;
+            public Node? down;
+            /* visible children and versions linked in text buffer */
+            public List<Node> childs = [];
+            public List<Node> parents = [];
+            public List<Node> children = [];
+
+            public int depth;
+            public IntPtr id = id;
+            public string? name;
+            public bool hidden = false;
+            public string Label => name ?? id.ToString();
+            public Vector2 position;
+            public DateTime? Date;
+
+            /* subtree takes width columns from offset after left edge of parent subtree, node is at center of it */
+            public float width = 1.0f;
+            public float offset = 0.0f;
+            public float center = 0.0f;
+        }
+
+        private static readonly ConditionalWeakTable<IUndoTextBuffer, VersionGraph> Graphs = new();
+
+        public readonly Dictionary<IntPtr, Node> Nodes = [];
+        public readonly List<Node> Roots = [];
+
+        private readonly IUndoTextBuffer Buffer;
+        private readonly HashSet<IntPtr> Initials;
+        private readonly HashSet<Node> Dirty = [];
+        private readonly List<List<Node>> Rows = [];
+        private long since = 0;
+        private bool anyHidden = false;
+
+        private VersionGraph(IUndoTextBuffer buffer)
+        {
+            Buffer = buffer;
+            Initials = [.. buffer.GetInitialVersions()];
+        }
+
+        /* graph of buffer with changes made since it was used last time */
+        public static VersionGraph Of(IUndoTextBuffer buffer)
+        {
+            VersionGraph graph = Graphs.GetValue(buffer, x => new VersionGraph(x));
+            graph.Update();
+            return graph;
+        }
+
+        public void Update()
+        {
+            var (next, changes, children) = Buffer.GetVersionChanges(since);
+            since = next;
+            if (changes.Length == 0)
+            {
+                return;
+            }
+            int first = 0;
+            foreach (var change in changes)
+            {
+                Node node = Get(change.State);
+                if (change.MergedTo != IntPtr.Zero)
+                {
+                    Remove(node);
+                    continue;
+                }
+                SetChildren(node, children.AsSpan(first, (int)change.ChildrenCount));
+                first += (int)change.ChildrenCount;
+            }
+            if (anyHidden)
+            {
+                Rebuild();
+                return;
+            }
+            foreach (Node node in Dirty)
+            {
+                /* layout of ancestors changes only while layout of their subtree does, steps are limited for merged cycles */
+                int steps = 0;
+                for (Node? n = node; n != null && steps++ < Nodes.Count && Measure(n); n = n.up)
+                {
+                }
+            }
+            Dirty.Clear();
+            Place();
+        }
+
+        /* visible tree is built again from links of versions, after hidden nodes were changed */
+        public void Rebuild()
+        {
+            anyHidden = false;
+            Roots.Clear();
+            foreach (Node node in Nodes.Values)
+            {
+                node.childs.Clear();
+                node.up = null;
+                anyHidden |= node.hidden;
+            }
+            foreach (Node node in Nodes.Values)
+            {
+                if (node.hidden)
+                {
+                    continue;
+                }
+                node.up = VisibleParent(node);
+                if (node.up == null)
+                {
+                    Roots.Add(node);
+                }
+                else
+                {
+                    node.up.childs.Add(node);
+                }
+            }
+            foreach (Node node in Nodes.Values)
+            {
+                node.childs.Sort((x, y) => x.id.CompareTo(y.id));
+            }
+            /* children are measured before their parents */
+            List<Node> order = [];
+            Walk(order);
+            for (int i = order.Count - 1; i >= 0; i--)
+            {
+                Measure(order[i]);
+            }
+            Dirty.Clear();
+            Place();
+        }
+
+        /* visible nodes of rows from minY to maxY with X from minX to maxX, row by row */
+        public void NodesIn(float minX, float maxX, float minY, float maxY, List<Node> result)
+        {
+            result.Clear();
+            int firstRow = (int)Math.Max(0, Math.Floor(minY)), lastRow = (int)Math.Min(Rows.Count - 1, Math.Ceiling(maxY));
+            for (int row = firstRow; row <= lastRow; row++)
+            {
+                List<Node> nodes = Rows[row];
+                int left = 0, right = nodes.Count;
+                while (left < right)
+                {
+                    int mid = (left + right) / 2;
+                    if (nodes[mid].position.X < minX) left = mid + 1;
+                    else right = mid;
+                }
+                for (int i = left; i < nodes.Count && nodes[i].position.X <= maxX; i++)
+                {
+                    result.Add(nodes[i]);
+                }
+            }
+        }
+
+        private Node Get(IntPtr id)
+        {
+            if (!Nodes.TryGetValue(id, out Node? node))
+            {
+                node = new Node(id);
+                Nodes[id] = node;
+                Roots.Add(node);
+                Dirty.Add(node);
+            }
+            return node;
+        }
+
+        private void SetChildren(Node node, ReadOnlySpan<IntPtr> ids)
+        {
+            List<Node> children = new(ids.Length);
+            foreach (IntPtr id in ids)
+            {
+                children.Add(Get(id));
+            }
+            foreach (Node child in node.children)
+            {
+                if (!children.Contains(child))
+                {
+                    child.parents.Remove(node);
+                    Reattach(child);
+                }
+            }
+            foreach (Node child in children)
+            {
+                if (!node.children.Contains(child))
+                {
+                    /* version opened from file is main parent of its children */
+                    child.parents.Insert(Initials.Contains(node.id) ? 0 : child.parents.Count, node);
+                    Reattach(child);
+                }
+            }
+            node.children = children;
+        }
+
+        /* merged version leaves graph, version it's merged into gets its links by its own change */
+        private void Remove(Node node)
+        {
+            foreach (Node child in node.children)
+            {
+                child.parents.Remove(node);
+                Reattach(child);
+            }
+            foreach (Node parent in node.parents)
+            {
+                parent.children.Remove(node);
+            }
+            node.children.Clear();
+            node.parents.Clear();
+            Detach(node);
+            Nodes.Remove(node.id);
+            Dirty.Remove(node);
+        }
+
+        /* node is moved under its main parent */
+        private void Reattach(Node node)
+        {
+            Node? up = node.parents.Count > 0 ? node.parents[0] : null;
+            if (up == node.up)
+            {
+                return;
+            }
+            Detach(node);
+            node.up = up;
+            if (up == null)
+            {
+                Roots.Add(node);
+                return;
+            }
+            int index = up.childs.BinarySearch(node, Comparer<Node>.Create((x, y) => x.id.CompareTo(y.id)));
+            up.childs.Insert(index < 0 ? ~index : index, node);
+            Dirty.Add(up);
+        }
+
+        private void Detach(Node node)
+        {
+            if (node.up == null)
+            {
+                Roots.Remove(node);
+            }
+            else
+            {
+                node.up.childs.Remove(node);
+                Dirty.Add(node.up);
+            }
+            node.up = null;
+        }
+
+        private static Node? VisibleParent(Node node)
+        {
+            Node? parent = node.parents.Count > 0 ? node.parents[0] : null;
+            while (parent != null && parent.hidden)
+            {
+                parent = parent.parents.Count > 0 ? parent.parents[0] : null;
+            }
+            return parent;
+        }
+
+        /* lays out children of node relative to it, returns whether width or center of node changed */
+        private static bool Measure(Node node)
+        {
+            float left = 0.0f, sum = 0.0f;
+            for (int i = 0; i < node.childs.Count; i++)
+            {
+                Node child = node.childs[i];
+                child.offset = left;
+                child.left = i > 0 ? node.childs[i - 1] : null;
+                child.right = i + 1 < node.childs.Count ? node.childs[i + 1] : null;
+                sum += left + child.center;
+                left += child.width;
+            }
+            float width = Math.Max(1.0f, left);
+            float center = node.childs.Count == 0 ? 0.0f : sum / node.childs.Count;
+
+            /* add 0.01f to select rightmost from all */
+            node.down = null;
+            float best = float.MaxValue;
+            foreach (Node child in node.childs)
+            {
+                float distance = Math.Abs(child.offset + child.center - center - 0.01f);
+                if (distance <= best)
+                {
+                    best = distance;
+                    node.down = child;
+                }
+            }
+
+            bool changed = width != node.width || center != node.center;
+            node.width = width;
+            node.center = center;
+            return changed;
+        }
+
+        /* visible nodes from roots, parents before children and left subtrees before right ones */
+        private void Walk(List<Node> order)
+        {
+            HashSet<Node> used = [];
+            Stack<Node> stack = new();
+            for (int i = Roots.Count - 1; i >= 0; i--)
+            {
+                stack.Push(Roots[i]);
+            }
+            while (stack.Count > 0)
+            {
+                Node node = stack.Pop();
+                if (!used.Add(node))
+                {
+                    continue;
+                }
+                order.Add(node);
+                for (int i = node.childs.Count - 1; i >= 0; i--)
+                {
+                    stack.Push(node.childs[i]);
+                }
+            }
+        }
+
+        /* absolute positions from relative layout, nodes of each row are ordered by X */
+        private void Place()
+        {
+            float left = 0.0f;
+            for (int i = 0; i < Roots.Count; i++)
+            {
+                Node root = Roots[i];
+                root.offset = left;
+                root.left = i > 0 ? Roots[i - 1] : null;
+                root.right = i + 1 < Roots.Count ? Roots[i + 1] : null;
+                root.depth = 0;
+                root.position = new(left + root.center, 0.0f);
+                left += root.width;
+            }
+            foreach (List<Node> row in Rows)
+            {
+                row.Clear();
+            }
+            List<Node> order = [];
+            Walk(order);
+            foreach (Node node in order)
+            {
+                if (node.up != null)
+                {
+                    node.depth = node.up.depth + 1;
+                    float edge = node.up.position.X - node.up.center + node.offset;
+                    node.position = new(edge + node.center, node.depth);
+                }
+                while (Rows.Count <= node.depth)
+                {
+                    Rows.Add([]);
+                }
+                Rows[node.depth].Add(node);
+            }
+        }
+    }
+}
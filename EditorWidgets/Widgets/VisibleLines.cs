@@ -0,0 +1,226 @@
+﻿using Common;
+using System;
+using System.Buffers;
+using System.Text;
+
+namespace EditorFramework.Widgets
+{
+    /*
+        lines of view read by renderer in one call per frame. buffers are rented from pool and kept between
+        frames, they are rented again only when view gets bigger. scrolled view reads only visible columns of
+        lines, so horizontal scroll deep into long line costs the same as at its begin. wrapped view reads
+        only rows of lines it shows and cuts them at width columns
+    */
+    public sealed class VisibleLines : IDisposable
+    {
+        private long[] lines = [];
+        private byte[] text = [];
+        private int[] starts = [];
+        private int[] columns = [];
+        private long[] rowLines = [];
+        private int[] rowsInLine = [];
+        private byte[] scratch = [];
+        private readonly long[] slice = new long[2];
+
+        /* rows of view before first line of text, view starts at negative line */
+        public int FirstRow { get; private set; } = 0;
+
+        /* row of view after the last one with text */
+        public int EndRow { get; private set; } = 0;
+
+        /* column of lines view starts at */
+        public long FirstColumn { get; private set; } = 0;
+
+        /* reads rows of view which starts at firstLine and firstColumn, returns EndRow */
+        public int Read(IEditorBuffer buffer, long firstLine, int rows, int maxColumns, long firstColumn = 0)
+        {
+            firstColumn = Math.Max(firstColumn, 0);
+            FirstRow = (int)Math.Clamp(-firstLine, 0, Math.Max(rows, 0));
+            int count = Math.Max(rows, 0) - FirstRow;
+            maxColumns = Math.Max(maxColumns, 1);
+            Reserve(count, count * maxColumns);
+
+            int read = count > 0 ? buffer.ReadLines(firstLine + FirstRow, count, firstColumn, maxColumns, lines, text) : 0;
+            int start = 0;
+            for (int i = 0; i < read; i++)
+            {
+                int length = (int)lines[2 * i + 1];
+                /* slice starts after continuation bytes of character cut by first column, ends before cut one */
+                int skip = 0;
+                while (skip < length && (text[start + skip] & 0xC0) == 0x80)
+                {
+                    skip++;
+                }
+                starts[i] = start + skip;
+                columns[i] = skip;
+                lines[2 * i] += skip;
+                lines[2 * i + 1] = TrimmedLength(text.AsSpan(start + skip, length - skip));
+                rowLines[i] = firstLine + FirstRow + i;
+                rowsInLine[i] = 0;
+                start += length;
+            }
+            FirstColumn = firstColumn;
+            EndRow = FirstRow + read;
+            return EndRow;
+        }
+
+        /*
+            reads rows of view which starts at row firstRowInLine of firstLine, lines are cut into rows of width
+            columns at first character which begins at width * n column or after it. returns EndRow
+        */
+        public int ReadWrapped(IEditorBuffer buffer, long firstLine, long firstRowInLine, int rows, int width)
+        {
+            width = Math.Max(width, 1);
+            FirstRow = (int)Math.Clamp(-firstLine, 0, Math.Max(rows, 0));
+            int count = Math.Max(rows, 0) - FirstRow;
+            /* row ends at most 3 bytes after its width, 4 more are read to see where character cut by end begins */
+            Reserve(count, count * (width + 3) + 1);
+            long readColumns = (long)count * width + 4;
+            if (scratch.Length < readColumns + 1)
+            {
+                if (scratch.Length > 0)
+                {
+                    ArrayPool<byte>.Shared.Return(scratch);
+                }
+                scratch = ArrayPool<byte>.Shared.Rent((int)readColumns + 1);
+            }
+
+            long line = Math.Max(firstLine, 0);
+            long rowInLine = firstLine < 0 ? 0 : Math.Max(firstRowInLine, 0);
+            int row = 0, start = 0;
+            while (row < count)
+            {
+                long firstColumn = rowInLine * width;
+                long maxColumns = (long)(count - row) * width + 4;
+                if (buffer.ReadLines(line, 1, firstColumn, maxColumns, slice, scratch) == 0)
+                {
+                    break;
+                }
+                int length = (int)slice[1];
+                bool cut = length == maxColumns;
+                if (!cut && length > 0 && scratch[length - 1] == (byte)'\n')
+                {
+                    length--;
+                }
+                /* row k of slice begins at first character at byte k * width or after it */
+                int begin = 0;
+                while (begin < length && (scratch[begin] & 0xC0) == 0x80)
+                {
+                    begin++;
+                }
+                for (long k = 0; row < count && (k == 0 || k * width < length); k++, row++)
+                {
+                    int end = (int)Math.Min((k + 1) * width, length);
+                    while (end < length && (scratch[end] & 0xC0) == 0x80)
+                    {
+                        end++;
+                    }
+                    int size = Math.Max(end - begin, 0);
+                    if (cut && end == length)
+                    {
+                        size = TrimmedLength(scratch.AsSpan(begin, size));
+                    }
+                    scratch.AsSpan(begin, size).CopyTo(text.AsSpan(start));
+                    lines[2 * row] = slice[0] + begin;
+                    lines[2 * row + 1] = size;
+                    starts[row] = start;
+                    columns[row] = (int)(firstColumn + begin);
+                    rowLines[row] = line;
+                    rowsInLine[row] = (int)(rowInLine + k);
+                    start += size;
+                    begin = Math.Max(begin, end);
+                }
+                line++;
+                rowInLine = 0;
+            }
+            FirstColumn = 0;
+            EndRow = FirstRow + row;
+            return EndRow;
+        }
+
+        /* line shown at row of view and row of that line */
+        public long Line(int row) => rowLines[row - FirstRow];
+
+        public int RowInLine(int row) => rowsInLine[row - FirstRow];
+
+        /* offset in text of first byte shown at row of view */
+        public long Offset(int row) => lines[2 * (row - FirstRow)];
+
+        /* column of line shown at first byte of row */
+        public long Column(int row) => FirstColumn + columns[row - FirstRow];
+
+        public ReadOnlySpan<byte> Bytes(int row) => text.AsSpan(starts[row - FirstRow], (int)lines[2 * (row - FirstRow) + 1]);
+
+        public string Text(int row) => Encoding.UTF8.GetString(Bytes(row));
+
+        /* length without utf8 sequence which is cut by end of slice */
+        private static int TrimmedLength(ReadOnlySpan<byte> bytes)
+        {
+            int lead = bytes.Length - 1;
+            while (lead >= 0 && bytes.Length - lead < 4 && (bytes[lead] & 0xC0) == 0x80)
+            {
+                lead--;
+            }
+            if (lead < 0 || bytes[lead] < 0xC0)
+            {
+                return bytes.Length;
+            }
+            int size = bytes[lead] >= 0xF0 ? 4 : bytes[lead] >= 0xE0 ? 3 : 2;
+            return lead + size > bytes.Length ? lead : bytes.Length;
+        }
+
+        private void Reserve(int count, int bytes)
+        {
+            if (lines.Length < 2 * count)
+            {
+                Return();
+                lines = ArrayPool<long>.Shared.Rent(2 * count);
+                starts = ArrayPool<int>.Shared.Rent(count);
+                columns = ArrayPool<int>.Shared.Rent(count);
+                rowLines = ArrayPool<long>.Shared.Rent(count);
+                rowsInLine = ArrayPool<int>.Shared.Rent(count);
+            }
+            if (text.Length < bytes)
+            {
+                if (text.Length > 0)
+                {
+                    ArrayPool<byte>.Shared.Return(text);
+                }
+                text = ArrayPool<byte>.Shared.Rent(bytes);
+            }
+        }
+
+        private void Return()
+        {
+            if (lines.Length > 0)
+            {
+                ArrayPool<long>.Shared.Return(lines);
+                ArrayPool<int>.Shared.Return(starts);
+                ArrayPool<int>.Shared.Return(columns);
+                ArrayPool<long>.Shared.Return(rowLines);
+                ArrayPool<int>.Shared.Return(rowsInLine);
+            }
+            lines = [];
+            starts = [];
+            columns = [];
+            rowLines = [];
+            rowsInLine = [];
+        }
+
+        public void Dispose()
+        {
+            Return();
+            if (text.Length > 0)
+            {
+                ArrayPool<byte>.Shared.Return(text);
+            }
+            text = [];
+            if (scratch.Length > 0)
+            {
+                ArrayPool<byte>.Shared.Return(scratch);
+            }
+            scratch = [];
+            FirstRow = EndRow = 0;
+        }
+    }
+}
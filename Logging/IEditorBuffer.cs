@@ -41,6 +41,10 @@ namespace Common
 
         public long GetPosition(long line, long col);
 
+        public long[] GetPositions(long[] lineColumns);
+
+        public int ReadLines(long firstLine, int count, long firstColumn, long maxColumns, long[] lines, byte[] buffer);
+
         public (long begin, long length) GetLineOffsets(long line);
 
         public void Commit();
@@ -21,8 +21,11 @@ namespace Common
         public string Source { get; }
         public long Middle => (Begin + End) / 2;
 
-        public bool UpdateAfterDelete(long position, long count); // bool = is alive
-        public bool UpdateAfterInsert(long position, long count); // bool = is alive
+        /*
+            positions besides Begin and End which move with text (ranges of fix-its). store keeps them with Begin
+            and End and sets them back when mark is returned, setter copies values
+        */
+        public long[] DependentPositions { get => []; set { } }
 
         public bool IsFixItAvailable(IEditorBuffer buffer);
         public bool FixIt(IEditorBuffer buffer); // returns true on success
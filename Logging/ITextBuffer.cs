@@ -30,6 +30,23 @@ namespace TextBuffer
     }
 
 
+    /* state which is merged into other one has no children */
+    [StructLayout(LayoutKind.Sequential, Pack = 8)]
+    public struct MarshalingStateChange(IntPtr state, IntPtr mergedTo, long childrenCount)
+    {
+        public IntPtr State = state, MergedTo = mergedTo;
+        public long ChildrenCount = childrenCount;
+    }
+
+
+    [StructLayout(LayoutKind.Sequential, Pack = 8)]
+    public struct MarshalingReplaceMatch(long position, long length, long replacementOffset, long replacementLength)
+    {
+        public long Position = position, Length = length;
+        public long ReplacementOffset = replacementOffset, ReplacementLength = replacementLength;
+    }
+
+
     public interface IUndoTextBuffer : ITextBuffer
     {
         public void Undo();
@@ -44,6 +61,12 @@ namespace TextBuffer
 
         public (IntPtr[] states, MarshalingLink[] links) GetVersionTree();
 
+        /*
+            states of version tree changed after change id since, each once with its current children, which go
+            one after another in children. next is change id for the next call, 0 gives whole tree
+        */
+        public (long next, MarshalingStateChange[] changes, IntPtr[] children) GetVersionChanges(long since);
+
         public IntPtr ResolveVersion(IntPtr last_saved_version);
     }
 
@@ -66,6 +89,18 @@ namespace TextBuffer
         public void Commit();
 
         public void Clear() => RemoveAt(0, Length);
+
+        /* matches must be sorted and must not overlap, replacements are slices of one utf8 buffer */
+        public bool ReplaceAll(MarshalingReplaceMatch[] matches, byte[] replacements)
+        {
+            for (long i = matches.LongLength - 1; i >= 0; --i)
+            {
+                var match = matches[i];
+                RemoveAt(match.Position, match.Length);
+                Insert(match.Position, replacements[(int)match.ReplacementOffset..(int)(match.ReplacementOffset + match.ReplacementLength)]);
+            }
+            return true;
+        }
     }
 
     public interface ITextBuffer : IDisposable
@@ -84,6 +119,14 @@ namespace TextBuffer
 
         public byte[] SubBytes(long pos, long len);
 
+        public byte[] SubBytesEx(IntPtr state, long pos, long len);
+
+        /* reads into destination without allocating, destination may be longer than len */
+        public void ReadBytesEx(IntPtr state, long pos, long len, byte[] destination);
+
+        /* hash of text of state, same text gives same hash */
+        public UInt128 ContentHashEx(IntPtr state);
+
         public string Substring(long pos, long len);
 
         public string Substring(long pos);
@@ -112,6 +155,21 @@ namespace TextBuffer
 
         public long GetPosition(long line, long col);
 
+        /* bulk GetPosition, lineColumns are pairs line, column */
+        public long[] GetPositions(long[] lineColumns);
+
+        /* bulk GetPositionOffsets, result is pairs line, column */
+        public long[] GetPositionsOffsets(long[] positions);
+
+        /*
+            lines of view in one call: up to count lines from firstLine, at most maxColumns of each starting at
+            firstColumn, are written one after another as utf8 into buffer. lines gets pairs offset of first
+            written byte, bytes of line in buffer, line shorter than firstColumn gives its end. slice may begin or
+            end inside of utf8 sequence. returns count of lines read, it is less than count at end of text or
+            when buffer is full
+        */
+        public int ReadLines(long firstLine, int count, long firstColumn, long maxColumns, long[] lines, byte[] buffer);
+
         public long GetLineCount();
     }
 }
@@ -0,0 +1,141 @@
+﻿using System;
+using System.Collections.Generic;
+
+namespace Lsp
+{
+    public readonly struct CompletionEntry(string value, string label, string kind, string filterText, string sortText)
+    {
+        public readonly string Value = value;
+        public readonly string Label = label;
+        public readonly string Kind = kind;
+        public readonly string FilterText = filterText;
+        public readonly string SortText = sortText;
+    }
+
+    /* subsequence matcher: every pattern char must be found in order, case is ignored */
+    public static class FuzzyMatcher
+    {
+        private const int MatchScore = 1;
+        private const int ConsecutiveBonus = 4;
+        private const int BoundaryBonus = 6;
+        private const int StartBonus = 8;
+        private const int CaseBonus = 1;
+
+        /* -1 if candidate doesn't match pattern, otherwise higher is better */
+        public static int Score(string pattern, string candidate)
+        {
+            if (pattern.Length == 0)
+            {
+                return 0;
+            }
+            int score = 0;
+            int last = -2;
+            int p = 0;
+            for (int i = 0; i < candidate.Length && p < pattern.Length; i++)
+            {
+                char c = candidate[i];
+                if (char.ToLowerInvariant(c) != char.ToLowerInvariant(pattern[p]))
+                {
+                    continue;
+                }
+                score += MatchScore;
+                if (c == pattern[p])
+                {
+                    score += CaseBonus;
+                }
+                if (i == 0)
+                {
+                    score += StartBonus;
+                }
+                else if (last == i - 1)
+                {
+                    score += ConsecutiveBonus;
+                }
+                else if (IsBoundary(candidate, i))
+                {
+                    score += BoundaryBonus;
+                }
+                last = i;
+                p++;
+            }
+            return p == pattern.Length ? score : -1;
+        }
+
+        /* start of word in snake_case or camelCase */
+        private static bool IsBoundary(string text, int index)
+        {
+            char prev = text[index - 1];
+            return !char.IsLetterOrDigit(prev) || (char.IsLower(prev) && char.IsUpper(text[index]));
+        }
+    }
+
+    /*
+        completion list got for word which begins at WordBegin when Prefix of it was typed. while user
+        keeps typing the same word list is filtered locally, server is asked again only if it marked list
+        incomplete or cursor left the word. filter for longer prefix starts from result for shorter one,
+        items which don't match prefix can't match its continuation. End follows edits inside the word,
+        any edit outside of [WordBegin, End] makes list stale
+    */
+    public sealed class CompletionSession(long wordBegin, long end, string prefix, CompletionEntry[] items, bool incomplete)
+    {
+        public readonly long WordBegin = wordBegin;
+        public readonly string Prefix = prefix;
+        public readonly CompletionEntry[] Items = items;
+        public readonly bool Incomplete = incomplete;
+
+        private readonly Lock SessionLock = new();
+        private long End = end;
+        private string LastPrefix = "";
+        private CompletionEntry[] LastResult = items;
+
+        public bool Covers(long wordBegin, string prefix) => !Incomplete && wordBegin == WordBegin && prefix.StartsWith(Prefix, StringComparison.Ordinal);
+
+        /* edit is given before it is applied, false if it is outside of the word */
+        public bool Follow(long position, long removed, long inserted)
+        {
+            lock (SessionLock)
+            {
+                if (position < WordBegin || removed > End - position)
+                {
+                    return false;
+                }
+                End += inserted - removed;
+                return true;
+            }
+        }
+
+        public CompletionEntry[] Filter(string prefix)
+        {
+            lock (SessionLock)
+            {
+                var source = prefix.StartsWith(LastPrefix, StringComparison.Ordinal) ? LastResult : Items;
+                List<(int score, CompletionEntry entry)> matched = [];
+                foreach (var entry in source)
+                {
+                    int score = FuzzyMatcher.Score(prefix, entry.FilterText);
+                    if (score >= 0)
+                    {
+                        matched.Add((score, entry));
+                    }
+                }
+                matched.Sort((a, b) =>
+                {
+                    int order = b.score.CompareTo(a.score);
+                    if (order == 0)
+                    {
+                        order = string.CompareOrdinal(a.entry.SortText, b.entry.SortText);
+                    }
+                    return order;
+                });
+
+                LastPrefix = prefix;
+                LastResult = new CompletionEntry[matched.Count];
+                for (int i = 0; i < matched.Count; i++)
+                {
+                    LastResult[i] = matched[i].entry;
+                }
+                return LastResult;
+            }
+        }
+    }
+}
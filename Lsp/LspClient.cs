@@ -8,8 +8,12 @@ using OmniSharp.Extensions.LanguageServer.Protocol.Document;
 using OmniSharp.Extensions.LanguageServer.Protocol.Models;
 using OmniSharp.Extensions.LanguageServer.Protocol.Workspace;
 using System;
+using System.Buffers;
 using System.Diagnostics;
 using System.Linq;
+using System.Text;
+using System.Text.Encodings.Web;
+using System.Text.Json;
 
 
 // TODO: all this 
@@ -36,40 +40,6 @@ namespace Lsp
 
         public string Source { get; init; }
 
-        public bool UpdateAfterDelete(long position, long count)
-        {
-            if (Begin >= position + count)
-            {
-                Begin -= count;
-            }
-            else if (Begin >= position)
-            {
-                Begin = position;
-            }
-            if (End >= position + count)
-            {
-                End -= count;
-            }
-            else if (End >= position)
-            {
-                End = position;
-            }
-            return Begin < End;
-        }
-
-        public bool UpdateAfterInsert(long position, long count)
-        {
-            if (Begin >= position)
-            {
-                Begin += count;
-            }
-            if (End >= position)
-            {
-                End += count;
-            }
-            return Begin < End;
-        }
-
         public bool FixIt(IEditorBuffer buffer)
         {
             return false;
@@ -87,33 +57,37 @@ namespace Lsp
 
         LanguageClient LanguageClient;
         Dictionary<string, int> Versions = [];
-        Dictionary<string, Func<long, long, long>> PositionCallbacks;
+        Dictionary<string, Func<long[], long[]>> PositionCallbacks;
         Dictionary<string, Action<string, IEnumerable<IErrorMark>>> Callbacks;
         Process ServerProcess;
+        LspOutputStream Output;
         string ServerPath;
         string RootPath;
 
         LspClient(string rootPath,
                   string serverPath,
                   Process serverProcess,
+                  LspOutputStream output,
                   LanguageClient languageClient,
                   Dictionary<string, Action<string, IEnumerable<IErrorMark>>> callbacks,
-                  Dictionary<string, Func<long, long, long>> positionCallbacks)
+                  Dictionary<string, Func<long[], long[]>> positionCallbacks)
         {
             Callbacks = callbacks;
             RootPath = rootPath;
             ServerPath = serverPath;
             ServerProcess = serverProcess;
+            Output = output;
             LanguageClient = languageClient;
             PositionCallbacks = positionCallbacks;
         }
 
-        public virtual long MaxContentSize => 256 * 1024;
+        /* documents are streamed from buffer by chunks, so size is limited only by what server accepts */
+        public virtual long MaxContentSize => 64 * 1024 * 1024;
 
         public static async Task<LspClient> StartAsync(string rootPath, string serverPath, string? arguments, object optionObject)
         {
             Dictionary<string, Action<string, IEnumerable<IErrorMark>>> callbacks = [];
-            Dictionary<string, Func<long, long, long>> positionCallbacks = [];
+            Dictionary<string, Func<long[], long[]>> positionCallbacks = [];
 
             Logger.Log("starting lsp");
             var serverProcess = new Process
@@ -132,9 +106,10 @@ namespace Lsp
             serverProcess.Start();
             serverProcess.BeginErrorReadLine();
             Logger.Log("process started");
+            var output = new LspOutputStream(serverProcess.StandardInput.BaseStream);
             var languageClient = OmniSharp.Extensions.LanguageServer.Client.LanguageClient.Create(options => options
                 .WithInput(serverProcess.StandardOutput.BaseStream)
-                .WithOutput(serverProcess.StandardInput.BaseStream)
+                .WithOutput(output)
                 .WithRootPath(rootPath)
                 .WithClientCapabilities(new ClientCapabilities
                 {
@@ -157,20 +132,38 @@ namespace Lsp
                     Logger.Log($"--- got errors for {paramsArgs.Uri} ---");
                     Dictionary<string, List<IErrorMark>> errors = [];
                     string uri = paramsArgs.Uri.ToString();
-                    foreach (var err in paramsArgs.Diagnostics)
+                    var diagnostics = paramsArgs.Diagnostics.Where(x => x != null).ToList();
+                    if (diagnostics.Count != 0)
                     {
-                        if (err == null) continue;
-
-                        if (!errors.TryGetValue(uri, out List<IErrorMark>? value))
+                        errors[uri] = [];
+                    }
+                    if (diagnostics.Count != 0 && positionCallbacks.TryGetValue(uri, out var pairsToPos))
+                    {
+                        /* all ranges of publish are converted to positions by one call */
+                        List<long> lineColumns = [];
+                        void AddRange(OmniSharp.Extensions.LanguageServer.Protocol.Models.Range range)
                         {
-                            value = [];
-                            errors[uri] = value;
+                            lineColumns.Add(range.Start.Line);
+                            lineColumns.Add(range.Start.Character);
+                            lineColumns.Add(range.End.Line);
+                            lineColumns.Add(range.End.Character);
                         }
-                        if (positionCallbacks.TryGetValue(uri, out var pairToPos))
+                        foreach (var err in diagnostics)
                         {
-                            long begin = pairToPos(err.Range.Start.Line, err.Range.Start.Character);
-                            long end = pairToPos(err.Range.End.Line, err.Range.End.Character);
-                            value.Add(new LSPErrorMark($"{err.Message} - {err.Source}",
+                            AddRange(err.Range);
+                            foreach (var rel in err.RelatedInformation ?? Enumerable.Empty<DiagnosticRelatedInformation>())
+                            {
+                                AddRange(rel.Location.Range);
+                            }
+                        }
+                        long[] positions = pairsToPos([.. lineColumns]);
+
+                        int index = 0;
+                        foreach (var err in diagnostics)
+                        {
+                            long begin = positions[index++];
+                            long end = positions[index++];
+                            errors[uri].Add(new LSPErrorMark($"{err.Message} - {err.Source}",
                                                                 begin,
                                                                 Math.Max(end, begin + 1),
                                                                 (err.Severity switch
@@ -181,22 +174,16 @@ namespace Lsp
                                                                     _ => ErrorMarkSeverity.Note
                                                                 }),
                                                                 uri));
-                        }
-                        if (err.RelatedInformation is not null)
-                        {
-                            foreach (var rel in err.RelatedInformation)
+                            foreach (var rel in err.RelatedInformation ?? Enumerable.Empty<DiagnosticRelatedInformation>())
                             {
                                 string relUri = rel.Location.Uri.ToString();
-                                if (positionCallbacks.TryGetValue(uri, out var relPairToPos))
-                                {
-                                    long begin = relPairToPos(rel.Location.Range.Start.Line, rel.Location.Range.Start.Character);
-                                    long end = relPairToPos(rel.Location.Range.End.Line, rel.Location.Range.End.Character);
-                                    errors[relUri].Add(new LSPErrorMark($"[note:] {rel.Message}",
-                                                                    begin,
-                                                                    Math.Max(begin + 1, end),
-                                                                    ErrorMarkSeverity.Note,
-                                                                    uri));
-                                }
+                                long relBegin = positions[index++];
+                                long relEnd = positions[index++];
+                                errors[relUri].Add(new LSPErrorMark($"[note:] {rel.Message}",
+                                                                relBegin,
+                                                                Math.Max(relBegin + 1, relEnd),
+                                                                ErrorMarkSeverity.Note,
+                                                                uri));
                             }
                         }
                     }
@@ -216,7 +203,7 @@ namespace Lsp
             Logger.Log("lsp starting");
             await languageClient.Initialize(CancellationToken.None);
             Logger.Log("LSP initializated");
-            return new(rootPath, serverPath, serverProcess, languageClient, callbacks, positionCallbacks);
+            return new(rootPath, serverPath, serverProcess, output, languageClient, callbacks, positionCallbacks);
         }
 
         private DocumentUri GetUri(string? filePath, string uniqueKey)
@@ -231,7 +218,17 @@ namespace Lsp
             }
         }
 
-        public async Task OpenFileAsync(Action<string, IEnumerable<IErrorMark>> callback, Func<long, long, long> positionCallback, string? filePath, string uniqueKey, string? languageId, string content)
+        private static ContentReader ReadString(string content)
+        {
+            byte[] bytes = Encoding.UTF8.GetBytes(content);
+            return (position, length, destination) => Array.Copy(bytes, position, destination, 0, length);
+        }
+
+        public Task OpenFileAsync(Action<string, IEnumerable<IErrorMark>> callback, Func<long[], long[]> positionCallback, string? filePath, string uniqueKey, string? languageId, string content)
+            => OpenFileAsync(callback, positionCallback, filePath, uniqueKey, languageId, Encoding.UTF8.GetByteCount(content), ReadString(content));
+
+        /* content is utf8 document of given length, it is read by chunks while it is written to server */
+        public async Task OpenFileAsync(Action<string, IEnumerable<IErrorMark>> callback, Func<long[], long[]> positionCallback, string? filePath, string uniqueKey, string? languageId, long length, ContentReader read)
         {
             Logger.Log($"opening file {languageId}");
             if (languageId == null) return;
@@ -239,16 +236,10 @@ namespace Lsp
             Callbacks.Add(uri.ToString(), callback);
             PositionCallbacks.Add(uri.ToString(), positionCallback);
             Versions.Add(uri.ToString(), 1);
-            LanguageClient.TextDocument.DidOpenTextDocument(new DidOpenTextDocumentParams
-            {
-                TextDocument = new TextDocumentItem
-                {
-                    Uri = uri,
-                    LanguageId = languageId,
-                    Version = Versions[uri.ToString()],
-                    Text = content
-                }
-            });
+            await Output.WriteDocumentMessageAsync(
+                $"{{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/didOpen\",\"params\":{{\"textDocument\":{{\"uri\":{LspOutputStream.Quote(uri.ToString())},\"languageId\":{LspOutputStream.Quote(languageId)},\"version\":{Versions[uri.ToString()]},\"text\":\"",
+                "\"}}}",
+                length, read);
         }
 
         public async Task CloseFileAsync(string? filePath, string uniqueKey, string? languageId)
@@ -259,16 +250,19 @@ namespace Lsp
             Callbacks.Remove(uri.ToString());
             PositionCallbacks.Remove(uri.ToString());
             Versions.Remove(uri.ToString());
-            LanguageClient.TextDocument.DidCloseTextDocument(new DidCloseTextDocumentParams
+            await SendDocumentNotificationAsync("textDocument/didClose", writer =>
             {
-                TextDocument = new TextDocumentItem
-                {
-                    Uri = uri,
-                }
+                writer.WriteStartObject("textDocument");
+                writer.WriteString("uri", uri.ToString());
+                writer.WriteEndObject();
             });
         }
 
-        public async Task RenameFileAsync(string? oldFilePath, string? newFilePath, string uniqueKey, string? languageId, string content)
+        public Task RenameFileAsync(string? oldFilePath, string? newFilePath, string uniqueKey, string? languageId, string content)
+            => RenameFileAsync(oldFilePath, newFilePath, uniqueKey, languageId, Encoding.UTF8.GetByteCount(content), ReadString(content));
+
+        /* document is opened again under new path, it is read by chunks like in OpenFileAsync */
+        public async Task RenameFileAsync(string? oldFilePath, string? newFilePath, string uniqueKey, string? languageId, long length, ContentReader read)
         {
             var oldUri = GetUri(oldFilePath, uniqueKey);
             var newUri = GetUri(newFilePath, uniqueKey);
@@ -296,84 +290,101 @@ namespace Lsp
                 }
             });
 
-            await OpenFileAsync(callback, positionCallback, newFilePath, uniqueKey, languageId, content);
+            await OpenFileAsync(callback, positionCallback, newFilePath, uniqueKey, languageId, length, read);
 
             Logger.Log($"File renamed: {oldUri} -> {newUri}");
         }
 
 
-        public async Task ChangeFileAsync(string? filePath, string uniqueKey, string newText)
+        public Task ChangeFileAsync(string? filePath, string uniqueKey, string newText)
+            => ChangeFileAsync(filePath, uniqueKey, Encoding.UTF8.GetByteCount(newText), ReadString(newText));
+
+        /* full synchronization, document is read by chunks like in OpenFileAsync */
+        public async Task ChangeFileAsync(string? filePath, string uniqueKey, long length, ContentReader read)
         {
             var uri = GetUri(filePath, uniqueKey);
             Versions[uri.ToString()] += 1;
-            LanguageClient.TextDocument.DidChangeTextDocument(new DidChangeTextDocumentParams
-            {
-                TextDocument = new OptionalVersionedTextDocumentIdentifier
-                {
-                    Uri = uri,
-                    Version = Versions[uri.ToString()]
-                },
-                ContentChanges = new[] {
-                    new TextDocumentContentChangeEvent {
-                        Text = newText
-                    }
-                }
-            });
-            Logger.Log($"Update sent full text = {newText}");
+            await Output.WriteDocumentMessageAsync(
+                $"{{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/didChange\",\"params\":{{\"textDocument\":{{\"uri\":{LspOutputStream.Quote(uri.ToString())},\"version\":{Versions[uri.ToString()]}}},\"contentChanges\":[{{\"text\":\"",
+                "\"}]}}",
+                length, read);
+            Logger.Log($"Update sent full text ({length} bytes)");
         }
 
         public async Task ChangeFileAsync(string? filePath, string uniqueKey, int line, int col, string insertedText)
         {
-            var uri = GetUri(filePath, uniqueKey);
-            Versions[uri.ToString()] += 1;
-            LanguageClient.TextDocument.DidChangeTextDocument(new DidChangeTextDocumentParams
-            {
-                TextDocument = new OptionalVersionedTextDocumentIdentifier
-                {
-                    Uri = uri,
-                    Version = Versions[uri.ToString()]
-                },
-                ContentChanges = new Container<TextDocumentContentChangeEvent>(
-                    new TextDocumentContentChangeEvent
-                    {
-                        Range = new(
-                            new(line, col),
-                            new(line, col)
-                        ),
-                        RangeLength = 0,
-                        Text = insertedText
-                    }
-                )
-            });
+            await ChangeFileAsync(filePath, uniqueKey, [(line, col, line, col, insertedText)]);
             Logger.Log($"Update sent Insert text = {insertedText} at {line}:{col}");
         }
 
         public async Task ChangeFileAsync(string? filePath, string uniqueKey, int line, int col, int end_line, int end_col, int total_length)
+        {
+            await ChangeFileAsync(filePath, uniqueKey, [(line, col, end_line, end_col, "")]);
+            Logger.Log($"Update sent Delete text at {line}:{col} to {end_line}:{end_col} (count={total_length})");
+        }
+
+        public async Task ChangeFileAsync(string? filePath, string uniqueKey, IEnumerable<(int line, int col, int end_line, int end_col, string text)> changes)
         {
             var uri = GetUri(filePath, uniqueKey);
             Versions[uri.ToString()] += 1;
-            LanguageClient.TextDocument.DidChangeTextDocument(new DidChangeTextDocumentParams
+            int count = 0;
+            await SendDocumentNotificationAsync("textDocument/didChange", writer =>
             {
-                TextDocument = new OptionalVersionedTextDocumentIdentifier
+                writer.WriteStartObject("textDocument");
+                writer.WriteString("uri", uri.ToString());
+                writer.WriteNumber("version", Versions[uri.ToString()]);
+                writer.WriteEndObject();
+                writer.WriteStartArray("contentChanges");
+                foreach (var (line, col, end_line, end_col, text) in changes)
                 {
-                    Uri = uri,
-                    Version = Versions[uri.ToString()]
-                },
-                ContentChanges = new Container<TextDocumentContentChangeEvent>(
-                    new TextDocumentContentChangeEvent
-                    {
-                        Range = new(
-                            new(line, col),
-                            new(end_line, end_col)
-                        ),
-                        Text = ""
-                    }
-                )
+                    writer.WriteStartObject();
+                    writer.WriteStartObject("range");
+                    writer.WriteStartObject("start");
+                    writer.WriteNumber("line", line);
+                    writer.WriteNumber("character", col);
+                    writer.WriteEndObject();
+                    writer.WriteStartObject("end");
+                    writer.WriteNumber("line", end_line);
+                    writer.WriteNumber("character", end_col);
+                    writer.WriteEndObject();
+                    writer.WriteEndObject();
+                    writer.WriteString("text", text);
+                    writer.WriteEndObject();
+                    count++;
+                }
+                writer.WriteEndArray();
             });
-            Logger.Log($"Update sent Delete text at {line}:{col} to {end_line}:{end_col} (count={total_length})");
+            Logger.Log($"Update sent {count} changes");
         }
 
-        public async Task<(string value, string label, string kind)[]> GetCompletionsAsync(string? filePath, string uniqueKey, int line, int col)
+        /*
+            text document notifications are written straight into server input instead of language client queue,
+            so streamed documents and changes between them reach server in the order they were sent
+        */
+        private async Task SendDocumentNotificationAsync(string method, Action<Utf8JsonWriter> writeParams)
+        {
+            var body = new ArrayBufferWriter<byte>();
+            using (var writer = new Utf8JsonWriter(body, new JsonWriterOptions { Encoder = JavaScriptEncoder.UnsafeRelaxedJsonEscaping }))
+            {
+                writer.WriteStartObject();
+                writer.WriteString("jsonrpc", "2.0");
+                writer.WriteString("method", method);
+                writer.WriteStartObject("params");
+                writeParams(writer);
+                writer.WriteEndObject();
+                writer.WriteEndObject();
+            }
+            await Output.WriteMessageAsync(body.WrittenMemory);
+        }
+
+        public async Task<(string value, string label, string kind)[]> GetCompletionsAsync(string? filePath, string uniqueKey, int line, int col, CancellationToken cancel = default)
+        {
+            var (items, _) = await GetCompletionListAsync(filePath, uniqueKey, line, col, cancel);
+            return [.. items.Select(x => (x.Value, x.Label, x.Kind))];
+        }
+
+        /* incomplete means list may change as prefix grows, so it can't be filtered locally */
+        public async Task<(CompletionEntry[] items, bool incomplete)> GetCompletionListAsync(string? filePath, string uniqueKey, int line, int col, CancellationToken cancel = default)
         {
             var uri = GetUri(filePath, uniqueKey);
             var completionList = await LanguageClient.TextDocument.RequestCompletion(new CompletionParams
@@ -384,15 +395,15 @@ namespace Lsp
                 {
                     TriggerKind = CompletionTriggerKind.Invoked
                 }
-            });
+            }, cancel);
 
-            List<(string, string, string)> res = [];
+            List<CompletionEntry> res = [];
             foreach (var item in completionList)
             {
-                res.Add((item.InsertText ?? "", item.Label, item.Kind.ToString()));
-                Logger.Log($"Variant: {item.Label} [{item.InsertText}]");
+                res.Add(new(item.InsertText ?? "", item.Label, item.Kind.ToString(), item.FilterText ?? item.Label, item.SortText ?? item.Label));
             }
-            return [.. res];
+            Logger.Log($"Got {res.Count} completion variants (incomplete = {completionList.IsIncomplete})");
+            return ([.. res], completionList.IsIncomplete);
         }
 
         public void Dispose()
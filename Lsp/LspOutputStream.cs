@@ -0,0 +1,266 @@
+﻿using System;
+using System.Buffers;
+using System.Text;
+using System.Text.Json;
+
+namespace Lsp
+{
+    /* reads length bytes of document from position into destination */
+    public delegate void ContentReader(long position, long length, byte[] destination);
+
+    /*
+        stdin of language server: language client writes its messages through it, stream follows their
+        Content-Length framing so messages streamed straight from document are written only between them
+    */
+    internal sealed class LspOutputStream(Stream inner) : Stream
+    {
+        public const int ChunkSize = 64 * 1024;
+
+        private readonly SemaphoreSlim Gate = new(1, 1);
+
+        /* framing of message written by language client, BodyLeft is -1 while header is written */
+        private bool InMessage = false;
+        private readonly List<byte> Header = [];
+        private long BodyLeft = -1;
+
+        public override bool CanRead => false;
+        public override bool CanSeek => false;
+        public override bool CanWrite => true;
+        public override long Length => throw new NotSupportedException();
+        public override long Position { get => throw new NotSupportedException(); set => throw new NotSupportedException(); }
+
+        public override void Flush() => inner.Flush();
+        public override Task FlushAsync(CancellationToken cancellationToken) => inner.FlushAsync(cancellationToken);
+        public override int Read(byte[] buffer, int offset, int count) => throw new NotSupportedException();
+        public override long Seek(long offset, SeekOrigin origin) => throw new NotSupportedException();
+        public override void SetLength(long value) => throw new NotSupportedException();
+
+        protected override void Dispose(bool disposing)
+        {
+            if (disposing)
+            {
+                inner.Dispose();
+            }
+            base.Dispose(disposing);
+        }
+
+        public override void Write(byte[] buffer, int offset, int count) => Write(buffer.AsSpan(offset, count));
+
+        public override void Write(ReadOnlySpan<byte> buffer)
+        {
+            while (!buffer.IsEmpty)
+            {
+                if (!InMessage)
+                {
+                    Gate.Wait();
+                    InMessage = true;
+                }
+                int consumed = Track(buffer);
+                inner.Write(buffer[..consumed]);
+                buffer = buffer[consumed..];
+                EndMessageIfComplete();
+            }
+        }
+
+        public override Task WriteAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken) => WriteAsync(buffer.AsMemory(offset, count), cancellationToken).AsTask();
+
+        public override async ValueTask WriteAsync(ReadOnlyMemory<byte> buffer, CancellationToken cancellationToken = default)
+        {
+            while (!buffer.IsEmpty)
+            {
+                if (!InMessage)
+                {
+                    await Gate.WaitAsync(cancellationToken);
+                    InMessage = true;
+                }
+                int consumed = Track(buffer.Span);
+                await inner.WriteAsync(buffer[..consumed], cancellationToken);
+                buffer = buffer[consumed..];
+                EndMessageIfComplete();
+            }
+        }
+
+        /* returns how many bytes belong to current part (header or body) of message */
+        private int Track(ReadOnlySpan<byte> buffer)
+        {
+            if (BodyLeft >= 0)
+            {
+                int count = (int)Math.Min(BodyLeft, buffer.Length);
+                BodyLeft -= count;
+                return count;
+            }
+            for (int i = 0; i < buffer.Length; i++)
+            {
+                Header.Add(buffer[i]);
+                if (Header.Count >= 4 && Header[^1] == '\n' && Header[^2] == '\r' && Header[^3] == '\n' && Header[^4] == '\r')
+                {
+                    BodyLeft = ParseContentLength(Encoding.ASCII.GetString([.. Header]));
+                    Header.Clear();
+                    return i + 1;
+                }
+            }
+            return buffer.Length;
+        }
+
+        private static long ParseContentLength(string header)
+        {
+            foreach (var line in header.Split("\r\n", StringSplitOptions.RemoveEmptyEntries))
+            {
+                int colon = line.IndexOf(':');
+                if (colon != -1 && line[..colon].Trim().Equals("Content-Length", StringComparison.OrdinalIgnoreCase))
+                {
+                    return long.Parse(line[(colon + 1)..].Trim());
+                }
+            }
+            return 0;
+        }
+
+        private void EndMessageIfComplete()
+        {
+            if (BodyLeft == 0)
+            {
+                BodyLeft = -1;
+                InMessage = false;
+                Gate.Release();
+            }
+        }
+
+        public async Task WriteMessageAsync(ReadOnlyMemory<byte> body)
+        {
+            await Gate.WaitAsync();
+            try
+            {
+                await inner.WriteAsync(Encoding.ASCII.GetBytes($"Content-Length: {body.Length}\r\n\r\n"));
+                await inner.WriteAsync(body);
+                await inner.FlushAsync();
+            }
+            finally
+            {
+                Gate.Release();
+            }
+        }
+
+        /*
+            writes message with body prefix + json escaped document + suffix, document is read by chunks
+            twice: to count its escaped length for Content-Length and to write it
+        */
+        public async Task WriteDocumentMessageAsync(string prefix, string suffix, long length, ContentReader read)
+        {
+            byte[] prefixBytes = Encoding.UTF8.GetBytes(prefix);
+            byte[] suffixBytes = Encoding.UTF8.GetBytes(suffix);
+            byte[] chunk = ArrayPool<byte>.Shared.Rent(ChunkSize);
+            byte[] escaped = ArrayPool<byte>.Shared.Rent(ChunkSize * MaxEscapeLength);
+            try
+            {
+                long contentLength = prefixBytes.Length + suffixBytes.Length;
+                for (long position = 0; position < length; position += ChunkSize)
+                {
+                    int count = (int)Math.Min(ChunkSize, length - position);
+                    read(position, count, chunk);
+                    contentLength += EscapedLength(chunk.AsSpan(0, count));
+                }
+
+                await Gate.WaitAsync();
+                try
+                {
+                    await inner.WriteAsync(Encoding.ASCII.GetBytes($"Content-Length: {contentLength}\r\n\r\n"));
+                    await inner.WriteAsync(prefixBytes);
+                    for (long position = 0; position < length; position += ChunkSize)
+                    {
+                        int count = (int)Math.Min(ChunkSize, length - position);
+                        read(position, count, chunk);
+                        int escapedCount = Escape(chunk.AsSpan(0, count), escaped);
+                        await inner.WriteAsync(escaped.AsMemory(0, escapedCount));
+                    }
+                    await inner.WriteAsync(suffixBytes);
+                    await inner.FlushAsync();
+                }
+                finally
+                {
+                    Gate.Release();
+                }
+            }
+            finally
+            {
+                ArrayPool<byte>.Shared.Return(chunk);
+                ArrayPool<byte>.Shared.Return(escaped);
+            }
+        }
+
+        public static string Quote(string value) => JsonSerializer.Serialize(value);
+
+        private const int MaxEscapeLength = 6;
+
+        /* bytes written for each input byte inside json string, utf8 sequences are kept as is */
+        private static readonly byte[] EscapeLengths = CreateEscapeLengths();
+
+        private static byte[] CreateEscapeLengths()
+        {
+            byte[] lengths = new byte[256];
+            Array.Fill(lengths, (byte)1);
+            for (int i = 0; i < 0x20; i++)
+            {
+                lengths[i] = MaxEscapeLength;
+            }
+            foreach (char c in "\b\t\n\f\r\"\\")
+            {
+                lengths[c] = 2;
+            }
+            return lengths;
+        }
+
+        private static long EscapedLength(ReadOnlySpan<byte> text)
+        {
+            long length = 0;
+            foreach (byte b in text)
+            {
+                length += EscapeLengths[b];
+            }
+            return length;
+        }
+
+        private static int Escape(ReadOnlySpan<byte> text, Span<byte> destination)
+        {
+            const string hex = "0123456789abcdef";
+            int written = 0;
+            while (!text.IsEmpty)
+            {
+                /* copy run of bytes which need no escaping at once */
+                int run = 0;
+                while (run < text.Length && EscapeLengths[text[run]] == 1)
+                {
+                    run++;
+                }
+                text[..run].CopyTo(destination[written..]);
+                written += run;
+                text = text[run..];
+                if (text.IsEmpty)
+                {
+                    break;
+                }
+
+                byte b = text[0];
+                text = text[1..];
+                destination[written++] = (byte)'\\';
+                switch (b)
+                {
+                    case (byte)'\b': destination[written++] = (byte)'b'; break;
+                    case (byte)'\t': destination[written++] = (byte)'t'; break;
+                    case (byte)'\n': destination[written++] = (byte)'n'; break;
+                    case (byte)'\f': destination[written++] = (byte)'f'; break;
+                    case (byte)'\r': destination[written++] = (byte)'r'; break;
+                    case (byte)'"': destination[written++] = (byte)'"'; break;
+                    case (byte)'\\': destination[written++] = (byte)'\\'; break;
+                    default:
+                        destination[written++] = (byte)'u';
+                        destination[written++] = (byte)'0';
+                        destination[written++] = (byte)'0';
+                        destination[written++] = (byte)hex[b >> 4];
+                        destination[written++] = (byte)hex[b & 0xF];
+                        break;
+                }
+            }
+            return written;
+        }
+    }
+}
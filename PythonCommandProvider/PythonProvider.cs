@@ -1,4 +1,6 @@
-﻿using Common;
+﻿using CommandProviderInterface;
+using Common;
+using System.Collections.Concurrent;
 using RegexTokenizer;
 using System.Collections.ObjectModel;
 using System.Diagnostics;
@@ -9,7 +11,10 @@ namespace PythonCommandProvider
 {
     using System.Text.Json.Serialization;
 
+    [JsonSourceGenerationOptions(PropertyNamingPolicy = JsonKnownNamingPolicy.CamelCase)]
     [JsonSerializable(typeof(string[]))]
+    [JsonSerializable(typeof(PythonRequest))]
+    [JsonSerializable(typeof(PythonResponse))]
     internal partial class PythonJsonContext : JsonSerializerContext
     {
     }
@@ -18,93 +23,72 @@ namespace PythonCommandProvider
     {
         public string? LanguageId => "python";
 
-        public PythonProvider()
-        { }
+        /* interpreters are kept running, preview sends request on every edit of command. first one serves Execute, all of them serve chunks of ExecutePartitioned */
+        private readonly PythonWorker[] Workers = [.. Enumerable.Range(0, Environment.ProcessorCount).Select(_ => new PythonWorker())];
+        private readonly BlockingCollection<PythonWorker> IdleWorkers = [];
 
-        ~PythonProvider()
-        { }
+        public PythonProvider()
+        {
+            foreach (var worker in Workers)
+            {
+                IdleWorkers.Add(worker);
+            }
+            Task.Run(Workers[0].Prewarm);
+        }
 
         public (long, long, string) ExampleScript(string editType)
         {
             return editType switch
             {
                 "edit" => (23, 24, "output = map(lambda x: x, data)"),
+                "editEach" => (23, 24, "output = map(lambda x: x, data)"),
                 "replace" => (34, 34, "output = map(lambda x: x.replace(\"\",\"\"), data)"),
                 _ => (0, 0, "")
             };
         }
 
-        public (IEnumerable<object>?, string?) Execute(string command, object[] args)
-        {
-            string inputData = "import json\n" +
-                               "output = data = " + JsonSerializer.Serialize(args.Select(x => x.ToString()).ToArray(), PythonJsonContext.Default.StringArray) + "\n";
-            string inputCode = $"{inputData}\n{command}\n" +
-                               "print(json.dumps(list(map(str, output))))";
-
-            string? error = null;
-            string? output = null;
+        public (IEnumerable<object>?, string?) Execute(string command, object[] args) => Execute(command, args, CancellationToken.None);
 
-            Logger.Log($"Executing {inputCode}");
+        public (IEnumerable<object>?, string?) Execute(string command, object[] args, CancellationToken cancel)
+        {
+            Logger.Log($"Executing {command}");
+            return Execute(Workers[0], command, args, cancel);
+        }
 
-            try
+        public (IEnumerable<object>?, string?) ExecutePartitioned(string command, object[] args, Action<IReadOnlyList<object>>? partial, CancellationToken cancel)
+        {
+            Logger.Log($"Executing partitioned {command}");
+            return PartitionedExecution.Run(args, Workers.Length, (chunk, chunkCancel) =>
             {
-                ProcessStartInfo startInfo = new()
+                PythonWorker worker;
+                try
                 {
-                    FileName = (RuntimeInformation.IsOSPlatform(OSPlatform.Linux) ? "python3" : "py.exe"),
-                    RedirectStandardInput = true,
-                    RedirectStandardOutput = true,
-                    RedirectStandardError = true,
-                    UseShellExecute = false,
-                    CreateNoWindow = true
-                };
-
-                using (Process process = new Process { StartInfo = startInfo })
+                    worker = IdleWorkers.Take(chunkCancel);
+                }
+                catch (OperationCanceledException)
                 {
-                    process.Start();
-
-                    process.StandardInput.Write(inputCode);
-                    process.StandardInput.Close();
-
-                    if (process.WaitForExit(5000))
-                    {
-                        output = process.StandardOutput.ReadToEnd().Replace("\r", null);
-                        error = process.StandardError.ReadToEnd().Replace("\r", null);
-                    }
-                    else
-                    {
-                        process.Kill();
-                        return (null, "ERROR: Process don't completed in 5 seconds\n");
-                    }
-
-                    Logger.Log("Executable Output:");
-                    Logger.Log(output);
-                    Logger.Log("Executable Error:");
-                    Logger.Log(error);
-                    Logger.Log($"Exit Code: {process.ExitCode}");
+                    return (null, "Cancelled\n");
                 }
-            }
-            catch (Exception ex)
-            {
-                Logger.Log(LogLevel.Error, $"An error occurred: {ex.Message}");
-            }
-
-            if (output == null)
-            {
-                return (null, error);
-            }
-
-            string[]? resultArray;
+                try
+                {
+                    return Execute(worker, command, chunk, chunkCancel);
+                }
+                finally
+                {
+                    IdleWorkers.Add(worker);
+                }
+            }, partial, cancel);
+        }
 
-            try
-            {
-                resultArray = JsonSerializer.Deserialize(output, PythonJsonContext.Default.StringArray);
-            }
-            catch (Exception ex)
+        private static (IEnumerable<object>?, string?) Execute(PythonWorker worker, string command, object[] args, CancellationToken cancel)
+        {
+            var (output, error) = worker.Execute(command, [.. args.Select(x => x.ToString() ?? "")], cancel);
+            if (error != null)
             {
-                Logger.Log(ex.ToString());
-                return (null, error + "\n" + ex.ToString());
+                Logger.Log("Executable Error:");
+                Logger.Log(error);
             }
-            return (resultArray, null);
+            return (output, error);
         }
     }
 }
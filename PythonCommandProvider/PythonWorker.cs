@@ -0,0 +1,219 @@
+﻿using Common;
+using System.Buffers.Binary;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Text.Json;
+
+namespace PythonCommandProvider
+{
+    internal sealed record PythonRequest(string Code, string[] Data);
+
+    internal sealed record PythonResponse(string[]? Output, string? Error);
+
+    /*
+        python interpreter which is started once and executes requests one by one. request and response are
+        utf8 json prefixed by 4 byte little endian length. worker is killed on timeout or cancellation and
+        started again by next request, it exits by itself when its stdin is closed
+    */
+    internal sealed class PythonWorker : IDisposable
+    {
+        public static readonly TimeSpan Timeout = TimeSpan.FromSeconds(5);
+
+        /* prints of script must not get into responses and exit() closes stdin, so std streams are replaced while script runs */
+        private const string Bootstrap = """
+            import io, json, struct, sys, traceback
+            channel_in = sys.stdin.buffer
+            channel_out = sys.stdout.buffer
+            def read_exactly(size):
+                data = b''
+                while len(data) < size:
+                    chunk = channel_in.read(size - len(data))
+                    if not chunk:
+                        sys.exit(0)
+                    data += chunk
+                return data
+            while True:
+                size, = struct.unpack('<I', read_exactly(4))
+                request = json.loads(read_exactly(size).decode('utf-8'))
+                sys.stdin, sys.stdout, sys.stderr = io.StringIO(), io.StringIO(), io.StringIO()
+                try:
+                    scope = {'json': json}
+                    scope['output'] = scope['data'] = request['data']
+                    exec(request['code'], scope)
+                    response = {'output': list(map(str, scope['output'])), 'error': None}
+                except BaseException:
+                    response = {'output': None, 'error': traceback.format_exc()}
+                finally:
+                    sys.stdin, sys.stdout, sys.stderr = sys.__stdin__, sys.__stdout__, sys.__stderr__
+                body = json.dumps(response).encode('utf-8')
+                channel_out.write(struct.pack('<I', len(body)) + body)
+                channel_out.flush()
+            """;
+
+        private readonly SemaphoreSlim Gate = new(1, 1);
+        private Process? process = null;
+
+        /* starts interpreter before first request, so it doesn't wait for startup */
+        public void Prewarm()
+        {
+            Gate.Wait();
+            try
+            {
+                process ??= Start();
+            }
+            catch (Exception ex)
+            {
+                Logger.Log(LogLevel.Error, $"Can't start python worker: {ex.Message}");
+            }
+            finally
+            {
+                Gate.Release();
+            }
+        }
+
+        public (string[]? output, string? error) Execute(string code, string[] data, CancellationToken cancel)
+        {
+            byte[] request = JsonSerializer.SerializeToUtf8Bytes(new PythonRequest(code, data), PythonJsonContext.Default.PythonRequest);
+            try
+            {
+                Gate.Wait(cancel);
+            }
+            catch (OperationCanceledException)
+            {
+                return (null, "Cancelled\n");
+            }
+            try
+            {
+                for (int attempt = 0; ; attempt++)
+                {
+                    Process worker = process ??= Start();
+                    using var timeout = CancellationTokenSource.CreateLinkedTokenSource(cancel);
+                    timeout.CancelAfter(Timeout);
+
+                    byte[]? response = null;
+                    bool sent = false;
+                    /* blocking pipe reads can't be cancelled, killed worker closes pipe instead */
+                    using (timeout.Token.Register(() => Kill(worker)))
+                    {
+                        try
+                        {
+                            Send(worker, request);
+                            sent = true;
+                            response = Receive(worker);
+                        }
+                        catch (Exception ex) when (ex is IOException or EndOfStreamException or ObjectDisposedException)
+                        {
+                        }
+                    }
+                    if (response != null)
+                    {
+                        var result = JsonSerializer.Deserialize(response, PythonJsonContext.Default.PythonResponse);
+                        return result?.Output != null ? (result.Output, null) : (null, result?.Error ?? "Empty response\n");
+                    }
+
+                    Stop();
+                    if (cancel.IsCancellationRequested)
+                    {
+                        return (null, "Cancelled\n");
+                    }
+                    if (timeout.IsCancellationRequested)
+                    {
+                        return (null, "ERROR: Process don't completed in 5 seconds\n");
+                    }
+                    /* worker died before request, so request isn't the reason */
+                    if (!sent && attempt == 0)
+                    {
+                        continue;
+                    }
+                    return (null, "ERROR: python worker exited, it will be restarted\n");
+                }
+            }
+            catch (Exception ex)
+            {
+                Logger.Log(LogLevel.Error, $"An error occurred: {ex.Message}");
+                return (null, ex.Message);
+            }
+            finally
+            {
+                Gate.Release();
+            }
+        }
+
+        private static Process Start()
+        {
+            ProcessStartInfo startInfo = new()
+            {
+                FileName = (RuntimeInformation.IsOSPlatform(OSPlatform.Linux) ? "python3" : "py.exe"),
+                RedirectStandardInput = true,
+                RedirectStandardOutput = true,
+                RedirectStandardError = true,
+                UseShellExecute = false,
+                CreateNoWindow = true
+            };
+            startInfo.ArgumentList.Add("-c");
+            startInfo.ArgumentList.Add(Bootstrap);
+
+            Process worker = new() { StartInfo = startInfo };
+            worker.ErrorDataReceived += (s, e) => { if (e.Data != null) { Logger.Log(LogLevel.Warning, e.Data); } };
+            worker.Start();
+            worker.BeginErrorReadLine();
+            Logger.Log($"Python worker started, pid {worker.Id}");
+            return worker;
+        }
+
+        private static void Send(Process worker, byte[] request)
+        {
+            Span<byte> header = stackalloc byte[4];
+            BinaryPrimitives.WriteInt32LittleEndian(header, request.Length);
+            var stdin = worker.StandardInput.BaseStream;
+            stdin.Write(header);
+            stdin.Write(request);
+            stdin.Flush();
+        }
+
+        private static byte[] Receive(Process worker)
+        {
+            var stdout = worker.StandardOutput.BaseStream;
+            byte[] header = new byte[4];
+            stdout.ReadExactly(header);
+            byte[] response = new byte[BinaryPrimitives.ReadInt32LittleEndian(header)];
+            stdout.ReadExactly(response);
+            return response;
+        }
+
+        private static void Kill(Process worker)
+        {
+            try
+            {
+                worker.Kill(true);
+            }
+            catch (Exception ex) when (ex is InvalidOperationException or System.ComponentModel.Win32Exception)
+            {
+                /* already exited */
+            }
+        }
+
+        private void Stop()
+        {
+            if (process != null)
+            {
+                Kill(process);
+                process.Dispose();
+                process = null;
+            }
+        }
+
+        public void Dispose()
+        {
+            Gate.Wait();
+            try
+            {
+                Stop();
+            }
+            finally
+            {
+                Gate.Release();
+            }
+        }
+    }
+}
@@ -78,6 +78,15 @@ public abstract partial class BaseTokenizer
     public abstract List<Token> ParseContent(string content);
     public virtual long MaxContentSize => 256 * 1024;
 
+    /* tokenize content given as utf8 bytes by read, tokenizers working on bytes don't need to decode it whole */
+    public virtual TokenStore ParseContent(Func<long, long, byte[]> read, long length, CancellationToken cancel = default) => TokenStore.Create(ParseContent(Encoding.UTF8.GetString(read(0, length))));
+
+    /*
+        update tokens of previous parse after [position, position + removed) was replaced with inserted bytes,
+        read returns utf8 bytes of new content of given length. null means full ParseContent is needed
+    */
+    public virtual TokenStore? UpdateContent(TokenStore tokens, Func<long, long, byte[]> read, long length, long position, long removed, long inserted, CancellationToken cancel = default) => null;
+
 
     public static BaseTokenizer CreateBaseTokenizer()
     {
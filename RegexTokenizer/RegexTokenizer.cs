@@ -19,6 +19,16 @@ namespace RegexTokenizer
 
         private readonly (int Id, TokenType Type)[] GroupMap;
 
+        /* lexer state (index of unclosed bounded type or -1) is saved at line begin every CheckpointLines lines */
+        public const int CheckpointLines = 128;
+
+        /* initial size of text window read from buffer while relexing */
+        public const int WindowSize = 64 * 1024;
+
+        /* content of this size and bigger is tokenized on several threads */
+        public const int ParallelThreshold = 256 * 1024;
+
+        public override long MaxContentSize => 16 * 1024 * 1024;
 
         public RegexTokenizer((string begin, string? end, string? escapeSeq, bool multiline, TokenType token)[] boundedTypes,
                               Regex regex)
@@ -33,136 +43,373 @@ namespace RegexTokenizer
                                        .ToArray();
         }
 
-        public override List<Token> ParseContent(string content)
+        public override List<Token> ParseContent(string content) => ParseWindows([content], out _, default);
+
+        /* checkpoints are kept as lexer state of returned store, so tokenizer shared by several buffers keeps no state of them */
+        public override TokenStore ParseContent(Func<long, long, byte[]> read, long length, CancellationToken cancel = default)
         {
-            List<Token> result = [];
-            var span = content.AsSpan();
+            var tokens = ParseWindows(ReadWindows(read, length), out var checkpoints, cancel);
+            return TokenStore.Create(tokens, checkpoints);
+        }
 
-            /* 1. first parse comments and strings using loop */
-            int pos = 0, ppos = -1;
-            while (pos < span.Length)
+        /*
+            windows are consecutive parts of content made of whole lines. checkpoints get utf8 offset of line begin
+            and lexer state at it, sorted by offset, first one is always (0, -1)
+        */
+        private List<Token> ParseWindows(IEnumerable<string> windows, out List<(long offset, int state)> checkpoints, CancellationToken cancel)
+        {
+            /* 1. only bounded types are scanned to find lexer state at each checkpoint */
+            List<(string window, int begin, int end, long offset, int state)> chunks = [];
+            checkpoints = [];
+            int line = 0, state = -1;
+            long offset = 0;
+            foreach (var window in windows)
             {
-                // find feature
-                int begin = span[pos..].IndexOfAny(FeatureStartSearcher);
-                if (pos == ppos)
+                cancel.ThrowIfCancellationRequested();
+                int chunkBegin = 0, chunkState = state;
+                long chunkOffset = offset;
+                for (int pos = 0; pos < window.Length;)
                 {
-                    Logger.Log(LogLevel.Error, $"RegexTokenizer step was empty at {pos}.");
-                    break;
+                    if (line % CheckpointLines == 0)
+                    {
+                        checkpoints.Add((offset, state));
+                        if (pos > chunkBegin)
+                        {
+                            chunks.Add((window, chunkBegin, pos, chunkOffset, chunkState));
+                            (chunkBegin, chunkOffset, chunkState) = (pos, offset, state);
+                        }
+                    }
+                    int next = window.IndexOf('\n', pos);
+                    int end = (next == -1) ? window.Length : next + 1;
+                    state = TokenizeLine(window, pos, end, state, null);
+                    offset += Utf8Length(window.AsSpan(pos, end - pos));
+                    pos = end;
+                    line++;
                 }
-                ppos = pos;
-                if (begin == -1)
+                if (window.Length > chunkBegin)
                 {
-                    break;
+                    chunks.Add((window, chunkBegin, window.Length, chunkOffset, chunkState));
                 }
-                begin += pos;
-                // find what it is
-                var beginSpan = span.Slice(begin);
-                int end = -1;
-                foreach (var comment in BoundedTypes)
-                {   
-                    if (beginSpan.StartsWith(comment.begin))
-                    {
-                        pos = begin + comment.begin.Length;
+            }
+            if (checkpoints.Count == 0)
+            {
+                checkpoints.Add((0, -1));
+            }
 
-                        do
-                        {
-                            if (pos >= span.Length)
-                            {
-                                end = -1;
-                                break;
-                            }
-
-                            end = span[pos..].IndexOfAny(comment.endSearcher);
-
-                            if (end == -1)
-                            {
-                                end = span.Length;
-                            }
-                            else if (comment.end == null || span[end] == '\n')
-                            {
-                                end = pos + end + 1;
-                            }
-                            else
-                            {
-                                end += pos;
-                                if (comment.escapeSeq != null && end != 0 && span[..(end - 1)].EndsWith(comment.escapeSeq))
-                                {
-                                    pos = end + 1; // skip this position
-                                    continue;
-                                }
-                                end += comment.end.Length;
-                            }
-                        }
-                        while (false);
+            /* 2. lines between checkpoints don't depend on each other, so they can be tokenized in parallel */
+            var parts = new List<Token>[chunks.Count];
+            void TokenizeChunk(int i)
+            {
+                var (window, begin, end, chunkOffset, chunkState) = chunks[i];
+                List<Token> part = [];
+                for (int pos = begin; pos < end;)
+                {
+                    int next = window.IndexOf('\n', pos, end - pos);
+                    int lineEnd = (next == -1) ? end : next + 1;
+                    chunkState = TokenizeLine(window, pos, lineEnd, chunkOffset, chunkState, part, out long lineBytes);
+                    chunkOffset += lineBytes;
+                    pos = lineEnd;
+                }
+                parts[i] = part;
+            }
+            if (offset >= ParallelThreshold)
+            {
+                Parallel.For(0, chunks.Count, new ParallelOptions { CancellationToken = cancel }, TokenizeChunk);
+            }
+            else
+            {
+                for (int i = 0; i < chunks.Count; i++)
+                {
+                    cancel.ThrowIfCancellationRequested();
+                    TokenizeChunk(i);
+                }
+            }
 
-                        if (end == -1)
-                        {
-                            end = span.Length;
-                        }
+            /* 3. merge in order */
+            List<Token> result = new(parts.Sum(x => x.Count));
+            foreach (var part in parts)
+            {
+                result.AddRange(part);
+            }
+            return result;
+        }
 
-                        result.Add(new Token(comment.token, begin, end));
-                        pos = end;
-                    }
-                }
+        public override TokenStore? UpdateContent(TokenStore tokens, Func<long, long, byte[]> read, long length, long position, long removed, long inserted, CancellationToken cancel = default)
+        {
+            if (tokens.LexerState is not List<(long offset, int state)> old || old.Count == 0)
+            {
+                return null;
             }
 
+            long delta = inserted - removed;
+            long editEnd = position + inserted;
+
+            /* 1. restart from last checkpoint before edit, state there does not depend on edited text */
+            int first = old.BinarySearch((position, int.MaxValue), CheckpointComparer.Instance);
+            first = (first < 0 ? ~first : first + 1) - 1;
+            (long offset, int state) = old[first];
+
+            List<(long offset, int state)> checkpoints = old.GetRange(0, first);
+            List<Token> relexed = [];
+            int nextOld = first + 1;
+            int synced = -1;
+            int line = 0;
 
-            /* 2. parse all rest lines using regular expressions */
-            List<Token> regexResult = [];
-            pos = 0;
-            while (pos < content.Length)
+            /* 2. relex lines until state at some old checkpoint after edit is the same */
+            while (synced == -1 && offset < length)
             {
-                int nextNewLine = content.IndexOf('\n', pos);
-                int end = (nextNewLine == -1) ? content.Length : nextNewLine;
-                foreach (Match m in LineTokenizer.Matches(content[pos..end]))
+                cancel.ThrowIfCancellationRequested();
+                string window = ReadLines(read, offset, length, out _);
+                long lineOffset = offset;
+                for (int pos = 0; pos < window.Length;)
                 {
-                    foreach (var entry in GroupMap)
+                    if (lineOffset >= editEnd)
                     {
-                        if (m.Groups[entry.Id].Success)
+                        while (nextOld < old.Count && old[nextOld].offset < lineOffset - delta)
                         {
-                            regexResult.Add(new Token(entry.Type, pos + m.Index, pos + m.Index + m.Length - 1));
+                            nextOld++;
+                        }
+                        if (nextOld < old.Count && old[nextOld] == (lineOffset - delta, state))
+                        {
+                            synced = nextOld;
                             break;
                         }
                     }
+                    if (line % CheckpointLines == 0)
+                    {
+                        checkpoints.Add((lineOffset, state));
+                    }
+                    int next = window.IndexOf('\n', pos);
+                    int end = (next == -1) ? window.Length : next + 1;
+                    state = TokenizeLine(window, pos, end, lineOffset, state, relexed, out long lineBytes);
+                    lineOffset += lineBytes;
+                    pos = end;
+                    line++;
                 }
-                pos = end + 1;
+                offset = lineOffset;
             }
 
+            if (checkpoints.Count == 0)
+            {
+                checkpoints.Add((0, -1));
+            }
 
-            /* 3. merge both arrays to result */
+            /* 3. splice relexed tokens between untouched prefix and shifted suffix */
+            long resume = long.MaxValue;
+            if (synced != -1)
             {
-                long lastResult = 0;
-                long regexPos = 0;
+                resume = old[synced].offset;
+                for (int i = synced; i < old.Count; i++)
+                {
+                    checkpoints.Add((old[i].offset + delta, old[i].state));
+                }
+            }
+            return tokens.Splice(old[first].offset, relexed, resume, delta, checkpoints);
+        }
 
-                List<Token> filtered = [];
+        private static IEnumerable<string> ReadWindows(Func<long, long, byte[]> read, long length)
+        {
+            for (long offset = 0; offset < length;)
+            {
+                string window = ReadLines(read, offset, length, out long windowBytes);
+                offset += windowBytes;
+                yield return window;
+            }
+        }
 
-                while (lastResult < result.Count && regexPos < regexResult.Count)
+        /*
+            decode utf8 text from offset up to end of last complete line (or end of content),
+            window grows if line is longer than it
+        */
+        private static string ReadLines(Func<long, long, byte[]> read, long offset, long length, out long windowBytes)
+        {
+            long size = WindowSize;
+            while (true)
+            {
+                long count = Math.Min(size, length - offset);
+                byte[] data = read(offset, count);
+                int complete = (offset + count >= length) ? data.Length : data.AsSpan().LastIndexOf((byte)'\n') + 1;
+                if (complete > 0)
                 {
-                    if (regexResult[(int)regexPos].begin > result[(int)lastResult].end)
-                    {
-                        lastResult++;
-                    }
-                    else if (regexResult[(int)regexPos].end < result[(int)lastResult].begin)
-                    {
-                        filtered.Add(regexResult[(int)regexPos]);
-                        regexPos++;
-                    }
-                    else
-                    {
-                        regexPos++;
-                    }
+                    windowBytes = complete;
+                    return Encoding.UTF8.GetString(data, 0, complete);
                 }
-                while (regexPos < regexResult.Count)
+                size *= 2;
+            }
+        }
+
+        private static long Utf8Length(ReadOnlySpan<char> text) => Ascii.IsValid(text) ? text.Length : Encoding.UTF8.GetByteCount(text);
+
+        /* same as TokenizeLine, but tokens get utf8 offsets, line begins at utf8 offset and lineBytes is its utf8 length */
+        private int TokenizeLine(string window, int begin, int end, long offset, int state, List<Token> result, out long lineBytes)
+        {
+            int first = result.Count;
+            state = TokenizeLine(window, begin, end, state, result);
+
+            var text = window.AsSpan(begin, end - begin);
+            if (Ascii.IsValid(text))
+            {
+                /* most lines are ascii, there char index is byte index */
+                lineBytes = text.Length;
+                for (int i = first; i < result.Count; i++)
+                {
+                    var token = result[i];
+                    result[i] = new Token(token.type, token.begin - begin + offset, token.end - begin + offset);
+                }
+                return state;
+            }
+
+            lineBytes = Encoding.UTF8.GetByteCount(text);
+            int pos = begin;
+            for (int i = first; i < result.Count; i++)
+            {
+                var token = result[i];
+                offset += Encoding.UTF8.GetByteCount(window.AsSpan(pos, (int)token.begin - pos));
+                long tokenBegin = offset;
+                offset += Encoding.UTF8.GetByteCount(window.AsSpan((int)token.begin, (int)(token.end - token.begin)));
+                pos = (int)token.end;
+                result[i] = new Token(token.type, tokenBegin, offset);
+            }
+            return state;
+        }
+
+        private sealed class CheckpointComparer : IComparer<(long offset, int state)>
+        {
+            public static readonly CheckpointComparer Instance = new();
+            public int Compare((long offset, int state) x, (long offset, int state) y) => x.offset.CompareTo(y.offset);
+        }
+
+        /*
+            tokenize content[begin..end), end is after '\n' or end of content,
+            state is index of bounded type opened on previous lines or -1, returns state for next line,
+            without result only bounded types are scanned
+        */
+        private int TokenizeLine(string content, int begin, int end, int state, List<Token>? result)
+        {
+            int textEnd = (end > begin && content[end - 1] == '\n') ? end - 1 : end;
+            int pos = begin;
+
+            if (state != -1)
+            {
+                pos = FindBoundedEnd(content, pos, end, BoundedTypes[state], out bool closed);
+                if (pos > begin)
+                {
+                    result?.Add(new Token(BoundedTypes[state].token, begin, pos - 1));
+                }
+                if (!closed)
+                {
+                    return state;
+                }
+                state = -1;
+            }
+
+            while (pos < textEnd)
+            {
+                int next = content.AsSpan(pos, textEnd - pos).IndexOfAny(FeatureStartSearcher);
+                if (result != null)
+                {
+                    TokenizeRegex(content, pos, next == -1 ? textEnd : pos + next, result);
+                }
+                if (next == -1)
+                {
+                    break;
+                }
+
+                int featureBegin = pos + next;
+                int type = MatchBoundedType(content.AsSpan(featureBegin, textEnd - featureBegin));
+                var entry = BoundedTypes[type];
+                pos = FindBoundedEnd(content, featureBegin + entry.begin.Length, end, entry, out bool closed);
+                result?.Add(new Token(entry.token, featureBegin, pos - 1));
+                if (!closed)
+                {
+                    return type;
+                }
+            }
+            return -1;
+        }
+
+        /* longest begin wins, so """ is not taken for empty "" string */
+        private int MatchBoundedType(ReadOnlySpan<char> span)
+        {
+            int found = -1;
+            for (int i = 0; i < BoundedTypes.Length; i++)
+            {
+                if (span.StartsWith(BoundedTypes[i].begin) && (found == -1 || BoundedTypes[i].begin.Length > BoundedTypes[found].begin.Length))
                 {
-                    filtered.Add(regexResult[(int)regexPos]);
-                    regexPos++;
+                    found = i;
                 }
-                result.AddRange(filtered);
             }
+            return found;
+        }
 
-            result.Sort((x, y) => x.begin.CompareTo(y.begin));
+        /* returns position after end of bounded token within line, closed is false if it continues on next line */
+        private static int FindBoundedEnd(string content, int from, int end, TypeEntry entry, out bool closed)
+        {
+            int pos = from;
+            while (pos < end)
+            {
+                int found = content.AsSpan(pos, end - pos).IndexOfAny(entry.endSearcher);
+                if (found == -1)
+                {
+                    break;
+                }
+                found += pos;
 
-            return UpdateTokensAsUTF8(content, result);
+                if (IsEscaped(content, from, found, entry.escapeSeq))
+                {
+                    pos = found + 1;
+                    continue;
+                }
+                if (entry.end != null && content.AsSpan(found).StartsWith(entry.end))
+                {
+                    closed = true;
+                    return found + entry.end.Length;
+                }
+                // newline before end
+                closed = !entry.multiline;
+                return found + 1;
+            }
+            // escaped newline or end of content
+            closed = !entry.multiline || pos < end;
+            return end;
+        }
+
+        private static bool IsEscaped(string content, int from, int position, string? escapeSeq)
+        {
+            if (escapeSeq == null)
+            {
+                return false;
+            }
+            int count = 0;
+            while (position - escapeSeq.Length >= from && content.AsSpan(position - escapeSeq.Length, escapeSeq.Length).SequenceEqual(escapeSeq))
+            {
+                position -= escapeSeq.Length;
+                count++;
+            }
+            return count % 2 == 1;
+        }
+
+        private void TokenizeRegex(string content, int begin, int end, List<Token> result)
+        {
+            if (begin >= end)
+            {
+                return;
+            }
+            for (Match m = LineTokenizer.Match(content, begin, end - begin); m.Success; m = m.NextMatch())
+            {
+                if (m.Length == 0)
+                {
+                    continue;
+                }
+                foreach (var entry in GroupMap)
+                {
+                    if (m.Groups[entry.Id].Success)
+                    {
+                        result.Add(new Token(entry.Type, m.Index, m.Index + m.Length - 1));
+                        break;
+                    }
+                }
+            }
         }
     }
 }
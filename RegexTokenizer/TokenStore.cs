@@ -0,0 +1,267 @@
+﻿using System;
+using System.Collections.Generic;
+
+namespace RegexTokenizer
+{
+    /*
+        immutable storage of sorted tokens: tokens are split into blocks, block keeps types, begins relative
+        to block base and lengths in separate arrays, blocks are shared between stores so shifting tokens
+        after edit only creates new block headers
+    */
+    public sealed class TokenStore
+    {
+        public const int BlockSize = 1024;
+
+        private sealed class Block(long @base, TokenType[] types, int[] begins, int[] lengths)
+        {
+            public readonly long Base = @base;
+            public readonly TokenType[] Types = types;
+            public readonly int[] Begins = begins;
+            public readonly int[] Lengths = lengths;
+
+            public int Count => Types.Length;
+            public long LastBegin => Base + Begins[^1];
+
+            public Token this[int index] => new(Types[index], Base + Begins[index], Base + Begins[index] + Lengths[index]);
+
+            public Block Shift(long delta) => new(Base + delta, Types, Begins, Lengths);
+
+            /* index of first token with begin >= position, Count if there is no such */
+            public int LowerBound(long position)
+            {
+                int lo = 0, hi = Count;
+                while (lo < hi)
+                {
+                    int mid = (lo + hi) / 2;
+                    if (Base + Begins[mid] < position)
+                    {
+                        lo = mid + 1;
+                    }
+                    else
+                    {
+                        hi = mid;
+                    }
+                }
+                return lo;
+            }
+        }
+
+        private sealed class Builder
+        {
+            private readonly List<Block> blocks = [];
+            private TokenType[] types = new TokenType[BlockSize];
+            private int[] begins = new int[BlockSize];
+            private int[] lengths = new int[BlockSize];
+            private int count = 0;
+            private long @base = 0;
+
+            public void Add(Token token)
+            {
+                if (count == BlockSize || (count > 0 && token.begin - @base > int.MaxValue))
+                {
+                    Flush();
+                }
+                if (count == 0)
+                {
+                    @base = token.begin;
+                }
+                types[count] = token.type;
+                begins[count] = (int)(token.begin - @base);
+                lengths[count] = (int)Math.Clamp(token.end - token.begin, int.MinValue, int.MaxValue);
+                count++;
+            }
+
+            public void AddBlock(Block block, long delta)
+            {
+                /* small pieces left after splice are merged into one block */
+                if (count > 0 && count + block.Count <= BlockSize)
+                {
+                    for (int i = 0; i < block.Count; i++)
+                    {
+                        var token = block[i];
+                        Add(new Token(token.type, token.begin + delta, token.end + delta));
+                    }
+                    return;
+                }
+                Flush();
+                blocks.Add(delta == 0 ? block : block.Shift(delta));
+            }
+
+            private void Flush()
+            {
+                if (count == 0)
+                {
+                    return;
+                }
+                if (count == BlockSize)
+                {
+                    blocks.Add(new Block(@base, types, begins, lengths));
+                    types = new TokenType[BlockSize];
+                    begins = new int[BlockSize];
+                    lengths = new int[BlockSize];
+                }
+                else
+                {
+                    blocks.Add(new Block(@base, types[..count], begins[..count], lengths[..count]));
+                }
+                count = 0;
+            }
+
+            public TokenStore ToStore(object? lexerState)
+            {
+                Flush();
+                return new TokenStore([.. blocks], lexerState);
+            }
+        }
+
+        /* position in store, walks tokens in order */
+        public struct Cursor
+        {
+            private readonly TokenStore? store;
+            private int block;
+            private int index;
+
+            internal Cursor(TokenStore store, int block, int index)
+            {
+                this.store = store;
+                this.block = block;
+                this.index = index;
+            }
+
+            public readonly bool Valid => store != null && block < store.Blocks.Length;
+
+            public readonly Token Current => store!.Blocks[block][index];
+
+            public void MoveNext()
+            {
+                if (++index >= store!.Blocks[block].Count)
+                {
+                    block++;
+                    index = 0;
+                }
+            }
+        }
+
+        public static readonly TokenStore Empty = new([], null);
+
+        private readonly Block[] Blocks;
+
+        /* index of first token of each block */
+        private readonly int[] BlockStarts;
+
+        public int Count { get; }
+
+        /* state of tokenizer at end of parse which produced store, incremental update of these tokens continues from it */
+        public object? LexerState { get; }
+
+        private TokenStore(Block[] blocks, object? lexerState)
+        {
+            Blocks = blocks;
+            LexerState = lexerState;
+            BlockStarts = new int[blocks.Length];
+            int count = 0;
+            for (int i = 0; i < blocks.Length; i++)
+            {
+                BlockStarts[i] = count;
+                count += blocks[i].Count;
+            }
+            Count = count;
+        }
+
+        public static TokenStore Create(IEnumerable<Token> tokens, object? lexerState = null)
+        {
+            Builder builder = new();
+            foreach (var token in tokens)
+            {
+                builder.Add(token);
+            }
+            return builder.ToStore(lexerState);
+        }
+
+        public Token this[int index]
+        {
+            get
+            {
+                int block = Array.BinarySearch(BlockStarts, index);
+                block = block < 0 ? ~block - 1 : block;
+                return Blocks[block][index - BlockStarts[block]];
+            }
+        }
+
+        /* cursor at last token which begins before position (it may cover it) or at first one if there is no such */
+        public Cursor Seek(long position)
+        {
+            int lo = 0, hi = Blocks.Length;
+            while (lo < hi)
+            {
+                int mid = (lo + hi) / 2;
+                if (Blocks[mid].Base < position)
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+            if (lo == 0)
+            {
+                return new Cursor(this, 0, 0);
+            }
+            int block = lo - 1;
+            int index = Blocks[block].LowerBound(position) - 1;
+            return new Cursor(this, block, index);
+        }
+
+        /*
+            new store with tokens which begin before from, then replacement tokens,
+            then tokens which begin at resume or later moved by delta
+        */
+        public TokenStore Splice(long from, IEnumerable<Token> replacement, long resume, long delta, object? lexerState = null)
+        {
+            Builder builder = new();
+
+            int block = 0;
+            for (; block < Blocks.Length && Blocks[block].LastBegin < from; block++)
+            {
+                builder.AddBlock(Blocks[block], 0);
+            }
+            if (block < Blocks.Length)
+            {
+                int end = Blocks[block].LowerBound(from);
+                for (int i = 0; i < end; i++)
+                {
+                    builder.Add(Blocks[block][i]);
+                }
+            }
+
+            foreach (var token in replacement)
+            {
+                builder.Add(token);
+            }
+
+            for (; block < Blocks.Length && Blocks[block].LastBegin < resume; block++)
+            {
+            }
+            if (block < Blocks.Length)
+            {
+                int begin = Blocks[block].LowerBound(resume);
+                if (begin > 0)
+                {
+                    for (int i = begin; i < Blocks[block].Count; i++)
+                    {
+                        var token = Blocks[block][i];
+                        builder.Add(new Token(token.type, token.begin + delta, token.end + delta));
+                    }
+                    block++;
+                }
+                for (; block < Blocks.Length; block++)
+                {
+                    builder.AddBlock(Blocks[block], delta);
+                }
+            }
+
+            return builder.ToStore(lexerState);
+        }
+    }
+}
@@ -7,7 +7,7 @@ using System.Threading.Tasks;
 
 namespace RegexTokenizer
 {
-    public enum TokenType
+    public enum TokenType : byte
     {
         Comment,
         MultilineComment,
@@ -49,9 +49,15 @@ namespace TextBuffer
         [LibraryImport("msrope.dll")]
         internal static partial void state_commit(IntPtr project, IntPtr state);
 
+        [LibraryImport("msrope.dll")]
+        internal static partial int state_replace_all(IntPtr project, IntPtr state, long count, [In] MarshalingReplaceMatch[] matches, long replacements_length, byte[] replacements);
+
         [LibraryImport("msrope.dll")]
         internal static partial long state_get_size(IntPtr state);
 
+        [LibraryImport("msrope.dll")]
+        internal static partial void state_get_hash(IntPtr state, [Out] long[] hash);
+
         [LibraryImport("msrope.dll")]
         internal static partial void state_read(IntPtr state, long position, long length, IntPtr buffer);
 
@@ -67,6 +73,9 @@ namespace TextBuffer
         [LibraryImport("msrope.dll")]
         internal static partial void project_get_states(IntPtr project, long states_count, [Out] IntPtr[] states, long links_count, [Out] MarshalingLink[] links);
 
+        [LibraryImport("msrope.dll")]
+        internal static partial long project_get_changes(IntPtr project, long since, ref long count, [Out] MarshalingStateChange[] changes, ref long children_count, [Out] IntPtr[] children);
+
         [LibraryImport("msrope.dll")]
         internal static partial IntPtr state_resolve(IntPtr state);
 
@@ -94,6 +103,15 @@ namespace TextBuffer
         [LibraryImport("msrope.dll")]
         internal static partial long state_nth_newline(IntPtr state, long position);
 
+        [LibraryImport("msrope.dll")]
+        internal static partial void state_linecol_to_offsets(IntPtr state, long count, long[] linecols, [Out] long[] offsets);
+
+        [LibraryImport("msrope.dll")]
+        internal static partial void state_offsets_to_linecol(IntPtr state, long count, long[] offsets, [Out] long[] linecols);
+
+        [LibraryImport("msrope.dll")]
+        internal static partial long state_read_lines(IntPtr state, long firstLine, long count, long firstCol, long maxCols, [Out] long[] offsets, [Out] byte[] buffer, long bufferSize);
+
         [LibraryImport("msrope.dll")]
         internal static partial void msrope_init();
 
@@ -69,6 +69,25 @@ namespace TextBuffer
             return data;
         }
 
+        public byte[] SubBytesEx(IntPtr state, long pos, long len)
+        {
+            byte[] data = new byte[len];
+            CLibrary.state_read(state, pos, len, data);
+            return data;
+        }
+
+        public void ReadBytesEx(IntPtr state, long pos, long len, byte[] destination)
+        {
+            CLibrary.state_read(state, pos, len, destination);
+        }
+
+        public UInt128 ContentHashEx(IntPtr state)
+        {
+            long[] hash = new long[2];
+            CLibrary.state_get_hash(state, hash);
+            return new UInt128(unchecked((ulong)hash[1]), unchecked((ulong)hash[0]));
+        }
+
         public string SubstringEx(IntPtr state, long pos, long len)
         {
             IntPtr destPtr = Marshal.AllocHGlobal((int)(len + 10));
@@ -180,6 +199,13 @@ namespace TextBuffer
 
         public void Clear() => RemoveAt(0, Length);
 
+        public bool ReplaceAll(MarshalingReplaceMatch[] matches, byte[] replacements)
+        {
+            if (matches.Length == 0) return true;
+            undos.Clear();
+            return CLibrary.state_replace_all(project, curr_state, matches.LongLength, matches, replacements.LongLength, replacements) == 0;
+        }
+
         public void PushHistory()
         {
             // TODO: this
@@ -210,6 +236,24 @@ namespace TextBuffer
             return (states, links);
         }
 
+        public (long next, MarshalingStateChange[] changes, IntPtr[] children) GetVersionChanges(long since)
+        {
+            MarshalingStateChange[] changes = new MarshalingStateChange[256];
+            IntPtr[] children = new IntPtr[256];
+            while (true)
+            {
+                long count = changes.Length, childrenCount = children.Length;
+                long next = CLibrary.project_get_changes(project, since, ref count, changes, ref childrenCount, children);
+                if (count <= changes.Length && childrenCount <= children.Length)
+                {
+                    return (next, changes[..(int)count], children[..(int)childrenCount]);
+                }
+                /* graph grew between calls, sizes are asked again with bigger arrays */
+                changes = new MarshalingStateChange[Math.Max(count, changes.Length) * 2];
+                children = new IntPtr[Math.Max(childrenCount, children.Length) * 2];
+            }
+        }
+
 
         [LibraryImport("kernel32.dll", EntryPoint = "ReplaceFileW", SetLastError = true, StringMarshalling = StringMarshalling.Utf16)]
         [return: MarshalAs(UnmanagedType.Bool)]
@@ -302,6 +346,26 @@ namespace TextBuffer
             return startPos + col;
         }
 
+        public long[] GetPositions(long[] lineColumns)
+        {
+            long[] positions = new long[lineColumns.Length / 2];
+            CLibrary.state_linecol_to_offsets(curr_state, positions.Length, lineColumns, positions);
+            return positions;
+        }
+
+        public long[] GetPositionsOffsets(long[] positions)
+        {
+            long[] lineColumns = new long[positions.Length * 2];
+            CLibrary.state_offsets_to_linecol(curr_state, positions.Length, positions, lineColumns);
+            return lineColumns;
+        }
+
+        public int ReadLines(long firstLine, int count, long firstColumn, long maxColumns, long[] lines, byte[] buffer)
+        {
+            count = Math.Min(count, lines.Length / 2);
+            return (int)CLibrary.state_read_lines(curr_state, firstLine, count, firstColumn, maxColumns, lines, buffer, buffer.Length);
+        }
+
         public (long index, long length) GetLineOffsets(long line)
         {
             if (line < 0) return (0, 0);
@@ -79,6 +79,47 @@ namespace TextBuffer
             return lineOffsets[(int)line] + col;
         }
 
+        public long[] GetPositions(long[] lineColumns)
+        {
+            long[] positions = new long[lineColumns.Length / 2];
+            for (int i = 0; i < positions.Length; i++)
+            {
+                positions[i] = GetPosition(lineColumns[2 * i], lineColumns[2 * i + 1]);
+            }
+            return positions;
+        }
+
+        public long[] GetPositionsOffsets(long[] positions)
+        {
+            long[] lineColumns = new long[positions.Length * 2];
+            for (int i = 0; i < positions.Length; i++)
+            {
+                (lineColumns[2 * i], lineColumns[2 * i + 1]) = GetPositionOffsets(positions[i]);
+            }
+            return lineColumns;
+        }
+
+        public int ReadLines(long firstLine, int count, long firstColumn, long maxColumns, long[] lines, byte[] buffer)
+        {
+            count = Math.Min(count, lines.Length / 2);
+            int written = 0, read = 0;
+            for (; read < count; read++)
+            {
+                (long index, long length) = GetLineOffsets(firstLine + read);
+                if (length == 0) break;
+                long text = content[(int)(index + length - 1)] == '\n' ? length - 1 : length;
+                long skip = Math.Min(firstColumn, text);
+                index += skip;
+                length = firstColumn <= text ? Math.Min(length - skip, maxColumns) : 0;
+                /* line is encoded only if its bytes fit, worst case size would drop last lines of full buffer */
+                if (!Encoding.UTF8.TryGetBytes(content.AsSpan((int)index, (int)length), buffer.AsSpan(written), out int bytes)) break;
+                lines[2 * read] = index;
+                lines[2 * read + 1] = bytes;
+                written += bytes;
+            }
+            return read;
+        }
+
         public long NearestNewlineLeft(long offset)
         {
             if (offset <= 0) return 0;
@@ -127,6 +168,26 @@ namespace TextBuffer
             return Encoding.UTF8.GetBytes(Substring(pos, len));
         }
 
+        public byte[] SubBytesEx(IntPtr state, long pos, long len) => SubBytes(pos, len);
+
+        public void ReadBytesEx(IntPtr state, long pos, long len, byte[] destination) => SubBytes(pos, len).CopyTo(destination, 0);
+
+        public UInt128 ContentHashEx(IntPtr state)
+        {
+            /* two fnv-1a lanes over chars */
+            ulong hi = 0xCBF29CE484222325, lo = 0x84222325CBF29CE4;
+            unchecked
+            {
+                foreach (char c in content)
+                {
+                    hi = (hi ^ c) * 0x100000001B3;
+                    lo = (lo ^ (ulong)(c + 0x9E37)) * 0x100000001B3;
+                }
+                hi += (ulong)content.Length;
+            }
+            return new UInt128(hi, lo);
+        }
+
         ~ReadonlyTextBuffer()
         {
             Dispose();
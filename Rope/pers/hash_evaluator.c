@@ -4,12 +4,14 @@
 #include "text_api.h"
 
 
-static void CalculateHash(struct state *state)
+static void EvaluateHash(struct state *state, int64_t *hash)
 {
-	int64_t h_hi = 0xCBF29CE484222325, h_lo = 0xCBF29CE484222325, i = 0, len = SegmentLength(state->value);
-	int64_t buffer[8*1024] = {}; // 64 kb block
+	/* unsigned, so multiplication wraps around */
+	uint64_t h_hi = 0xCBF29CE484222325, h_lo = 0xCBF29CE484222325;
+	int64_t i = 0, len = SegmentLength(state->value);
+	uint64_t buffer[8*1024] = {}; // 64 kb block
 	h_hi += len;
-	h_lo -= len * len;
+	h_lo -= (uint64_t)len * len;
 	/* calculate hash */
 	for (; i + sizeof(buffer) < len; i += sizeof(buffer))
 	{
@@ -28,18 +30,54 @@ static void CalculateHash(struct state *state)
 		state_read(state, i, len - i, (char *)buffer);
 		for (int64_t t = 0; t < sizeof(buffer) / sizeof(*buffer); t += 2)
 		{
-			h_hi ^= buffer[0];
-			h_lo ^= buffer[1];
+			h_hi ^= buffer[t+0];
+			h_lo ^= buffer[t+1];
 			h_hi *= 0x100000001B3;
 			h_lo *= 0x100000001B3;
 		}
 	}
 	h_hi += len;
 	h_lo -= len;
-	state->hash.total_hash[0] = h_lo;
-	state->hash.total_hash[1] = h_hi;
-	state->hash.calculated = 1;
-	Log(LogInfo, "hash of state %p is %llx%llx", state, h_hi, h_lo);
+	hash[0] = h_lo;
+	hash[1] = h_hi;
+}
+
+
+/* worker and state_get_hash may evaluate the same state, only the first result is published */
+static void CalculateHash(struct state *state)
+{
+	int64_t hash[2];
+	EvaluateHash(state, hash);
+	lockExclusive(&state->hash.lock);
+	if (!atomic_load_explicit(&state->hash.calculated, memory_order_relaxed))
+	{
+		state->hash.total_hash[0] = hash[0];
+		state->hash.total_hash[1] = hash[1];
+		atomic_store_explicit(&state->hash.calculated, 1, memory_order_release);
+		Log(LogInfo, "hash of state %p is %llx%llx", state, hash[1], hash[0]);
+	}
+	freeExclusive(&state->hash.lock);
+}
+
+
+void state_get_hash(struct state *state, int64_t *hash)
+{
+	while (state->merged_to) state = state->merged_to;
+	if (atomic_load_explicit(&state->hash.calculated, memory_order_acquire))
+	{
+		hash[0] = state->hash.total_hash[0];
+		hash[1] = state->hash.total_hash[1];
+		return;
+	}
+	/* text of committed state can't change, so its hash is kept for merger */
+	if (state->committed)
+	{
+		CalculateHash(state);
+		hash[0] = state->hash.total_hash[0];
+		hash[1] = state->hash.total_hash[1];
+		return;
+	}
+	EvaluateHash(state, hash);
 }
 
 
@@ -1,6 +1,7 @@
 #include "assert.h"
 #include "inttypes.h"
 #include "stdatomic.h"
+#include "string.h"
 
 #include "structure.h"
 
@@ -537,3 +538,358 @@ int64_t SegmentGetLineNumber(int64_t inode, int64_t position)
     update_weak_ptr(node);
     return count;
 }
+
+
+struct position_query
+{
+    int64_t key;
+    int64_t index;
+};
+
+static int compare_queries(const void *a, const void *b)
+{
+    int64_t ka = ((const struct position_query *)a)->key, kb = ((const struct position_query *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+/* state of in-order sweep: offset of current node, newlines before it and position of the last of them */
+struct line_sweep
+{
+    int64_t position;
+    int64_t lines;
+    int64_t last_newline;
+    int64_t next;
+};
+
+static int64_t exact_newlines(int64_t node)
+{
+    if (!node) return 0;
+    if (_cnt(node) < 0)
+    {
+        have_node_newlines(&glb_nodes[node], INT64_MAX);
+    }
+    assert(_cnt(node) >= 0);
+    return _cnt(node);
+}
+
+static void offsets_sweep(int64_t node, struct line_sweep *sweep, const struct position_query *queries, int64_t count, int64_t *linecols)
+{
+    if (!node || sweep->next >= count) return;
+    struct segment *tree = &glb_nodes[node];
+
+    if (queries[sweep->next].key >= sweep->position + tree->total_length)
+    {
+        /* no query inside, whole subtree is skipped */
+        int64_t newlines = exact_newlines(node);
+        if (newlines > 0)
+        {
+            sweep->last_newline = sweep->position + FindNearestLeft(node, tree->total_length - 1);
+        }
+        sweep->lines += newlines;
+        sweep->position += tree->total_length;
+        return;
+    }
+
+    offsets_sweep(tree->left, sweep, queries, count, linecols);
+    const char *data = tree->buffer->buffer + tree->offset;
+    for (int64_t i = 0; i < tree->length && sweep->next < count; i++)
+    {
+        while (sweep->next < count && queries[sweep->next].key == sweep->position)
+        {
+            int64_t index = queries[sweep->next++].index;
+            linecols[2 * index] = sweep->lines;
+            linecols[2 * index + 1] = sweep->position - (sweep->last_newline + 1);
+        }
+        if (data[i] == '\n')
+        {
+            sweep->lines++;
+            sweep->last_newline = sweep->position;
+        }
+        sweep->position++;
+    }
+    offsets_sweep(tree->right, sweep, queries, count, linecols);
+}
+
+/*
+    line and column of each offset, same as SegmentGetLineNumber and FindNearestLeft would give,
+    but queries are sorted and answered in one in-order sweep. linecols gets pairs line, column
+*/
+void SegmentOffsetsToLinecol(int64_t node, int64_t count, const int64_t *offsets, int64_t *linecols)
+{
+    struct position_query *queries = malloc(sizeof(*queries) * (count ? count : 1));
+    for (int64_t i = 0; i < count; i++)
+    {
+        queries[i].key = offsets[i];
+        queries[i].index = i;
+    }
+    qsort(queries, count, sizeof(*queries), compare_queries);
+
+    struct line_sweep sweep = { 0, 0, -1, 0 };
+    while (sweep.next < count && queries[sweep.next].key <= 0)
+    {
+        int64_t index = queries[sweep.next++].index;
+        linecols[2 * index] = 0;
+        linecols[2 * index + 1] = 0;
+    }
+    offsets_sweep(node, &sweep, queries, count, linecols);
+    /* offsets at end of text or after it */
+    for (; sweep.next < count; sweep.next++)
+    {
+        int64_t index = queries[sweep.next].index;
+        linecols[2 * index] = sweep.lines;
+        linecols[2 * index + 1] = queries[sweep.next].key - (sweep.last_newline + 1);
+    }
+    free(queries);
+}
+
+static void starts_sweep(int64_t node, struct line_sweep *sweep, const struct position_query *queries, int64_t count, int64_t *starts)
+{
+    if (!node || sweep->next >= count) return;
+    struct segment *tree = &glb_nodes[node];
+
+    /* line n starts after newline number n - 1 */
+    int64_t newlines = exact_newlines(node);
+    if (queries[sweep->next].key > sweep->lines + newlines)
+    {
+        sweep->lines += newlines;
+        sweep->position += tree->total_length;
+        return;
+    }
+
+    starts_sweep(tree->left, sweep, queries, count, starts);
+    if (sweep->next >= count) return;
+    _update_newlines(tree);
+    if (queries[sweep->next].key > sweep->lines + tree->newlines)
+    {
+        sweep->lines += tree->newlines;
+    }
+    else
+    {
+        const char *data = tree->buffer->buffer + tree->offset;
+        for (int64_t i = 0; i < tree->length && sweep->next < count; i++)
+        {
+            if (data[i] != '\n') continue;
+            sweep->lines++;
+            while (sweep->next < count && queries[sweep->next].key == sweep->lines)
+            {
+                starts[queries[sweep->next++].index] = sweep->position + i + 1;
+            }
+        }
+    }
+    sweep->position += tree->length;
+    starts_sweep(tree->right, sweep, queries, count, starts);
+}
+
+/* offset of start of each line, -1 for lines which don't exist */
+void SegmentLineStarts(int64_t node, int64_t count, const int64_t *lines, int64_t *starts)
+{
+    struct position_query *queries = malloc(sizeof(*queries) * (count ? count : 1));
+    for (int64_t i = 0; i < count; i++)
+    {
+        queries[i].key = lines[i];
+        queries[i].index = i;
+        starts[i] = -1;
+    }
+    qsort(queries, count, sizeof(*queries), compare_queries);
+
+    struct line_sweep sweep = { 0, 0, -1, 0 };
+    while (sweep.next < count && queries[sweep.next].key <= 0)
+    {
+        if (queries[sweep.next].key == 0)
+        {
+            starts[queries[sweep.next].index] = 0;
+        }
+        sweep.next++;
+    }
+    starts_sweep(node, &sweep, queries, count, starts);
+    free(queries);
+}
+
+/* state of lines read: current line of sweep and bytes of it copied so far */
+struct lines_read
+{
+    int64_t position;
+    int64_t lines;
+    int64_t first_line;
+    int64_t count;
+    int64_t first_col;
+    int64_t max_cols;
+    int64_t *offsets;
+    char *buffer;
+    int64_t buffer_size;
+    int64_t written;
+    int64_t line_written;
+    int64_t line_skipped;
+    int64_t started;
+    int64_t copying;
+    int64_t done;
+};
+
+static int64_t lines_read_finished(const struct lines_read *read)
+{
+    return read->done >= read->count || read->written >= read->buffer_size;
+}
+
+static void lines_read_data(struct lines_read *read, const char *data, int64_t length)
+{
+    int64_t i = 0;
+    while (i < length && !lines_read_finished(read))
+    {
+        const char *newline = memchr(data + i, '\n', length - i);
+        int64_t end = newline ? newline - data + 1 : length;
+        if (read->lines >= read->first_line)
+        {
+            int64_t line = read->lines - read->first_line;
+            int64_t from = i;
+            read->started = 1;
+            /* bytes before first_col are skipped, newline isn't. offset is moved until copy starts */
+            if (!read->copying)
+            {
+                int64_t skip = read->first_col - read->line_skipped;
+                int64_t text_end = newline ? end - 1 : end;
+                if (skip > text_end - from) skip = text_end - from;
+                from += skip;
+                read->line_skipped += skip;
+                read->offsets[2 * line] = read->position + from;
+                read->copying = read->line_skipped >= read->first_col;
+            }
+            int64_t size = read->copying ? end - from : 0;
+            if (size > read->max_cols - read->line_written) size = read->max_cols - read->line_written;
+            if (size > read->buffer_size - read->written) size = read->buffer_size - read->written;
+            if (size > 0)
+            {
+                memcpy(read->buffer + read->written, data + from, size);
+                read->written += size;
+                read->line_written += size;
+            }
+            if (newline)
+            {
+                read->offsets[2 * line + 1] = read->line_written;
+                read->line_written = 0;
+                read->line_skipped = 0;
+                read->started = 0;
+                read->copying = 0;
+                read->done++;
+            }
+        }
+        if (newline) read->lines++;
+        i = end;
+    }
+    read->position += length;
+}
+
+static void lines_sweep(int64_t node, struct lines_read *read)
+{
+    if (!node || lines_read_finished(read)) return;
+    struct segment *tree = &glb_nodes[node];
+
+    /*
+        subtree is before first line, inside of line which already has max_cols bytes or inside of columns
+        before first_col, so seek to column of long line costs the same as seek to line
+    */
+    int64_t newlines = exact_newlines(node);
+    int64_t full = read->copying && read->line_written >= read->max_cols;
+    int64_t skipped = read->lines >= read->first_line && !read->copying && read->line_skipped + tree->total_length < read->first_col;
+    if (read->first_line > read->lines + newlines || ((full || skipped) && newlines == 0))
+    {
+        if (skipped)
+        {
+            read->line_skipped += tree->total_length;
+            read->started = 1;
+        }
+        read->lines += newlines;
+        read->position += tree->total_length;
+        return;
+    }
+
+    lines_sweep(tree->left, read);
+    if (lines_read_finished(read)) return;
+    _update_newlines(tree);
+    if (read->first_line > read->lines + tree->newlines)
+    {
+        read->lines += tree->newlines;
+        read->position += tree->length;
+    }
+    else
+    {
+        lines_read_data(read, tree->buffer->buffer + tree->offset, tree->length);
+    }
+    lines_sweep(tree->right, read);
+}
+
+/*
+    copies up to count lines from first_line one after another into buffer, max_cols bytes of each starting
+    at byte first_col of line. first line is found by descent over newline counts, the rest by in-order walk
+    from it. offsets gets pairs offset of first copied byte in text, bytes of line in buffer. line shorter
+    than first_col gives its end and no bytes. returns count of lines read
+*/
+int64_t SegmentReadLines(int64_t node, int64_t first_line, int64_t count, int64_t first_col, int64_t max_cols, int64_t *offsets, char *buffer, int64_t buffer_size)
+{
+    if (first_line < 0 || count <= 0 || first_col < 0 || max_cols <= 0) return 0;
+    struct lines_read read = { 0, 0, first_line, count, first_col, max_cols, offsets, buffer, buffer_size, 0, 0, 0, 0, 0, 0 };
+    lines_sweep(node, &read);
+    /* last line without newline at end of text */
+    if (read.started && read.done < count)
+    {
+        if (!read.copying) read.offsets[2 * (read.lines - first_line)] = read.position;
+        read.offsets[2 * (read.lines - first_line) + 1] = read.line_written;
+        read.done++;
+    }
+    return read.done;
+}
+
+
+static void collect_internal(int64_t node, struct segment_info *result, int64_t *len)
+{
+    if (!node) return;
+    collect_internal(glb_nodes[node].left, result, len);
+    memcpy(&result[(*len)++], &glb_nodes[node], sizeof(struct segment_info));
+    collect_internal(glb_nodes[node].right, result, len);
+}
+
+static int64_t count_internal(int64_t node)
+{
+    if (!node) return 0;
+    return count_internal(glb_nodes[node].left) + 1 + count_internal(glb_nodes[node].right);
+}
+
+/*
+    get all segments of tree in order, result must be freed by caller
+*/
+struct segment_info *SegmentCollect(struct segment *tree, int64_t *result_len)
+{
+    int64_t root_idx = (tree ? tree - glb_nodes : 0);
+    struct segment_info *result = malloc(sizeof(*result) * (count_internal(root_idx) + 1));
+    *result_len = 0;
+    collect_internal(root_idx, result, result_len);
+    return result;
+}
+
+static int64_t build_internal(struct segment_info *infos, int64_t begin, int64_t end, int64_t ver)
+{
+    if (begin >= end) return 0;
+    int64_t mid = begin + (end - begin) / 2;
+
+    int64_t new_node = glb_next_node++;
+    reserve_nodes(new_node);
+    memset(&glb_nodes[new_node], 0, sizeof(glb_nodes[new_node]));
+    memcpy(&glb_nodes[new_node], &infos[mid], sizeof(infos[mid]));
+    glb_nodes[new_node].version_id = ver;
+
+    int64_t tmp = build_internal(infos, begin, mid, ver);
+    glb_nodes[new_node].left = tmp;
+    tmp = build_internal(infos, mid + 1, end, ver);
+    glb_nodes[new_node].right = tmp;
+    update_weak(new_node);
+    return new_node;
+}
+
+/*
+    build balanced tree from given segments in one pass, all nodes are created in this_version.
+    segments with unknown count of newlines must have newlines = -1
+*/
+struct segment *BuildSegments(struct segment_info *infos, int64_t count, int64_t this_version)
+{
+    int64_t new_root = build_internal(infos, 0, count, this_version);
+    return new_root ? &glb_nodes[new_root] : NULL;
+}
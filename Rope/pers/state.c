@@ -57,6 +57,7 @@ struct state *state_create_empty(struct project *project)
 
     _reserve_states(project, project->states_len + 1);
     project->states[project->states_len++] = res;
+    _project_log_change(project, res);
     freeExclusive(&project->lock);
 
     return res;
@@ -75,6 +76,7 @@ struct state *project_open_file(struct project *project, const char *filename)
 
     _reserve_states(project, project->states_len + 1);
     project->states[project->states_len++] = res;
+    _project_log_change(project, res);
     freeExclusive(&project->lock);
 
     /* now we need to open file */
@@ -95,7 +97,7 @@ int project_save_file(struct project* project, struct state* state, const char*
         return 1;
     }
     while (state->merged_to) state = state->merged_to;
-    merge_state(result_state, state);
+    merge_state(project, result_state, state);
     return 0;
 }
 
@@ -109,22 +111,24 @@ struct state *state_create_dup(struct project *project, struct state *state)
     res->timestamp = get_time_us();
     res->name = NULL;
 
-    _reserve_previous_versions(res, res->previous_versions_len + 1);
-    res->previous_versions[res->previous_versions_len++] = state;
-
-    _reserve_next_versions(state, state->next_versions_len + 1);
-    state->next_versions[state->next_versions_len++] = res;
-
     res->value = state->value;
     res->committed = 0;
     res->hash.calculated = 0;
 
     lockExclusive(&project->lock);
 
+    _reserve_previous_versions(res, res->previous_versions_len + 1);
+    res->previous_versions[res->previous_versions_len++] = state;
+
+    _reserve_next_versions(state, state->next_versions_len + 1);
+    state->next_versions[state->next_versions_len++] = res;
+
     res->version_id = project->last_version_id++;
 
     _reserve_states(project, project->states_len + 1);
     project->states[project->states_len++] = res;
+    _project_log_change(project, state);
+    _project_log_change(project, res);
 
     freeExclusive(&project->lock);
     return res;
@@ -144,9 +148,10 @@ struct state_info state_get_info(struct project *project, struct state *state)
     };
 }
 
-void merge_state(struct state *base, struct state *child)
+void merge_state(struct project *project, struct state *base, struct state *child)
 {
     assert(base != child);
+    lockExclusive(&project->lock);
     if (base->depth > child->depth)
     {
         void *tmp = child;
@@ -207,10 +212,22 @@ void merge_state(struct state *base, struct state *child)
             }
         }
     }
+    /* every state whose links were changed goes to change log */
+    for (int64_t i = 0; i < child->next_versions_len; ++i)
+    {
+        _project_log_change(project, child->next_versions[i]);
+    }
+    for (int64_t i = 0; i < child->previous_versions_len; ++i)
+    {
+        _project_log_change(project, child->previous_versions[i]);
+    }
     /* clear all child links */
     child->previous_versions_len = 0;
     child->next_versions_len = 0;
     child->merged_to = base;
+    _project_log_change(project, base);
+    _project_log_change(project, child);
+    freeExclusive(&project->lock);
 }
 
 void state_release(struct state *state)
@@ -294,9 +311,11 @@ void _state_insert_with_buffer(struct project *project, struct state *state, int
     }
 }
 
-void _state_insert(struct project *project, struct state *state, int64_t position, int64_t length, char *source)
+/*
+    reserve length bytes in project's add buffer, creating new buffer if needed
+*/
+void _project_append(struct project *project, int64_t length, struct mapped_buffer **result_buffer, int64_t *result_offset)
 {
-    /* create buffer for this moditification */
     struct mapped_buffer *buffer;
     int64_t offset;
 
@@ -328,6 +347,17 @@ void _state_insert(struct project *project, struct state *state, int64_t positio
     }
     freeExclusive(&project->lock);
 
+    *result_buffer = buffer;
+    *result_offset = offset;
+}
+
+void _state_insert(struct project *project, struct state *state, int64_t position, int64_t length, char *source)
+{
+    /* create buffer for this moditification */
+    struct mapped_buffer *buffer;
+    int64_t offset;
+
+    _project_append(project, length, &buffer, &offset);
     memcpy(buffer->buffer + offset, source, length);
 
     _state_insert_with_buffer(project, state, position, buffer, offset, length);
@@ -392,15 +422,110 @@ void state_moditify(struct project *project, struct state *state, int64_t positi
 }
 
 
-void state_commit(struct project *project, struct state *state)
+int state_replace_all(struct project *project, struct state *state, int64_t count, struct replace_match *matches, int64_t replacements_length, char *replacements)
 {
-    (void)project;
+    if (count == 0)
+    {
+        return 0;
+    }
+    while (state->merged_to) state = state->merged_to;
+    lockExclusive(&state->lock);
+    if (state->committed)
+    {
+        Log(LogError, "Moditifying of commited state");
+        freeExclusive(&state->lock);
+        return 1;
+    }
 
+    /* check matches and count maximal size of result */
+    int64_t total_length = SegmentLength(state->value), previous_end = 0, result_alloc = 1;
+    for (int64_t i = 0; i < count; ++i)
+    {
+        struct replace_match *match = &matches[i];
+        if (match->position < previous_end || match->length < 0 || match->position + match->length > total_length ||
+            match->replacement_offset < 0 || match->replacement_length < 0 || match->replacement_offset + match->replacement_length > replacements_length)
+        {
+            Log(LogError, "Replace match %lld is out of order or out of bounds", i);
+            freeExclusive(&state->lock);
+            return 1;
+        }
+        previous_end = match->position + match->length;
+        /* each match can split one segment into prefix and suffix */
+        result_alloc += 2 + match->replacement_length / SEGMENT_SIZE;
+    }
+
+    /* all replacements are stored using one append */
+    struct mapped_buffer *buffer = NULL;
+    int64_t offset = 0;
+    if (replacements_length > 0)
+    {
+        _project_append(project, replacements_length, &buffer, &offset);
+        memcpy(buffer->buffer + offset, replacements, replacements_length);
+    }
+
+    int64_t old_len;
+    struct segment_info *old = SegmentCollect(state->value, &old_len);
+    struct segment_info *result = malloc(sizeof(*result) * (old_len + result_alloc));
+    int64_t result_len = 0;
+
+    int64_t segment = 0, segment_position = 0, position = 0;
+    for (int64_t i = 0; i <= count; ++i)
+    {
+        int64_t target = (i < count ? matches[i].position : total_length);
+        /* copy untouched slices of old segments */
+        while (position < target)
+        {
+            while (segment_position + old[segment].length <= position)
+            {
+                segment_position += old[segment].length;
+                segment++;
+            }
+            int64_t from = position - segment_position;
+            int64_t to = old[segment].length;
+            if (to > target - segment_position) { to = target - segment_position; }
+            int64_t is_whole = (from == 0 && to == old[segment].length);
+            result[result_len++] = (struct segment_info) { old[segment].buffer, old[segment].offset + from, to - from, (is_whole ? old[segment].newlines : -1) };
+            position = segment_position + to;
+        }
+        if (i == count)
+        {
+            break;
+        }
+        /* insert replacement */
+        int64_t replacement_offset = offset + matches[i].replacement_offset;
+        int64_t replacement_length = matches[i].replacement_length;
+        while (replacement_length > 0)
+        {
+            int64_t to_insert = replacement_length;
+            if (to_insert > SEGMENT_SIZE) { to_insert = SEGMENT_SIZE; }
+            result[result_len++] = (struct segment_info) { buffer, replacement_offset, to_insert, -1 };
+            replacement_offset += to_insert;
+            replacement_length -= to_insert;
+        }
+        position = matches[i].position + matches[i].length;
+    }
+    free(old);
+
+    state->value = BuildSegments(result, result_len, state->version_id);
+    state->moditified = 1;
+    free(result);
+
+    freeExclusive(&state->lock);
+    return 0;
+}
+
+
+void state_commit(struct project *project, struct state *state)
+{
     if (!state->moditified)
     {
         if (state->previous_versions_len)
         {
+            lockExclusive(&project->lock);
             state->merged_to = state->previous_versions[0];
+            _project_log_change(project, state->previous_versions[0]);
+            _project_log_change(project, state);
+            freeExclusive(&project->lock);
         }
     }
     lockExclusive(&state->lock);
@@ -510,3 +635,35 @@ int64_t state_nth_newline(struct state *state, int64_t n)
     return SegmentNthNewline(id, n);
 }
 
+void state_linecol_to_offsets(struct state *state, int64_t count, const int64_t *linecols, int64_t *offsets)
+{
+    while (state->merged_to) state = state->merged_to;
+    int64_t id = (state->value ? state->value - glb_nodes : 0);
+    int64_t size = SegmentLength(state->value);
+    int64_t *lines = malloc(sizeof(*lines) * (count ? count : 1));
+    for (int64_t i = 0; i < count; i++)
+    {
+        lines[i] = linecols[2 * i];
+    }
+    SegmentLineStarts(id, count, lines, offsets);
+    for (int64_t i = 0; i < count; i++)
+    {
+        /* same as single conversion in buffer: missing lines and lines starting at end of text give 0 */
+        offsets[i] = (offsets[i] < 0 || offsets[i] >= size) ? 0 : offsets[i] + linecols[2 * i + 1];
+    }
+    free(lines);
+}
+
+void state_offsets_to_linecol(struct state *state, int64_t count, const int64_t *offsets, int64_t *linecols)
+{
+    while (state->merged_to) state = state->merged_to;
+    int64_t id = (state->value ? state->value - glb_nodes : 0);
+    SegmentOffsetsToLinecol(id, count, offsets, linecols);
+}
+
+int64_t state_read_lines(struct state *state, int64_t first_line, int64_t count, int64_t first_col, int64_t max_cols, int64_t *offsets, char *buffer, int64_t buffer_size)
+{
+    while (state->merged_to) state = state->merged_to;
+    int64_t id = (state->value ? state->value - glb_nodes : 0);
+    return SegmentReadLines(id, first_line, count, first_col, max_cols, offsets, buffer, buffer_size);
+}
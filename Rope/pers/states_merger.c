@@ -113,7 +113,7 @@ void rem(HashTable *table, Key128 k)
 }
 
 
-static struct state *TryMerge(HashTable *table, struct state *base, struct state *child)
+static struct state *TryMerge(struct project *project, HashTable *table, struct state *base, struct state *child)
 {
 	/* full compare of them */
 	int64_t len1 = SegmentLength(base->value), len2 = SegmentLength(child->value);
@@ -151,7 +151,7 @@ static struct state *TryMerge(HashTable *table, struct state *base, struct state
 	}
 	/* found same states: merge them */
 	Log(LogInfo, "states %p and %p are same!", base, child);
-	merge_state(base, child);
+	merge_state(project, base, child);
 	Log(LogInfo, "merged into %p", (base->merged_to ? child : base));
 	return (base->merged_to ? child : base);
 }
@@ -189,7 +189,7 @@ int StatesMergeWorker(void *param)
 		freeShared(&project->lock);
 		if (base != NULL && child != NULL)
 		{
-			struct state *result = TryMerge(&table, base, child);
+			struct state *result = TryMerge(project, &table, base, child);
 			if (result != NULL)
 			{
 				insert(&table, Key128(result->hash.total_hash), result);
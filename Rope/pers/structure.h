@@ -60,7 +60,8 @@ struct hash_segment
 struct state_hash
 {
     lock_t lock;
-    int64_t calculated;
+    /* set with release after total_hash is written, total_hash isn't changed after that */
+    _Atomic int64_t calculated;
     int64_t segments_len;
     struct hash_segment *segments;
     int64_t total_hash[2];
@@ -99,6 +100,8 @@ struct state
     struct state **next_versions;
 
     struct state *merged_to;
+
+    int64_t last_change; // index of latest entry of state in change log of project
     
     int64_t tags_len;
     int64_t *tags;
@@ -118,6 +121,11 @@ struct project
     _Atomic int64_t last_version_id;
     HANDLE StopEvent;
 
+    /* change log of version graph: state is added on its creation, merge or change of its links */
+    struct state **changes;
+    int64_t changes_len;
+    int64_t changes_alloc;
+
     thread_t HashWorker;
     thread_t StatesMerger;
 };
@@ -130,6 +138,8 @@ int64_t SegmentLength(struct segment *tree);
 int64_t FindNearestLeft(int64_t node_id, int64_t position);
 int64_t FindNearestRight(int64_t node_id, int64_t position);
 int64_t SegmentNthNewline(int64_t node, int64_t n);
+struct segment_info *SegmentCollect(struct segment *tree, int64_t *result_len);
+struct segment *BuildSegments(struct segment_info *infos, int64_t count, int64_t this_version);
 
 
 int64_t have_node_newlines(struct segment *node, int64_t at_least);
@@ -138,8 +148,12 @@ void state_release(struct state *state);
 void _reserve_states(struct project *project, int64_t total_size);
 void _reserve_buffers(struct project *project, int64_t total_size);
 void _project_add_buffer(struct project* project, struct mapped_buffer* buffer);
-void merge_state(struct state *base, struct state *child);
+void merge_state(struct project *project, struct state *base, struct state *child);
+void _project_log_change(struct project *project, struct state *state);
 int64_t SegmentGetLineNumber(int64_t root_idx, int64_t position);
+void SegmentOffsetsToLinecol(int64_t node, int64_t count, const int64_t *offsets, int64_t *linecols);
+void SegmentLineStarts(int64_t node, int64_t count, const int64_t *lines, int64_t *starts);
+int64_t SegmentReadLines(int64_t node, int64_t first_line, int64_t count, int64_t first_col, int64_t max_cols, int64_t *offsets, char *buffer, int64_t buffer_size);
 
 extern struct segment *glb_nodes;
 
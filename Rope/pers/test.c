@@ -120,11 +120,237 @@ void test_version_growth() {
     printf("PASSED\n");
 }
 
+void test_replace_all() {
+    printf("Test 5: Replace All... ");
+    struct project proj = {0};
+    proj.lock = (SRWLOCK)SRWLOCK_INIT;
+    proj.current_buffer = allocate_buffer(1024);
+
+    struct state *v1 = state_create_empty(&proj);
+    state_moditify(&proj, v1, 0, MODIFICATION_INSERT, 8, "foo bar\n");
+    state_moditify(&proj, v1, 8, MODIFICATION_INSERT, 8, "bar foo\n");
+    state_moditify(&proj, v1, 4, MODIFICATION_INSERT, 4, "foo ");
+    state_commit(&proj, v1);
+
+    struct state *v2 = state_create_dup(&proj, v1);
+    struct replace_match matches[] = {
+        { 0, 3, 0, 1 },
+        { 4, 3, 1, 3 },
+        { 16, 3, 0, 1 },
+        { 19, 0, 4, 1 },
+    };
+    assert(state_replace_all(&proj, v2, 4, matches, 5, "Xbaz!") == 0);
+    state_commit(&proj, v2);
+
+    char *t1 = get_all_text(v1);
+    char *t2 = get_all_text(v2);
+    printf("get <%s>\n", t2);
+
+    assert(strcmp(t1, "foo foo bar\nbar foo\n") == 0);
+    assert(strcmp(t2, "X baz bar\nbar X!\n") == 0);
+    assert(state_line_number(v2, state_get_size(v2)) == 2);
+
+    /* unsorted matches are rejected */
+    struct state *v3 = state_create_dup(&proj, v1);
+    struct replace_match bad[] = {
+        { 4, 3, 0, 1 },
+        { 0, 3, 0, 1 },
+    };
+    assert(state_replace_all(&proj, v3, 2, bad, 1, "X") != 0);
+
+    free(t1); free(t2);
+    printf("PASSED\n");
+}
+
+void test_bulk_linecol() {
+    printf("Test 6: Bulk line/column conversion... ");
+    struct project proj = {0};
+    proj.lock = (SRWLOCK)SRWLOCK_INIT;
+    proj.current_buffer = allocate_buffer(1 << 16);
+
+    struct state *s = state_create_empty(&proj);
+    srand(7);
+    for (int i = 0; i < 300; i++) {
+        char chunk[16];
+        int len = 1 + rand() % 15;
+        for (int j = 0; j < len; j++) {
+            chunk[j] = rand() % 4 == 0 ? '\n' : 'a' + rand() % 26;
+        }
+        state_moditify(&proj, s, rand() % (state_get_size(s) + 1), MODIFICATION_INSERT, len, chunk);
+    }
+    state_commit(&proj, s);
+    int64_t size = state_get_size(s);
+
+    enum { N = 500 };
+    int64_t offsets[N], linecols[2 * N], back[N];
+    for (int i = 0; i < N; i++) {
+        offsets[i] = rand() % (size + 2) - 1;
+    }
+    state_offsets_to_linecol(s, N, offsets, linecols);
+    for (int i = 0; i < N; i++) {
+        int64_t line, column;
+        state_get_offsets(s, offsets[i], &line, &column);
+        assert(linecols[2 * i] == line && linecols[2 * i + 1] == column);
+    }
+
+    int64_t lines = state_line_number(s, size);
+    for (int i = 0; i < N; i++) {
+        linecols[2 * i] = rand() % (lines + 3) - 1;
+        linecols[2 * i + 1] = rand() % 4;
+    }
+    state_linecol_to_offsets(s, N, linecols, back);
+    for (int i = 0; i < N; i++) {
+        int64_t line = linecols[2 * i], start = 0, expected;
+        if (line > 0) {
+            int64_t newline = state_nth_newline(s, line - 1);
+            start = newline == -1 ? size : newline + 1;
+        }
+        expected = (line < 0 || start >= size) ? 0 : start + linecols[2 * i + 1];
+        assert(back[i] == expected);
+    }
+    printf("PASSED\n");
+}
+
+void test_content_hash() {
+    printf("Test 7: Content hash... ");
+    struct project proj = {0};
+    proj.lock = (SRWLOCK)SRWLOCK_INIT;
+    proj.current_buffer = allocate_buffer(1 << 16);
+
+    static char text[3000];
+    for (int i = 0; i < (int)sizeof(text); i++) {
+        text[i] = 'a' + i % 26;
+    }
+    struct state *a = state_create_empty(&proj);
+    state_moditify(&proj, a, 0, MODIFICATION_INSERT, sizeof(text), text);
+    state_commit(&proj, a);
+
+    /* same text built by other edits */
+    struct state *b = state_create_empty(&proj);
+    state_moditify(&proj, b, 0, MODIFICATION_INSERT, 1000, text + 2000);
+    state_moditify(&proj, b, 0, MODIFICATION_INSERT, 2000, text);
+
+    int64_t ha[2], hb[2], hc[2];
+    state_get_hash(a, ha);
+    state_get_hash(b, hb);
+    assert(ha[0] == hb[0] && ha[1] == hb[1]);
+
+    /* change near end of text, after first 16 bytes of last block */
+    state_moditify(&proj, b, 2990, MODIFICATION_DELETE, 1, NULL);
+    state_moditify(&proj, b, 2990, MODIFICATION_INSERT, 1, "#");
+    state_get_hash(b, hc);
+    assert(ha[0] != hc[0] || ha[1] != hc[1]);
+    printf("PASSED\n");
+}
+
+void test_read_lines() {
+    printf("Test 8: Read visible lines... ");
+    struct project proj = {0};
+    proj.lock = (SRWLOCK)SRWLOCK_INIT;
+    proj.current_buffer = allocate_buffer(1 << 16);
+
+    struct state *s = state_create_empty(&proj);
+    srand(11);
+    for (int i = 0; i < 300; i++) {
+        char chunk[16];
+        int len = 1 + rand() % 15;
+        /* some lines are long, so column skip goes over whole segments */
+        for (int j = 0; j < len; j++) {
+            chunk[j] = rand() % (i % 3 ? 6 : 200) == 0 ? '\n' : 'a' + rand() % 26;
+        }
+        state_moditify(&proj, s, rand() % (state_get_size(s) + 1), MODIFICATION_INSERT, len, chunk);
+    }
+    state_commit(&proj, s);
+    int64_t size = state_get_size(s);
+    int64_t lines = state_line_number(s, size);
+
+    enum { COUNT = 40, COLS = 12 };
+    int64_t offsets[2 * COUNT];
+    char buffer[COUNT * COLS], expected[COLS];
+    for (int k = 0; k < 200; k++) {
+        int64_t first = rand() % (lines + 3), cols = 1 + rand() % COLS, skip = k % 2 ? rand() % 100 : 0;
+        int64_t read = state_read_lines(s, first, COUNT, skip, cols, offsets, buffer, sizeof(buffer));
+        int64_t written = 0, i = 0;
+        /* the same as line by line reads over nth newline */
+        for (; i < COUNT; i++) {
+            int64_t line = first + i, start = 0;
+            if (line > 0) {
+                int64_t newline = state_nth_newline(s, line - 1);
+                start = newline == -1 ? size : newline + 1;
+            }
+            if (start >= size) break;
+            int64_t next = state_nth_newline(s, line);
+            int64_t end = next == -1 ? size : next + 1;
+            /* line shorter than skip gives its end and no bytes */
+            int64_t text = end - start - (next != -1);
+            start += skip <= text ? skip : text;
+            int64_t length = skip <= text ? end - start : 0;
+            if (length > cols) length = cols;
+            assert(i < read && offsets[2 * i] == start && offsets[2 * i + 1] == length);
+            state_read(s, start, length, expected);
+            assert(memcmp(buffer + written, expected, length) == 0);
+            written += length;
+        }
+        assert(read == i);
+    }
+    printf("PASSED\n");
+}
+
+void test_graph_changes() {
+    printf("Test 9: Version graph changes... ");
+    struct project proj = {0};
+    proj.lock = (SRWLOCK)SRWLOCK_INIT;
+    proj.current_buffer = allocate_buffer(1024);
+
+    struct state_change changes[8];
+    struct state *children[8];
+    int64_t count = 8, children_count = 8;
+
+    struct state *root = state_create_empty(&proj);
+    int64_t since = project_get_changes(&proj, 0, &count, changes, &children_count, children);
+    assert(count == 1 && children_count == 0 && changes[0].state == root);
+
+    struct state *a = state_create_dup(&proj, root);
+    struct state *b = state_create_dup(&proj, root);
+
+    /* arrays which are too small give needed sizes and the same change id */
+    count = 1, children_count = 8;
+    assert(project_get_changes(&proj, since, &count, changes, &children_count, children) == since);
+    assert(count == 3 && children_count == 2);
+
+    count = 8, children_count = 8;
+    since = project_get_changes(&proj, since, &count, changes, &children_count, children);
+    assert(count == 3 && children_count == 2);
+    /* states are in order of their latest changes */
+    assert(changes[0].state == a && changes[1].state == root && changes[2].state == b);
+    assert(changes[1].children_count == 2 && children[0] == a && children[1] == b);
+
+    /* nothing changed since last call */
+    count = 8, children_count = 8;
+    assert(project_get_changes(&proj, since, &count, changes, &children_count, children) == since);
+    assert(count == 0 && children_count == 0);
+
+    /* commit without modification merges state into its parent */
+    state_commit(&proj, b);
+    count = 8, children_count = 8;
+    project_get_changes(&proj, since, &count, changes, &children_count, children);
+    assert(count == 2 && children_count == 1);
+    assert(changes[0].state == root && changes[0].children_count == 1 && children[0] == a);
+    assert(changes[1].state == b && changes[1].merged_to == root);
+    printf("PASSED\n");
+}
+
 int main() {
+    msrope_init();
     test_insert_read();
     test_boundary_delete();
     test_persistence();
     test_version_growth();
+    test_replace_all();
+    test_bulk_linecol();
+    test_content_hash();
+    test_read_lines();
+    test_graph_changes();
 
     printf("\n--- ALL TESTS PASSED ---\n");
     return 0;
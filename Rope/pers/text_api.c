@@ -33,6 +33,22 @@ void _reserve_states(struct project *project, int64_t total_size)
 	}
 }
 
+/* exclusive lock of project must be held */
+void _project_log_change(struct project *project, struct state *state)
+{
+	if (project->changes_len == project->changes_alloc)
+	{
+		project->changes_alloc = project->changes_alloc * 2 + 1024;
+		project->changes = realloc(project->changes, sizeof(*project->changes) * project->changes_alloc);
+		if (project->changes == NULL)
+		{
+			exit(1);
+		}
+	}
+	state->last_change = project->changes_len;
+	project->changes[project->changes_len++] = state;
+}
+
 void _reserve_buffers(struct project *project, int64_t total_size)
 {
 	if (project->buffers_alloc < total_size)
@@ -71,6 +87,9 @@ struct project *project_create()
 	project->buffers_len = 0;
 	project->buffers_alloc = 0;
 	project->buffers = NULL;
+	project->changes_len = 0;
+	project->changes_alloc = 0;
+	project->changes = NULL;
 
 	project->current_buffer = allocate_buffer(1024 * 1024);
 	_project_add_buffer(project, project->current_buffer);
@@ -100,6 +119,7 @@ void project_destroy(struct project *project)
 		delete_buffer(project->buffers[i]);
 	}
 	free(project->states);
+	free(project->changes);
 	free(project);
 }
 
@@ -169,6 +189,47 @@ void project_get_states(struct project *project, int64_t states_count, struct st
 	freeShared(&project->lock);
 }
 
+int64_t project_get_changes(struct project *project, int64_t since, int64_t *count, struct state_change *changes, int64_t *children_count, struct state **children)
+{
+	lockShared(&project->lock);
+	since = since < 0 ? 0 : since > project->changes_len ? project->changes_len : since;
+	int64_t capacity = *count, children_capacity = *children_count, len = 0, children_len = 0;
+	for (int64_t i = since; i < project->changes_len; ++i)
+	{
+		struct state *st = project->changes[i];
+		/* state changed several times is written at its latest entry only */
+		if (st->last_change != i)
+		{
+			continue;
+		}
+		int64_t first_child = children_len;
+		for (int64_t j = 0; !st->merged_to && j < st->next_versions_len; ++j)
+		{
+			/* child which was committed without modification is resolved to state itself */
+			struct state *child = state_resolve(st->next_versions[j]);
+			if (child == st)
+			{
+				continue;
+			}
+			if (children_len < children_capacity)
+			{
+				children[children_len] = child;
+			}
+			children_len++;
+		}
+		if (len < capacity)
+		{
+			changes[len] = (struct state_change){ st, st->merged_to ? state_resolve(st) : NULL, children_len - first_child };
+		}
+		len++;
+	}
+	int64_t result = (len <= capacity && children_len <= children_capacity) ? project->changes_len : since;
+	freeShared(&project->lock);
+	*count = len;
+	*children_count = children_len;
+	return result;
+}
+
 struct state *state_resolve(struct state *state)
 {
 	while (state->merged_to) state = state->merged_to;
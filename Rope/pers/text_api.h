@@ -61,10 +61,23 @@ ROPE_EXPORT void state_moditify(struct project *project, struct state *state, in
 
 ROPE_EXPORT void state_commit(struct project *project, struct state *state);
 
+struct replace_match
+{
+	int64_t position;
+	int64_t length;
+	int64_t replacement_offset; // offset of replacement in replacements buffer
+	int64_t replacement_length;
+};
+/* matches must be sorted and must not overlap, returns 0 on success */
+ROPE_EXPORT int state_replace_all(struct project *project, struct state *state, int64_t count, struct replace_match *matches, int64_t replacements_length, char *replacements);
+
 /* reading */
 
 ROPE_EXPORT int64_t state_get_size(struct state *state);
 
+/* 128 bit hash of state text, same text gives same hash */
+ROPE_EXPORT void state_get_hash(struct state *state, int64_t *hash);
+
 ROPE_EXPORT void state_read(struct state *state, int64_t position, int64_t length, char *buffer);
 
 /* versioning */
@@ -80,6 +93,21 @@ struct link
 };
 ROPE_EXPORT void project_get_states(struct project *project, int64_t states_count, struct state **result, int64_t links_count, struct link *links);
 
+/*
+    changes of version graph since change id: every creation, commit, merge and link change of state is logged
+    in project. each state changed after since is written once into changes with state it is merged into
+    or with count of its children, resolved children of all of them go one after another into children.
+    count and children_count give sizes of arrays and get sizes which are needed. returns change id for the
+    next call, if arrays are too small it returns since and call has to be repeated with bigger ones
+*/
+struct state_change
+{
+	struct state *state;
+	struct state *merged_to;
+	int64_t children_count;
+};
+ROPE_EXPORT int64_t project_get_changes(struct project *project, int64_t since, int64_t *count, struct state_change *changes, int64_t *children_count, struct state **children);
+
 ROPE_EXPORT struct state *state_resolve(struct state *state);
 
 ROPE_EXPORT void state_set_cursors(struct state *state, int64_t count, struct cursor *cursors);
@@ -100,6 +128,23 @@ ROPE_EXPORT int64_t state_line_number(struct state *state, int64_t position);
 
 ROPE_EXPORT int64_t state_nth_newline(struct state *state, int64_t n);
 
+/*
+    bulk conversions, queries are sorted and answered in one in-order sweep of tree.
+    linecols are pairs line, column (2 * count values), results are the same as of single conversions
+*/
+ROPE_EXPORT void state_linecol_to_offsets(struct state *state, int64_t count, const int64_t *linecols, int64_t *offsets);
+
+ROPE_EXPORT void state_offsets_to_linecol(struct state *state, int64_t count, const int64_t *offsets, int64_t *linecols);
+
+/*
+    visible lines for one frame: up to count lines from first_line are copied one after another into buffer,
+    at most max_cols bytes of each (newline included) from byte first_col of line, columns before it are
+    skipped by descent. offsets gets pairs offset of first copied byte in text, bytes of line in buffer, line
+    shorter than first_col gives its end. first_col may split utf8 sequence, caller fixes boundaries.
+    lines end at end of text or when buffer is full, returns count of lines read
+*/
+ROPE_EXPORT int64_t state_read_lines(struct state *state, int64_t first_line, int64_t count, int64_t first_col, int64_t max_cols, int64_t *offsets, char *buffer, int64_t buffer_size);
+
 
 #ifdef __cplusplus
 }
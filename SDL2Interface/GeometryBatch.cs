@@ -0,0 +1,150 @@
+﻿using SDL_Sharp;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace SDL2Interface
+{
+    /*
+        collects filled rects and texture copies of frame into vertex and index arrays, one array pair per
+        texture, and submits each of them by one SDL_RenderGeometry. rects are drawn before copies, so rect
+        added after pending copies flushes them first. anything drawn by SDL directly (clip change, lines,
+        present) has to flush batch before it
+    */
+    internal sealed class GeometryBatch(Renderer renderer)
+    {
+        /* SDL_Vertex */
+        [StructLayout(LayoutKind.Sequential)]
+        private struct Vertex
+        {
+            public float X, Y;
+            public byte R, G, B, A;
+            public float U, V;
+        }
+
+        private sealed class Batch
+        {
+            public IntPtr Texture;
+            public Vertex[] Vertices = new Vertex[1024];
+            public int[] Indices = new int[1536];
+            public int VertexCount = 0;
+            public int IndexCount = 0;
+        }
+
+        [DllImport("SDL2", EntryPoint = "SDL_RenderGeometry")]
+        private static extern unsafe int RenderGeometry(IntPtr renderer, IntPtr texture, Vertex* vertices, int numVertices, int* indices, int numIndices);
+
+        private readonly Batch solid = new();
+        private readonly Dictionary<IntPtr, Batch> textured = [];
+        /* textures in order of first copy in this flush */
+        private readonly List<Batch> order = [];
+        private readonly Stack<Batch> free = [];
+
+        public byte R { get; private set; }
+        public byte G { get; private set; }
+        public byte B { get; private set; }
+        public byte A { get; private set; }
+
+        /* color of next filled rects, SDL draw color is set only when it is needed for direct draw */
+        public void SetDrawColor(byte r, byte g, byte b, byte a)
+        {
+            (R, G, B, A) = (r, g, b, a);
+        }
+
+        public void FillRect(Rect rect)
+        {
+            if (order.Count > 0)
+            {
+                Flush();
+            }
+            AddQuad(solid, rect, R, G, B, A, 0, 0, 0, 0);
+        }
+
+        /* outline of rect, as SDL_RenderDrawRect */
+        public void DrawRect(Rect rect)
+        {
+            FillRect(new(rect.X, rect.Y, rect.Width, 1));
+            FillRect(new(rect.X, rect.Y + rect.Height - 1, rect.Width, 1));
+            FillRect(new(rect.X, rect.Y, 1, rect.Height));
+            FillRect(new(rect.X + rect.Width - 1, rect.Y, 1, rect.Height));
+        }
+
+        /* lines aren't batched, they are rare */
+        public void DrawLine(int x1, int y1, int x2, int y2)
+        {
+            Flush();
+            SDL.SetRenderDrawColor(renderer, R, G, B, A);
+            SDL.RenderDrawLine(renderer, x1, y1, x2, y2);
+        }
+
+        /* texture is multiplied by color, like by texture color mod */
+        public void Copy(Texture texture, int textureWidth, int textureHeight, Rect source, Rect dest, Color color)
+        {
+            IntPtr handle = Handle(texture);
+            if (!textured.TryGetValue(handle, out var batch))
+            {
+                batch = free.Count > 0 ? free.Pop() : new Batch();
+                batch.Texture = handle;
+                textured[handle] = batch;
+                order.Add(batch);
+            }
+            AddQuad(batch, dest, color.R, color.G, color.B, color.A,
+                (float)source.X / textureWidth, (float)source.Y / textureHeight,
+                (float)(source.X + source.Width) / textureWidth, (float)(source.Y + source.Height) / textureHeight);
+        }
+
+        public void Flush()
+        {
+            Submit(solid);
+            foreach (var batch in order)
+            {
+                Submit(batch);
+                free.Push(batch);
+            }
+            order.Clear();
+            textured.Clear();
+        }
+
+        private static void AddQuad(Batch batch, Rect rect, byte r, byte g, byte b, byte a, float u0, float v0, float u1, float v1)
+        {
+            if (batch.VertexCount + 4 > batch.Vertices.Length)
+            {
+                Array.Resize(ref batch.Vertices, batch.Vertices.Length * 2);
+                Array.Resize(ref batch.Indices, batch.Indices.Length * 2);
+            }
+            int first = batch.VertexCount;
+            float x0 = rect.X, y0 = rect.Y, x1 = rect.X + rect.Width, y1 = rect.Y + rect.Height;
+            batch.Vertices[first] = new Vertex { X = x0, Y = y0, R = r, G = g, B = b, A = a, U = u0, V = v0 };
+            batch.Vertices[first + 1] = new Vertex { X = x1, Y = y0, R = r, G = g, B = b, A = a, U = u1, V = v0 };
+            batch.Vertices[first + 2] = new Vertex { X = x1, Y = y1, R = r, G = g, B = b, A = a, U = u1, V = v1 };
+            batch.Vertices[first + 3] = new Vertex { X = x0, Y = y1, R = r, G = g, B = b, A = a, U = u0, V = v1 };
+            batch.VertexCount += 4;
+
+            int i = batch.IndexCount;
+            batch.Indices[i] = first;
+            batch.Indices[i + 1] = first + 1;
+            batch.Indices[i + 2] = first + 2;
+            batch.Indices[i + 3] = first;
+            batch.Indices[i + 4] = first + 2;
+            batch.Indices[i + 5] = first + 3;
+            batch.IndexCount += 6;
+        }
+
+        private unsafe void Submit(Batch batch)
+        {
+            if (batch.IndexCount == 0) return;
+            fixed (Vertex* vertices = batch.Vertices)
+            fixed (int* indices = batch.Indices)
+            {
+                RenderGeometry(Handle(renderer), batch.Texture, vertices, batch.VertexCount, indices, batch.IndexCount);
+            }
+            batch.VertexCount = 0;
+            batch.IndexCount = 0;
+        }
+
+        /* SDL_Sharp handles are structs which only wrap native pointer */
+        private static IntPtr Handle<T>(T handle) where T : struct
+        {
+            return Unsafe.As<T, IntPtr>(ref handle);
+        }
+    }
+}
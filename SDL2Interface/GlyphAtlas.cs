@@ -0,0 +1,233 @@
+﻿using Common;
+using SDL_Sharp;
+using SDL_Sharp.Ttf;
+using System.Collections.Concurrent;
+
+namespace SDL2Interface
+{
+    /* glyphs are rasterized at size of loaded font and scaled when copied, so scale isn't part of key */
+    internal readonly record struct GlyphKey(string Grapheme, int Font);
+
+    /*
+        glyphs which are not in ascii map. glyph is rasterized by worker thread on first use, render thread
+        packs it into shelves of atlas page at start of next frame and draws it from page texture. when all
+        pages are full, page of least recently used glyph is cleared and its glyphs are rasterized again
+        when they are drawn next time
+    */
+    internal sealed class GlyphAtlas : IDisposable
+    {
+        public const int PageSize = 1024;
+        public const int MaxPages = 4;
+
+        private sealed class Shelf(int y, int height)
+        {
+            public readonly int Y = y;
+            public readonly int Height = height;
+            public int X = 0;
+        }
+
+        private sealed class Page
+        {
+            public PSurface Surface;
+            public Texture Texture;
+            public bool Dirty = false;
+            public int Top = 0;
+            public readonly List<Shelf> Shelves = [];
+            public readonly List<GlyphKey> Glyphs = [];
+        }
+
+        private sealed class Glyph(Page page, Rect source, LinkedListNode<GlyphKey> used)
+        {
+            public readonly Page Page = page;
+            public readonly Rect Source = source;
+            public readonly LinkedListNode<GlyphKey> Used = used;
+        }
+
+        private readonly Renderer renderer;
+        private readonly Font[] fonts;
+        private readonly List<Page> pages = [];
+        private readonly Dictionary<GlyphKey, Glyph> glyphs = [];
+        /* least recently drawn glyph is at the end */
+        private readonly LinkedList<GlyphKey> used = [];
+        /* requested and not packed yet, or can't be rasterized */
+        private readonly HashSet<GlyphKey> pending = [];
+        private readonly BlockingCollection<GlyphKey> requests = [];
+        private readonly ConcurrentQueue<(GlyphKey key, PSurface surface, int w, int h)> rasterized = [];
+        private readonly Task worker;
+
+        public GlyphAtlas(Renderer renderer, Font[] fonts)
+        {
+            this.renderer = renderer;
+            this.fonts = fonts;
+            worker = Task.Factory.StartNew(Rasterize, TaskCreationOptions.LongRunning);
+        }
+
+        /* texture and part of it with glyph, false until glyph is rasterized and packed */
+        public bool TryGet(GlyphKey key, out Texture texture, out Rect source)
+        {
+            if (glyphs.TryGetValue(key, out var glyph))
+            {
+                used.Remove(glyph.Used);
+                used.AddFirst(glyph.Used);
+                texture = glyph.Page.Texture;
+                source = glyph.Source;
+                return true;
+            }
+            if (pending.Add(key))
+            {
+                requests.Add(key);
+            }
+            texture = default;
+            source = default;
+            return false;
+        }
+
+        /*
+            packs glyphs rasterized since last frame and uploads changed pages, called before frame is drawn.
+            returns true when new glyphs can be drawn
+        */
+        public bool BeginFrame()
+        {
+            bool packed = false;
+            while (rasterized.TryDequeue(out var item))
+            {
+                if (item.surface.IsNull || item.w <= 0 || item.h <= 0 || item.w > PageSize || item.h > PageSize)
+                {
+                    /* stays pending, so it isn't requested again */
+                    Logger.Log(LogLevel.Warning, $"Glyph '{item.key.Grapheme}' can't be rasterized");
+                    if (!item.surface.IsNull)
+                    {
+                        SDL.FreeSurface(item.surface);
+                    }
+                    continue;
+                }
+                Pack(item.key, item.surface, item.w, item.h);
+                SDL.FreeSurface(item.surface);
+                pending.Remove(item.key);
+                packed = true;
+            }
+
+            foreach (var page in pages.Where(x => x.Dirty))
+            {
+                if (!page.Texture.IsNull)
+                {
+                    SDL.DestroyTexture(page.Texture);
+                }
+                page.Texture = SDL.CreateTextureFromSurface(renderer, page.Surface);
+                page.Dirty = false;
+            }
+            return packed;
+        }
+
+        private void Pack(GlyphKey key, PSurface surface, int w, int h)
+        {
+            (Page page, Rect dest)? place = null;
+            foreach (var candidate in pages)
+            {
+                if ((place = Allocate(candidate, w, h)) != null) break;
+            }
+            if (place == null && pages.Count < MaxPages)
+            {
+                pages.Add(CreatePage());
+                place = Allocate(pages[^1], w, h);
+            }
+            if (place == null)
+            {
+                Page evicted = glyphs[used.Last!.Value].Page;
+                Clear(evicted);
+                place = Allocate(evicted, w, h);
+            }
+
+            var (target, rect) = place!.Value;
+            Rect src = new(0, 0, w, h);
+            Rect dest = rect;
+            SDL.BlitSurface(surface, ref src, target.Surface, ref dest);
+            target.Glyphs.Add(key);
+            target.Dirty = true;
+            glyphs[key] = new Glyph(target, rect, used.AddFirst(key));
+        }
+
+        /* first shelf which fits glyph and isn't much higher than it, or new shelf */
+        private static (Page, Rect)? Allocate(Page page, int w, int h)
+        {
+            foreach (var shelf in page.Shelves)
+            {
+                if (shelf.Height >= h && shelf.Height <= h + h / 4 && shelf.X + w <= PageSize)
+                {
+                    Rect rect = new(shelf.X, shelf.Y, w, h);
+                    shelf.X += w;
+                    return (page, rect);
+                }
+            }
+            if (page.Top + h <= PageSize)
+            {
+                Shelf shelf = new(page.Top, h) { X = w };
+                page.Shelves.Add(shelf);
+                page.Top += h;
+                return (page, new Rect(0, shelf.Y, w, h));
+            }
+            return null;
+        }
+
+        private static Page CreatePage()
+        {
+            SDL.CreateRGBSurface(0, PageSize, PageSize, 32, 0xff, 0xff00, 0xff0000, 0xff000000, out PSurface surface);
+            if (surface.IsNull)
+            {
+                throw new Exception($"Glyph atlas page is not created: {SDL.GetError()}");
+            }
+            return new Page { Surface = surface };
+        }
+
+        private void Clear(Page page)
+        {
+            foreach (var key in page.Glyphs)
+            {
+                used.Remove(glyphs[key].Used);
+                glyphs.Remove(key);
+            }
+            page.Glyphs.Clear();
+            page.Shelves.Clear();
+            page.Top = 0;
+            SDL.FreeSurface(page.Surface);
+            page.Surface = CreatePage().Surface;
+            page.Dirty = true;
+        }
+
+        /* worker thread is the only user of fonts after they are loaded */
+        private void Rasterize()
+        {
+            foreach (var key in requests.GetConsumingEnumerable())
+            {
+                Font font = fonts[key.Font];
+                TTF.SizeUTF8(font, key.Grapheme, out int w, out int h);
+                TTF.RenderUTF8_Blended(font, key.Grapheme, new Color(255, 255, 255, 255), out PSurface surface);
+                rasterized.Enqueue((key, surface, w, h));
+            }
+        }
+
+        public void Dispose()
+        {
+            requests.CompleteAdding();
+            worker.Wait();
+            while (rasterized.TryDequeue(out var item))
+            {
+                if (!item.surface.IsNull)
+                {
+                    SDL.FreeSurface(item.surface);
+                }
+            }
+            foreach (var page in pages)
+            {
+                if (!page.Texture.IsNull)
+                {
+                    SDL.DestroyTexture(page.Texture);
+                }
+                SDL.FreeSurface(page.Surface);
+            }
+            pages.Clear();
+            glyphs.Clear();
+            used.Clear();
+        }
+    }
+}
@@ -70,6 +70,9 @@ namespace SDL2Interface
             windows.Add(window);
         }
 
+        [DllImport("SDL2", EntryPoint = "SDL_WaitEventTimeout")]
+        static extern int WaitEventTimeout(IntPtr sdlEvent, int timeout);
+
         [DllImport("user32.dll")]
         static extern int GetWindowLong(IntPtr hWnd, int nIndex);
 
@@ -262,16 +265,47 @@ namespace SDL2Interface
                     }
                     return true;
                 });
-                while (windows.Count > 0)
+                /*
+                    frame is drawn only when state of some window or size of screen changed since last drawn frame,
+                    back buffer isn't kept after present, so whole frame is drawn then. idle loop waits for events
+                */
+                bool FrameState(out int state)
                 {
+                    HashCode hash = new();
+                    hash.Add(Render.W);
+                    hash.Add(Render.H);
+                    hash.Add(render.textRenderer.Ready);
+                    bool animating = false;
                     foreach (var win in windows)
                     {
-                        render.Draw(win);
+                        animating |= win.DrawState(ref hash);
+                    }
+                    state = hash.ToHashCode();
+                    return animating;
+                }
+
+                int drawnState = 0;
+                bool eventsProcessed = true;
+                while (windows.Count > 0)
+                {
+                    bool glyphsChanged = render.textRenderer.BeginFrame();
+                    bool animating = FrameState(out int state);
+                    bool drawn = glyphsChanged || animating || eventsProcessed || state != drawnState;
+                    if (drawn)
+                    {
+                        foreach (var win in windows)
+                        {
+                            render.Draw(win);
+                        }
+                        render.Present();
+                        /* drawing could change state, e.g. scroll to cursor */
+                        FrameState(out drawnState);
                     }
-                    SDL.RenderPresent(render.renderer);
-                    Thread.Sleep(10);
+                    eventsProcessed = false;
+                    WaitEventTimeout(IntPtr.Zero, drawn ? 10 : 100);
                     while (SDL.PollEvent(out Event evt) != 0)
                     {
+                        eventsProcessed = true;
                         if (evt.Type == EventType.WindowEvent)
                         {
                             W = evt.Window.Data1;
@@ -305,6 +339,7 @@ namespace SDL2Interface
                 }
             }
 
+            render.textRenderer.Dispose();
             SDL.DestroyRenderer(render.renderer);
             SDL.DestroyWindow(render.SDLWindow);
             SDL.Quit();
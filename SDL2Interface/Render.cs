@@ -7,6 +7,7 @@ using Json.More;
 using Markdig.Helpers;
 using Microsoft.CodeAnalysis.Operations;
 using OmniSharp.Extensions.LanguageServer.Protocol.Models;
+using RegexTokenizer;
 using SDL_Sharp;
 using SDL_Sharp.Utility;
 using System;
@@ -188,7 +189,9 @@ namespace SDL2Interface
         static double Scale;
         internal TextBufferRenderer textRenderer;
         public Renderer renderer;
+        private readonly VisibleLines visibleLines = new();
         public Window SDLWindow;
+        private GeometryBatch Batch => textRenderer.Batch;
 
         public Render(TextBufferRenderer textRenderer, Renderer renderer, Window sDLWindow)
         {
@@ -249,6 +252,7 @@ namespace SDL2Interface
                 SDL_Sharp.Rect position = new((int)window.Layout.Position.X, (int)window.Layout.Position.Y, (int)window.Layout.Position.W, (int)window.Layout.Position.H);
                 unsafe
                 {
+                    Batch.Flush();
                     SDL.RenderSetClipRect(renderer, ref position);
                 }
 
@@ -259,21 +263,20 @@ namespace SDL2Interface
                 {
                     case AlertWindow alertWindow:
                         {
-                            SDL.SetRenderDrawColor(renderer, 0, 0, 0, 0);
-                            SDL.RenderFillRect(renderer, ref position);
+                            Batch.SetDrawColor(0, 0, 0, 0);
+                            Batch.FillRect(position);
 
-                            long dummyValue = 0;
-                            textRenderer.DrawTextLine(position.X, position.Y, alertWindow.Text, 0, [], ref dummyValue);
+                            textRenderer.DrawTextLine(position.X, position.Y, alertWindow.Text, 0, new(255, 255, 255, 255));
                             int y = position.Y + textRenderer.FontLineStep;
                             foreach (var (i, (text, _)) in alertWindow.Buttons.Index())
                             {
                                 if (alertWindow.Selected == i)
                                 {
-                                    SDL.SetRenderDrawColor(renderer, 0, 50, 80, 255);
+                                    Batch.SetDrawColor(0, 50, 80, 255);
                                     SDL_Sharp.Rect rect = new((int)(position.X + 40 * Scale), y, (int)(position.Width - 80 * Scale), textRenderer.FontLineStep);
-                                    SDL.RenderFillRect(renderer, ref rect);
+                                    Batch.FillRect(rect);
                                 }
-                                textRenderer.DrawTextLine((int)(position.X + 50 * Scale), y, text, 0, [], ref dummyValue);
+                                textRenderer.DrawTextLine((int)(position.X + 50 * Scale), y, text, 0, new(255, 255, 255, 255));
                                 y += textRenderer.FontLineStep;
                             }
                         }
@@ -284,24 +287,25 @@ namespace SDL2Interface
                             int tabHeight = (int)(25 * Scale);
 
                             SDL_Sharp.Rect header = new(position.X, position.Y, position.Width, tabHeight);
-                            SDL.SetRenderDrawColor(renderer, 0, 25, 40, 255);
-                            SDL.RenderFillRect(renderer, ref header);
+                            Batch.SetDrawColor(0, 25, 40, 255);
+                            Batch.FillRect(header);
                             SDL_Sharp.Rect tab = new(position.X + 2, position.Y + 2, tabWidth - 4, tabHeight - 4);
                             SDL.RenderGetClipRect(renderer, out SDL_Sharp.Rect clip);
                             lock (tabsWindow.childsLock)
                             {
                                 foreach (var (id, child) in tabsWindow.childs.Index())
                                 {
+                                    Batch.Flush();
                                     SDL.RenderSetClipRect(renderer, ref tab);
                                     if (tabsWindow.current == id)
                                     {
-                                        SDL.SetRenderDrawColor(renderer, 0, 50, 80, 255);
-                                        SDL.RenderFillRect(renderer, ref tab);
+                                        Batch.SetDrawColor(0, 50, 80, 255);
+                                        Batch.FillRect(tab);
                                     }
-                                    long dummyValue = 0;
-                                    textRenderer.DrawTextLine(tab.X, tab.Y, child.file.filename ?? "<Unnamed>", 0, [], ref dummyValue);
+                                    textRenderer.DrawTextLine(tab.X, tab.Y, child.file.filename ?? "<Unnamed>", 0, new(255, 255, 255, 255));
                                     tab.X += tab.Width + 4;
                                 }
+                                Batch.Flush();
                                 SDL.RenderSetClipRect(renderer, ref clip);
                                 if (tabsWindow.current < tabsWindow.childs.Count)
                                 {
@@ -327,6 +331,7 @@ namespace SDL2Interface
                             SDL_Sharp.Rect findClipPos = new((int)f.find.Layout.Position.Ax, (int)f.find.Layout.Position.By, (int)f.find.Layout.Position.Bx, (int)f.find.Layout.Position.By + textRenderer.FontLineStep);
                             unsafe
                             {
+                                Batch.Flush();
                                 SDL.RenderSetClipRect(renderer, ref findClipPos);
                             }
                             if (f.find.resultBuffer != f.find.usingCursor.Buffer) // if found in another file
@@ -340,8 +345,8 @@ namespace SDL2Interface
                             }
                             else
                             {
-                                SDL.SetRenderDrawColor(renderer, 0, 0, 0, 0);
-                                SDL.RenderFillRect(renderer, ref findClipPos);
+                                Batch.SetDrawColor(0, 0, 0, 0);
+                                Batch.FillRect(findClipPos);
                             }
                             DrawRecurse(f.preview);
                         }
@@ -375,6 +380,7 @@ namespace SDL2Interface
             // after
             unsafe
             {
+                Batch.Flush();
                 SDL.RenderSetClipRect(renderer, null);
             }
         }
@@ -390,8 +396,8 @@ namespace SDL2Interface
             if (win.GameResult == SimpleGameWindow.GameResultType.HelpScreen)
             {
                 SDL_Sharp.Rect line = Convert(lay.Position);
-                SDL.SetRenderDrawColor(renderer, 0, 0, 0, 255);
-                SDL.RenderFillRect(renderer, ref line);
+                Batch.SetDrawColor(0, 0, 0, 255);
+                Batch.FillRect(line);
 
                 textRenderer.Scale(2.0);
                 int ypos = line.Y + 10;
@@ -522,19 +528,19 @@ namespace SDL2Interface
                     if (canMoveHere)
                     {
                         int frameWidth = (int)Math.Max(1, cellSize * 0.08);
-                        SDL.SetRenderDrawColor(renderer, cellColor.R, cellColor.G, cellColor.B, cellColor.A);
-                        SDL.RenderFillRect(renderer, ref cellPosition);
+                        Batch.SetDrawColor(cellColor.R, cellColor.G, cellColor.B, cellColor.A);
+                        Batch.FillRect(cellPosition);
                         cellPosition.X += frameWidth; cellPosition.Y += frameWidth; cellPosition.Width -= 2 * frameWidth; cellPosition.Height -= 2 * frameWidth;
-                        SDL.SetRenderDrawColor(renderer, 40, 120, 40, 255);
-                        SDL.RenderFillRect(renderer, ref cellPosition);
+                        Batch.SetDrawColor(40, 120, 40, 255);
+                        Batch.FillRect(cellPosition);
                         cellPosition.X += frameWidth; cellPosition.Y += frameWidth; cellPosition.Width -= 2 * frameWidth; cellPosition.Height -= 2 * frameWidth;
-                        SDL.SetRenderDrawColor(renderer, cellColor.R, cellColor.G, cellColor.B, cellColor.A);
-                        SDL.RenderFillRect(renderer, ref cellPosition);
+                        Batch.SetDrawColor(cellColor.R, cellColor.G, cellColor.B, cellColor.A);
+                        Batch.FillRect(cellPosition);
                     }
                     else
                     {
-                        SDL.SetRenderDrawColor(renderer, cellColor.R, cellColor.G, cellColor.B, cellColor.A);
-                        SDL.RenderFillRect(renderer, ref cellPosition);
+                        Batch.SetDrawColor(cellColor.R, cellColor.G, cellColor.B, cellColor.A);
+                        Batch.FillRect(cellPosition);
                     }
                 }
             }
@@ -550,13 +556,13 @@ namespace SDL2Interface
                 cellPosition.X += frameWidth; cellPosition.Y += frameWidth; cellPosition.Width -= 2 * frameWidth; cellPosition.Height -= 2 * frameWidth;
                 if (cell == false)
                 {
-                    SDL.SetRenderDrawColor(renderer, 0, 255, 0, 255);
+                    Batch.SetDrawColor(0, 255, 0, 255);
                 }
                 else
                 {
-                    SDL.SetRenderDrawColor(renderer, 255, 0, 255, 255);
+                    Batch.SetDrawColor(255, 0, 255, 255);
                 }
-                SDL.RenderFillRect(renderer, ref cellPosition);
+                Batch.FillRect(cellPosition);
             }
 
             // if loose/win: render line and print score
@@ -566,8 +572,8 @@ namespace SDL2Interface
                 line.Y += line.Height * 5 / 6;
                 line.Height /= 7;
 
-                SDL.SetRenderDrawColor(renderer, 0, 255, 0, 255);
-                SDL.RenderFillRect(renderer, ref line);
+                Batch.SetDrawColor(0, 255, 0, 255);
+                Batch.FillRect(line);
 
                 textRenderer.Scale(2.0);
                 string message = $"Win! Score: {win.Score}";
@@ -580,8 +586,8 @@ namespace SDL2Interface
                 line.Y += line.Height * 5 / 6;
                 line.Height /= 7;
 
-                SDL.SetRenderDrawColor(renderer, 255, 110, 0, 255);
-                SDL.RenderFillRect(renderer, ref line);
+                Batch.SetDrawColor(255, 110, 0, 255);
+                Batch.FillRect(line);
 
                 textRenderer.Scale(2.0);
                 string message = $"Game Over. Score: {win.Score}";
@@ -606,8 +612,8 @@ namespace SDL2Interface
                     line.Width = textRenderer.FontStep * (message.Length + 2);
                 }
 
-                SDL.SetRenderDrawColor(renderer, 40, 40, 40, 255);
-                SDL.RenderFillRect(renderer, ref line);
+                Batch.SetDrawColor(40, 40, 40, 255);
+                Batch.FillRect(line);
                 textRenderer.DrawTextLine((int)(line.X + line.Width * 0.5 - textRenderer.FontStep * message.Length * 0.5), (int)(line.Y + line.Height / 2 - textRenderer.FontLineStep * 0.5), message, 0, new(255, 255, 255, 255));
                 textRenderer.Scale(0.5);
 
@@ -616,8 +622,8 @@ namespace SDL2Interface
                     line.Y += line.Height;
 
                     textRenderer.Scale(2.0);
-                    SDL.SetRenderDrawColor(renderer, 40, 40, 40, 255);
-                    SDL.RenderFillRect(renderer, ref line);
+                    Batch.SetDrawColor(40, 40, 40, 255);
+                    Batch.FillRect(line);
                     textRenderer.DrawTextLine((int)(line.X + line.Width * 0.5 - textRenderer.FontStep * message2.Length * 0.5), (int)(line.Y + line.Height / 2 - textRenderer.FontLineStep * 0.5), message2, 0, new(255, 255, 255, 255));
                     textRenderer.Scale(0.5);
                 }
@@ -633,79 +639,98 @@ namespace SDL2Interface
                 {
                     return;
                 }
+                if (window.wrapLines)
+                {
+                    window.wrapWidth = WrapWidth(window);
+                    window.leftViewOffset = 0;
+                    window.buffer.GetWrapIndex(window.wrapWidth);
+                }
                 /* align offset to see cursor */
                 if (window.cursor.Selections.Count > 0)
                 {
                     var (cursorLine, cursorOffset) = window.cursor.Buffer.GetPositionOffsets(window.cursor.Selections[0].End);
-                    if (cursorLine < window.viewOffset + 3)
-                    {
-                        window.viewOffset = cursorLine - 3;
-                    }
-                    if (cursorLine > window.viewOffset + window.Layout.Position.H / textRenderer.FontLineStep - 4)
+                    if (window.wrapLines)
                     {
-                        window.viewOffset = cursorLine - window.Layout.Position.H / textRenderer.FontLineStep + 4;
+                        AlignWrapped(window, cursorLine, cursorOffset);
                     }
-                    if (cursorOffset < window.leftViewOffset + 6)
-                    {
-                        window.leftViewOffset = cursorOffset - 6;
-                    }
-                    if (cursorOffset > window.leftViewOffset + window.Layout.Position.W / textRenderer.FontStep - 7)
+                    else
                     {
-                        window.leftViewOffset = cursorOffset - window.Layout.Position.W / textRenderer.FontStep + 7;
+                        if (cursorLine < window.viewOffset + 3)
+                        {
+                            window.viewOffset = cursorLine - 3;
+                        }
+                        if (cursorLine > window.viewOffset + window.Layout.Position.H / textRenderer.FontLineStep - 4)
+                        {
+                            window.viewOffset = cursorLine - window.Layout.Position.H / textRenderer.FontLineStep + 4;
+                        }
+                        if (cursorOffset < window.leftViewOffset + 6)
+                        {
+                            window.leftViewOffset = cursorOffset - 6;
+                        }
+                        if (cursorOffset > window.leftViewOffset + window.Layout.Position.W / textRenderer.FontStep - 7)
+                        {
+                            window.leftViewOffset = cursorOffset - window.Layout.Position.W / textRenderer.FontStep + 7;
+                        }
                     }
                 }
+                if (window.wrapLines)
+                {
+                    /* rows of visible lines are counted before they are drawn */
+                    window.buffer.MeasureWrappedLines(window.viewOffset, window.viewOffset + window.Layout.Position.H / textRenderer.FontLineStep);
+                }
             }
 
 
 
             if (!textRenderer.Ready) return;
 
-            SDL.SetRenderDrawColor(renderer, 0, 0, 0, 0);
-            SDL.RenderFillRect(renderer, ref Position);
+            Batch.SetDrawColor(0, 0, 0, 0);
+            Batch.FillRect(Position);
 
 
             int leftBarSize = 0;
             int leftOffset = (int)window.leftViewOffset * textRenderer.FontStep;
 
             long minLine = window.viewOffset;
-            long maxLine = minLine + (window.Layout.Position.H / textRenderer.FontLineStep) + 1;
+            long maxLine = LastVisibleLine(window);
             long minPos = window.buffer.GetLineOffsets(minLine).begin;
             long maxPos = window.buffer.GetLineOffsets(maxLine).begin;
             maxPos = (maxPos == 0 ? window.buffer.Text.Length + 1 : maxPos + ((window.Layout.Position.W + leftOffset) / textRenderer.FontStep) + 1);
 
             if (window.showNumbers)
             {
-                if (window.relativeNumbers && window.cursor?.Selections.Count == 1)
+                if (window.wrapLines && window.wrapWidth > 0)
+                {
+                    long? cursorLine = window.relativeNumbers && window.cursor?.Selections.Count == 1 ? window.cursor.Selections[0].EndLine : null;
+                    SimpleTextWindowDrawWrappedNumbers(window, cursorLine, ref leftBarSize);
+                }
+                else if (window.relativeNumbers && window.cursor?.Selections.Count == 1)
                 {
                     long cursorLine = window.cursor.Selections[0].EndLine;
                     int maxPower = 4;
-                    long dummyValue = 0;
                     /* draw numbers */
-                    for (int t = 0; t < window.Layout.Position.H / textRenderer.FontLineStep; ++t)
+                    int rows = visibleLines.Read(window.buffer, window.viewOffset, (int)(window.Layout.Position.H / textRenderer.FontLineStep), 1);
+                    for (int t = visibleLines.FirstRow; t < rows; ++t)
                     {
                         int i = t + (int)window.viewOffset;
-                        (long index, string? s, _) = window.buffer.GetLine(i, 1);
-                        if (s != null)
+                        long num = i;
+                        if (num < cursorLine)
                         {
-                            long num = i;
-                            if (num < cursorLine)
-                            {
-                                num = 100 - (cursorLine - num);
-                            }
-                            else
-                            {
-                                num = num - cursorLine;
-                            }
-                            if (num == 0)
-                            {
-                                SDL_Sharp.Rect rect = new(Position.X + 5, Position.Y + t * textRenderer.FontLineStep, Position.Width - 10, textRenderer.FontLineStep);
-                                SDL.SetRenderDrawColor(renderer, 0, 20, 20, 255);
-                                SDL.RenderFillRect(renderer, ref rect);
-                            }
-                            else
-                            {
-                                textRenderer.DrawTextLine(Position.X + 5, Position.Y + t * textRenderer.FontLineStep, num.ToString().PadLeft(maxPower), 0, [], ref dummyValue);
-                            }
+                            num = 100 - (cursorLine - num);
+                        }
+                        else
+                        {
+                            num = num - cursorLine;
+                        }
+                        if (num == 0)
+                        {
+                            SDL_Sharp.Rect rect = new(Position.X + 5, Position.Y + t * textRenderer.FontLineStep, Position.Width - 10, textRenderer.FontLineStep);
+                            Batch.SetDrawColor(0, 20, 20, 255);
+                            Batch.FillRect(rect);
+                        }
+                        else
+                        {
+                            textRenderer.DrawTextLine(Position.X + 5, Position.Y + t * textRenderer.FontLineStep, num.ToString().PadLeft(maxPower), 0, new(255, 255, 255, 255));
                         }
                     }
                     leftBarSize = (int)((maxPower + 0.5) * textRenderer.FontStep);
@@ -718,6 +743,7 @@ namespace SDL2Interface
 
 
             SDL_Sharp.Rect textclip = new((int)window.Layout.Position.X + leftBarSize, (int)window.Layout.Position.Y, (int)window.Layout.Position.W - leftBarSize, (int)window.Layout.Position.H);
+            Batch.Flush();
             SDL.RenderSetClipRect(renderer, ref textclip);
 
             /* find current error */
@@ -733,19 +759,26 @@ namespace SDL2Interface
             /* draw cursor */
             if (window.cursor != null)
             {
-                SDL.SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                Batch.SetDrawColor(255, 255, 255, 255);
                 int selectionWidth = (int)(5 * textRenderer.currentScale);
 
                 foreach (var selection in window.cursor.Selections)
                 {
                     /* draw vericall line */
-                    if (minPos <= selection.End && selection.End < maxPos)
+                    if (minPos <= selection.End && selection.End < maxPos && window.wrapLines && window.wrapWidth > 0)
+                    {
+                        (long line, long offset) = window.buffer.GetPositionOffsets(selection.End);
+                        var (row, column) = WrappedCell(window, line, offset);
+                        SDL_Sharp.Rect r = new(leftBarSize + Position.X + 5 + (int)column * textRenderer.FontStep, Position.Y + (int)row * textRenderer.FontLineStep, 5, textRenderer.FontLineStep);
+                        Batch.FillRect(r);
+                    }
+                    else if (minPos <= selection.End && selection.End < maxPos)
                     {
                         (long line, long offset) = window.buffer.GetPositionOffsets(selection.End);
                         if (offset < (window.Layout.Position.W + leftOffset) / textRenderer.FontStep + 10)
                         {
                             SDL_Sharp.Rect r = new(leftBarSize - leftOffset + Position.X + 5 + (int)offset * textRenderer.FontStep, Position.Y + (int)(line - window.viewOffset) * textRenderer.FontLineStep, 5, textRenderer.FontLineStep);
-                            SDL.RenderFillRect(renderer, ref r);
+                            Batch.FillRect(r);
                         }
                     }
 
@@ -754,6 +787,7 @@ namespace SDL2Interface
             }
 
             SDL_Sharp.Rect restoreclip = Convert(window.Layout.Position);
+            Batch.Flush();
             SDL.RenderSetClipRect(renderer, ref restoreclip);
 
             /* draw current error */
@@ -797,6 +831,11 @@ namespace SDL2Interface
             }
             long beginLine = Math.Max(begin.line, minLine);
             long endLine = Math.Min(end.line, maxLine);
+            if (window.wrapLines && window.wrapWidth > 0)
+            {
+                FillWrappedLines(window, leftBarSize, selectionWidth, begin, end, beginLine, endLine);
+                return;
+            }
             for (long line = beginLine; line <= endLine; line++)
             {
                 long startOffset = (line == begin.line) ? begin.offset : 0;
@@ -811,7 +850,87 @@ namespace SDL2Interface
                     (int)width,
                     selectionWidth
                 );
-                SDL.RenderFillRect(renderer, ref r);
+                Batch.FillRect(r);
+            }
+        }
+
+        /* columns of wrapped rows, bar of line numbers is left of them */
+        private long WrapWidth(SimpleTextWindow window)
+        {
+            return Math.Max(8, (window.Layout.Position.W - 10) / textRenderer.FontStep - (window.showNumbers ? 5 : 0));
+        }
+
+        /* visual row of position and its column in that row, cursor at end of full row stays in it */
+        private static (long row, long column) WrappedCell(SimpleTextWindow window, long line, long offset)
+        {
+            var wrap = window.buffer.GetWrapIndex(window.wrapWidth);
+            long first = wrap.RowOfLine(line);
+            long rowInLine = Math.Min(offset / window.wrapWidth, Math.Max(wrap.RowOfLine(line + 1) - first - 1, 0));
+            return (first + rowInLine - wrap.RowOfLine(window.viewOffset) - window.viewRow, offset - rowInLine * window.wrapWidth);
+        }
+
+        /* view is moved by visual rows to keep 3 rows around cursor, lines between them are measured first */
+        private void AlignWrapped(SimpleTextWindow window, long cursorLine, long cursorOffset)
+        {
+            long rows = window.Layout.Position.H / textRenderer.FontLineStep;
+            var wrap = window.buffer.GetWrapIndex(window.wrapWidth);
+            window.buffer.MeasureWrappedLines(cursorLine - rows, cursorLine + rows);
+            long top = wrap.RowOfLine(window.viewOffset) + window.viewRow;
+            long cursorRow = WrappedCell(window, cursorLine, cursorOffset).row + top;
+            if (cursorRow < top + 3)
+            {
+                top = cursorRow - 3;
+            }
+            if (cursorRow > top + rows - 4)
+            {
+                top = cursorRow - rows + 4;
+            }
+            (window.viewOffset, window.viewRow) = wrap.LineOfRow(top);
+        }
+
+        /* line after the last one in view */
+        private long LastVisibleLine(SimpleTextWindow window)
+        {
+            long rows = window.Layout.Position.H / textRenderer.FontLineStep;
+            if (window.wrapLines && window.wrapWidth > 0)
+            {
+                var wrap = window.buffer.GetWrapIndex(window.wrapWidth);
+                return wrap.LineOfRow(wrap.RowOfLine(window.viewOffset) + window.viewRow + rows).line + 1;
+            }
+            return window.viewOffset + rows + 1;
+        }
+
+        /* range of lines split into visual rows, each row gets its part */
+        private void FillWrappedLines(SimpleTextWindow window, int leftBarSize, int selectionWidth, (long line, long offset) begin, (long line, long offset) end, long beginLine, long endLine)
+        {
+            SDL_Sharp.Rect Position = Convert(window.Layout.Position);
+            long width = window.wrapWidth;
+            long rows = window.Layout.Position.H / textRenderer.FontLineStep;
+            var wrap = window.buffer.GetWrapIndex(width);
+            long top = wrap.RowOfLine(window.viewOffset) + window.viewRow;
+            for (long line = beginLine; line <= endLine; line++)
+            {
+                long startOffset = (line == begin.line) ? begin.offset : 0;
+                long endOffset = (line == end.line) ? end.offset : window.buffer.Text.GetLineOffsets(line).length;
+                long first = wrap.RowOfLine(line);
+                long lastRow = Math.Max(wrap.RowOfLine(line + 1) - first - 1, 0);
+                for (long k = Math.Min(startOffset / width, lastRow); k <= lastRow && k * width < Math.Max(endOffset, 1); k++)
+                {
+                    long row = first + k - top;
+                    long from = Math.Max(startOffset, k * width);
+                    long to = k == lastRow ? endOffset : Math.Min(endOffset, (k + 1) * width);
+                    if (row < 0 || row > rows || to <= from)
+                    {
+                        continue;
+                    }
+                    SDL_Sharp.Rect r = new(
+                        leftBarSize + Position.X + 5 + (int)(from - k * width) * textRenderer.FontStep,
+                        Position.Y + (int)row * textRenderer.FontLineStep + textRenderer.FontLineStep - selectionWidth,
+                        (int)(to - from) * textRenderer.FontStep,
+                        selectionWidth
+                    );
+                    Batch.FillRect(r);
+                }
             }
         }
 
@@ -822,16 +941,24 @@ namespace SDL2Interface
             DrawRecurse(window);
         }
 
+        /* batched geometry of frame is submitted before it is shown */
+        public void Present()
+        {
+            Batch.Flush();
+            SDL.RenderPresent(renderer);
+        }
+
 
         public void SimpleTextWindowDrawText(SimpleTextWindow window, int leftBarSize, IErrorMark? current = null)
         {
             if (!textRenderer.Ready) return;
             int leftOffset = (int)window.leftViewOffset * textRenderer.FontStep;
             SDL_Sharp.Rect textclip = new((int)window.Layout.Position.X + leftBarSize, (int)window.Layout.Position.Y, (int)window.Layout.Position.W - leftBarSize, (int)window.Layout.Position.H);
+            Batch.Flush();
             SDL.RenderSetClipRect(renderer, ref textclip);
 
             long minLine = window.viewOffset;
-            long maxLine = minLine + (window.Layout.Position.H / textRenderer.FontLineStep) + 1;
+            long maxLine = LastVisibleLine(window);
             long minPos = window.buffer.GetLineOffsets(minLine).begin;
             long maxPos = window.buffer.GetLineOffsets(maxLine).begin;
             long totalLength = window.buffer.Text.Length;
@@ -840,9 +967,10 @@ namespace SDL2Interface
             long selectionWidth = (long)(8 * textRenderer.currentScale);
             lock (window.buffer.ErrorMarksLock)
             {
-                SDL.SetRenderDrawColor(renderer, 50, 0, 0, 255);
+                Batch.SetDrawColor(50, 0, 0, 255);
                 bool prevFixit = false;
-                foreach (ref var err in CollectionsMarshal.AsSpan(window.buffer.ErrorMarks))
+                var visibleMarks = window.buffer.ErrorMarks.Query(minPos, maxPos);
+                foreach (var err in visibleMarks)
                 {
                     if (err.End >= totalLength)
                     {
@@ -863,21 +991,21 @@ namespace SDL2Interface
                     bool thisFixIt = err.IsFixItAvailable(window.buffer);
                     if (thisFixIt != prevFixit)
                     {
-                        if (thisFixIt) { SDL.SetRenderDrawColor(renderer, 40, 0, 40, 255); }
-                        else { SDL.SetRenderDrawColor(renderer, 50, 0, 0, 255); }
+                        if (thisFixIt) { Batch.SetDrawColor(40, 0, 40, 255); }
+                        else { Batch.SetDrawColor(50, 0, 0, 255); }
                         prevFixit = thisFixIt;
                     }
                     FillLinesFromTo(window, leftBarSize, textRenderer.FontLineStep, minPos, maxPos, minLine, maxLine, err.Begin, err.End);
                 }
                 prevFixit = false;
-                SDL.SetRenderDrawColor(renderer, 255, 0, 0, 255);
-                foreach (var err in window.buffer.ErrorMarks)
+                Batch.SetDrawColor(255, 0, 0, 255);
+                foreach (var err in visibleMarks)
                 {
                     bool thisFixIt = err.IsFixItAvailable(window.buffer);
                     if (thisFixIt != prevFixit)
                     {
-                        if (thisFixIt) { SDL.SetRenderDrawColor(renderer, 200, 0, 200, 255); }
-                        else { SDL.SetRenderDrawColor(renderer, 255, 0, 0, 255); }
+                        if (thisFixIt) { Batch.SetDrawColor(200, 0, 200, 255); }
+                        else { Batch.SetDrawColor(255, 0, 0, 255); }
                         prevFixit = thisFixIt;
                     }
                     FillLinesFromTo(window, leftBarSize, (int)selectionWidth, minPos, maxPos, minLine, maxLine, err.Begin, err.End);
@@ -890,39 +1018,65 @@ namespace SDL2Interface
             {
                 if (current.IsFixItAvailable(window.buffer))
                 {
-                    SDL.SetRenderDrawColor(renderer, 50, 0, 25, 255);
+                    Batch.SetDrawColor(50, 0, 25, 255);
                     FillLinesFromTo(window, leftBarSize, textRenderer.FontLineStep, minPos, maxPos, minLine, maxLine, current.Begin, current.End);
-                    SDL.SetRenderDrawColor(renderer, 255, 0, 128, 255);
+                    Batch.SetDrawColor(255, 0, 128, 255);
                     FillLinesFromTo(window, leftBarSize, (int)selectionWidth, minPos, maxPos, minLine, maxLine, current.Begin, current.End);
                 }
                 else
                 {
-                    SDL.SetRenderDrawColor(renderer, 50, 25, 0, 255);
+                    Batch.SetDrawColor(50, 25, 0, 255);
                     FillLinesFromTo(window, leftBarSize, textRenderer.FontLineStep, minPos, maxPos, minLine, maxLine, current.Begin, current.End);
-                    SDL.SetRenderDrawColor(renderer, 255, 128, 0, 255);
+                    Batch.SetDrawColor(255, 128, 0, 255);
                     FillLinesFromTo(window, leftBarSize, (int)selectionWidth, minPos, maxPos, minLine, maxLine, current.Begin, current.End);
                 }
             }
 
-            long lastToken = 0;
-            for (int t = 0; t < window.Layout.Position.H / textRenderer.FontLineStep; ++t)
+            var tokens = window.buffer.Tokens;
+            TokenStore.Cursor lastToken = default;
+            if (window.wrapLines && window.wrapWidth > 0)
             {
-                int i = t + (int)window.viewOffset;
-                (long index, string? s, _) = window.buffer.GetLine(i, (window.Layout.Position.W + leftOffset) / textRenderer.FontStep + 1);
-                if (s != null)
+                int wrappedRows = visibleLines.ReadWrapped(window.buffer, window.viewOffset, window.viewRow, (int)(window.Layout.Position.H / textRenderer.FontLineStep), (int)window.wrapWidth);
+                for (int t = visibleLines.FirstRow; t < wrappedRows; ++t)
                 {
-                    textRenderer.DrawTextLine(leftBarSize - leftOffset + (int)window.Layout.Position.X + 5, (int)window.Layout.Position.Y + t * textRenderer.FontLineStep, s, index, window.buffer.Tokens, ref lastToken);
+                    long index = visibleLines.Offset(t);
+                    if (t == visibleLines.FirstRow)
+                    {
+                        lastToken = tokens.Seek(index);
+                    }
+                    long column = visibleLines.Column(t) - visibleLines.RowInLine(t) * window.wrapWidth;
+                    int x = leftBarSize + (int)window.Layout.Position.X + 5 + (int)column * textRenderer.FontStep;
+                    textRenderer.DrawTextLine(x, (int)window.Layout.Position.Y + t * textRenderer.FontLineStep, visibleLines.Text(t), index, ref lastToken);
+                }
+            }
+            else
+            {
+                /* all visible lines are read at once, only columns which are in view */
+                long firstColumn = Math.Max(0, (long)window.leftViewOffset);
+                int rows = visibleLines.Read(window.buffer, window.viewOffset, (int)(window.Layout.Position.H / textRenderer.FontLineStep), (int)(window.Layout.Position.W / textRenderer.FontStep + 1), firstColumn);
+                for (int t = visibleLines.FirstRow; t < rows; ++t)
+                {
+                    long index = visibleLines.Offset(t);
+                    string s = visibleLines.Text(t);
+                    /* tokens of columns before view aren't walked over */
+                    if (t == visibleLines.FirstRow || firstColumn > 0)
+                    {
+                        lastToken = tokens.Seek(index);
+                    }
+                    int x = leftBarSize - leftOffset + (int)window.Layout.Position.X + 5 + (int)visibleLines.Column(t) * textRenderer.FontStep;
+                    textRenderer.DrawTextLine(x, (int)window.Layout.Position.Y + t * textRenderer.FontLineStep, s, index, ref lastToken);
                 }
             }
 
             SDL_Sharp.Rect restoreclip = Convert(window.Layout.Position);
+            Batch.Flush();
             SDL.RenderSetClipRect(renderer, ref restoreclip);
 
             // draw errors count
-            SDL.SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            Batch.SetDrawColor(0, 0, 0, 255);
             textRenderer.Scale(0.8);
             SDL_Sharp.Rect r = new((int)window.Layout.Position.X, (int)window.Layout.Position.Y + (int)window.Layout.Position.H - textRenderer.FontLineStep - 10, (int)window.Layout.Position.W, textRenderer.FontLineStep + 10);
-            SDL.RenderFillRect(renderer, ref r);
+            Batch.FillRect(r);
             textRenderer.DrawTextLine((int)window.Layout.Position.X + 5, (int)window.Layout.Position.Y + (int)window.Layout.Position.H - 5 - textRenderer.FontLineStep, $"{window.buffer.ErrorMarks.Count} errors in file", 0, new(255, 0, 0, 255));
             textRenderer.Scale(1.25);
         }
@@ -932,16 +1086,44 @@ namespace SDL2Interface
             if (!textRenderer.Ready) return;
 
             int maxPower = 4;
-            long dummyValue = 0;
             /* draw numbers */
-            for (int t = 0; t < (int)window.Layout.Position.H / textRenderer.FontLineStep; ++t)
+            int rows = visibleLines.Read(window.buffer, window.viewOffset, (int)window.Layout.Position.H / textRenderer.FontLineStep, 1);
+            for (int t = visibleLines.FirstRow; t < rows; ++t)
             {
                 int i = t + (int)window.viewOffset;
-                (long index, string? s, _) = window.buffer.GetLine(i, 1);
-                if (s != null)
+                int num = i;
+                textRenderer.DrawTextLine((int)window.Layout.Position.X + 5, (int)window.Layout.Position.Y + t * textRenderer.FontLineStep, num.ToString().PadLeft(maxPower), 0, new(255, 255, 255, 255));
+            }
+            leftBarSize = (int)((maxPower + 0.5) * textRenderer.FontStep);
+        }
+
+        /* number is drawn at first row of line, relative to cursor line if it is given */
+        public void SimpleTextWindowDrawWrappedNumbers(SimpleTextWindow window, long? cursorLine, ref int leftBarSize)
+        {
+            if (!textRenderer.Ready) return;
+
+            int maxPower = 4;
+            int rows = visibleLines.ReadWrapped(window.buffer, window.viewOffset, window.viewRow, (int)(window.Layout.Position.H / textRenderer.FontLineStep), (int)window.wrapWidth);
+            for (int t = visibleLines.FirstRow; t < rows; ++t)
+            {
+                if (visibleLines.RowInLine(t) != 0)
+                {
+                    continue;
+                }
+                long num = visibleLines.Line(t);
+                if (cursorLine != null)
+                {
+                    num = num < cursorLine.Value ? 100 - (cursorLine.Value - num) : num - cursorLine.Value;
+                }
+                if (cursorLine != null && num == 0)
+                {
+                    SDL_Sharp.Rect rect = new((int)window.Layout.Position.X + 5, (int)window.Layout.Position.Y + t * textRenderer.FontLineStep, (int)window.Layout.Position.W - 10, textRenderer.FontLineStep);
+                    Batch.SetDrawColor(0, 20, 20, 255);
+                    Batch.FillRect(rect);
+                }
+                else
                 {
-                    int num = i;
-                    textRenderer.DrawTextLine((int)window.Layout.Position.X + 5, (int)window.Layout.Position.Y + t * textRenderer.FontLineStep, num.ToString().PadLeft(maxPower), 0, [], ref dummyValue);
+                    textRenderer.DrawTextLine((int)window.Layout.Position.X + 5, (int)window.Layout.Position.Y + t * textRenderer.FontLineStep, num.ToString().PadLeft(maxPower), 0, new(255, 255, 255, 255));
                 }
             }
             leftBarSize = (int)((maxPower + 0.5) * textRenderer.FontStep);
@@ -957,14 +1139,17 @@ namespace SDL2Interface
 
             Vector2 positionScale = new(nodeXStep, nodeYStep);
 
-            SDL.SetRenderDrawColor(renderer, 0, 0, 0, 0);
+            Batch.SetDrawColor(0, 0, 0, 0);
             SDL_Sharp.Rect Position = Convert(window.Layout.Position);
-            SDL.RenderFillRect(renderer, ref Position);
+            Batch.FillRect(Position);
 
-            /* draw tree, relative to current version */
-            foreach (var node in window.tree.Values.Where(x => !x.hidden))
+            /* draw nodes in view and one row and column around it, relative to current version */
+            Vector2 half = new Vector2(Position.Width * 0.5f, Position.Height * 0.5f) / window.Scale;
+            Vector2 min = (window.Camera - half) / positionScale - Vector2.One, max = (window.Camera + half) / positionScale + Vector2.One;
+            window.graph.NodesIn(min.X, max.X, min.Y, max.Y, window.Visible);
+            foreach (var node in window.Visible)
             {
-                SDL.SetRenderDrawColor(renderer, 255, 0, 0, 0);
+                Batch.SetDrawColor(255, 0, 0, 0);
                 Vector2 pos = (node.position * positionScale - window.Camera) * window.Scale + new Vector2(Position.Width * 0.5f, Position.Height * 0.5f);
                 float w, h;
                 w = nodeWidth * window.Scale;
@@ -973,14 +1158,14 @@ namespace SDL2Interface
                 SDL_Sharp.Rect rect = new() { X = Position.X + (int)pos.X, Y = Position.Y + (int)pos.Y, Width = (int)w, Height = (int)h };
                 if (node == window.current)
                 {
-                    SDL.RenderFillRect(renderer, ref rect);
+                    Batch.FillRect(rect);
                 }
                 else
                 {
                     long ww = Math.Min(window.Layout.Position.W, window.Layout.Position.H) / 500;
                     for (long i = 0; i < ww; i++)
                     {
-                        SDL.RenderDrawRect(renderer, ref rect);
+                        Batch.DrawRect(rect);
                         rect.X++;
                         rect.Y++;
                         rect.Width -= 2;
@@ -989,25 +1174,28 @@ namespace SDL2Interface
                 }
                 pos += 0.5f * new Vector2(w, h);
                 rect = new() { X = Position.X + (int)pos.X, Y = Position.Y + (int)pos.Y, Width = (int)w, Height = (int)h };
-                foreach (var next in new[] { node.up, node.right }.OfType<TreeWalkWindow.Node>())
+                foreach (var next in new[] { node.up, node.right }.OfType<VersionGraph.Node>())
                 {
                     Vector2 nextPos = (next.position * positionScale - window.Camera) * window.Scale + new Vector2(Position.Width * 0.5f, Position.Height * 0.5f);
                     int x = Position.X + (int)nextPos.X, y = Position.Y + (int)nextPos.Y;
-                    SDL.RenderDrawLine(renderer, rect.X, rect.Y, x, y);
+                    Batch.DrawLine(rect.X, rect.Y, x, y);
                 }
             }
 
             {
                 float t = 1.0f / (movingSmooth + 1.0f);
-                window.Camera = window.Camera * (1.0f - t) + window.current.position * positionScale * t;
-                window.Scale = window.Scale * (1.0f - t) + window.DestinationScale * t;
+                Vector2 camera = window.Camera * (1.0f - t) + window.current.position * positionScale * t;
+                float scale = window.Scale * (1.0f - t) + window.DestinationScale * t;
+                window.Moving = Vector2.DistanceSquared(camera * scale, window.Camera * window.Scale) > 0.01f || Math.Abs(scale - window.Scale) > 0.001f;
+                window.Camera = camera;
+                window.Scale = scale;
             }
         }
         public void DrawSimpleWindow(SimpleTextWindow window)
         {
-            SDL.SetRenderDrawColor(renderer, 0, 0, 0, 0);
+            Batch.SetDrawColor(0, 0, 0, 0);
             SDL_Sharp.Rect rect = Convert(window.Layout.Position);
-            SDL.RenderFillRect(renderer, ref rect);
+            Batch.FillRect(rect);
 
             int leftBarSize = 0;
 
@@ -11,8 +11,11 @@ using System.Threading.Tasks;
 
 namespace SDL2Interface
 {
-    internal class TextBufferRenderer
+    internal class TextBufferRenderer : IDisposable
     {
+        private const int TextFont = 0;
+        private const int EmojiFont = 1;
+
         internal double currentScale;
         internal int baseFontStep;
         internal int baseFontLineStep;
@@ -29,7 +32,10 @@ namespace SDL2Interface
         static internal Font fontEmoji;
         static internal Rect[] asciiMapRectangles = [];
         static internal Texture asciiMap;
+        static internal int asciiMapWidth, asciiMapHeight;
+        static internal GlyphAtlas? glyphAtlas;
         internal EditorFramework.ColorTheme colorTheme;
+        internal readonly GeometryBatch Batch;
 
         internal int FontStep => (int)(baseFontStep * currentScale);
         internal int FontLineStep => (int)(baseFontLineStep * currentScale);
@@ -40,6 +46,7 @@ namespace SDL2Interface
             currentScale = 0.6;
             colorTheme = color_theme;
             renderer = input_renderer;
+            Batch = new(input_renderer);
 
             // run task if it isn't running yet.
             fontLoadingTask ??= Task.Run(() =>
@@ -71,6 +78,7 @@ namespace SDL2Interface
                         x += w;
                     }
                     /* render glyphs */
+                    (asciiMapWidth, asciiMapHeight) = (x, asciiMapRectangles[127].Height);
                     SDL.CreateRGBSurface(0, x, asciiMapRectangles[127].Height, 32, 0xff, 0xff00, 0xff0000, 0xff000000, out PSurface textMap);
                     x = 0;
                     for (int i = 32; i < 128; ++i)
@@ -107,6 +115,7 @@ namespace SDL2Interface
                         baseFontStep = Math.Max(baseFontStep, asciiMapRectangles[i].Width);
                         baseFontLineStep = Math.Max(baseFontLineStep, asciiMapRectangles[i].Height + 3);
                     }
+                    glyphAtlas ??= new GlyphAtlas(renderer, [font, fontEmoji]);
                 }
                 return true;
             }
@@ -127,8 +136,8 @@ namespace SDL2Interface
                     r.Y = y;
                     r.Width = FontStep;
                     r.Height = FontLineStep;
-                    SDL.SetRenderDrawColor(renderer, color.R, color.G, color.B, color.A);
-                    SDL.RenderDrawRect(renderer, ref r);
+                    Batch.SetDrawColor(color.R, color.G, color.B, color.A);
+                    Batch.DrawRect(r);
                 }
                 else
                 {
@@ -137,30 +146,27 @@ namespace SDL2Interface
                     r.Y = y;
                     r.Width = FontStep;
                     r.Height = FontLineStep;
-                    SDL.SetTextureColorMod(asciiMap, color.R, color.G, color.B);
-                    SDL.RenderCopy(renderer, asciiMap, ref asciiMapRectangles[(byte)c], ref r);
+                    Batch.Copy(asciiMap, asciiMapWidth, asciiMapHeight, asciiMapRectangles[(byte)c], r, color);
                 }
             }
             else
             {
-                TTF.SizeUTF8(fontEmoji, grapheme, out int w, out int h);
-                TTF.RenderUTF8_Blended(fontEmoji, grapheme, color, out PSurface glythMap);
-                if (!glythMap.IsNull)
+                /* letters of european scripts are in text font and get color of token, the rest is drawn as is */
+                GlyphKey key = new(grapheme, grapheme.Length == 1 && grapheme[0] < 0x1100 ? TextFont : EmojiFont);
+                if (glyphAtlas != null && glyphAtlas.TryGet(key, out Texture texture, out Rect src))
                 {
-                    Texture temp = SDL.CreateTextureFromSurface(renderer, glythMap);
-                    if (temp.IsNull)
-                    {
-                        throw new Exception($"Temporary texture is null: {SDL.GetError()}");
-                    }
-                    Rect src = new(0, 0, w, h);
                     Rect dest = new(x, y, FontStep * graphemeWidth, FontLineStep);
-                    SDL.RenderCopy(renderer, temp, ref src, ref dest);
-                    SDL.FreeSurface(glythMap);
-                    SDL.DestroyTexture(temp);
+                    Batch.Copy(texture, GlyphAtlas.PageSize, GlyphAtlas.PageSize, src, dest, key.Font == TextFont ? color : new Color(255, 255, 255, 255));
                 }
             }
         }
 
+        /* glyphs rasterized since last frame get into atlas, returns true when frame has to be drawn for them */
+        public bool BeginFrame()
+        {
+            return glyphAtlas?.BeginFrame() ?? false;
+        }
+
         public void DrawTextLine(int x, int y, string line, long position, Color color)
         {
             {
@@ -178,7 +184,7 @@ namespace SDL2Interface
             }
         }
 
-        public void DrawTextLine(int x, int y, string line, long position, List<Token> tokens, ref long lastToken)
+        public void DrawTextLine(int x, int y, string line, long position, ref TokenStore.Cursor lastToken)
         {
             if (!CheckInitializated()) return;
             var elements = StringInfo.GetTextElementEnumerator(line);
@@ -187,13 +193,13 @@ namespace SDL2Interface
                 string grapheme = elements.GetTextElement();
 
                 Token? currentToken = null;
-                while (lastToken < tokens.Count && tokens[(int)lastToken].end < position)
+                while (lastToken.Valid && lastToken.Current.end < position)
                 {
-                    lastToken++;
+                    lastToken.MoveNext();
                 }
-                if (lastToken < tokens.Count && tokens[(int)lastToken].begin <= position)
+                if (lastToken.Valid && lastToken.Current.begin <= position)
                 {
-                    currentToken = tokens[(int)lastToken];
+                    currentToken = lastToken.Current;
                 }
 
                 Color color = new(255, 255, 255, 255);
@@ -218,5 +224,11 @@ namespace SDL2Interface
                 currentScale = 0.1;
             }
         }
+
+        public void Dispose()
+        {
+            glyphAtlas?.Dispose();
+            glyphAtlas = null;
+        }
     }
 }